@@ -31,12 +31,15 @@ struct app_regs_t
 } app_regs;
 #pragma pack(pop)
 
-// Define register "specs."
-RegSpecs app_reg_specs[reg_count]
+// Define register layouts. Offsets, sizes, and payload types are derived
+// from the struct at compile time, and the table lives in flash.
+constexpr RegLayout app_reg_layouts[reg_count]
 {
-    {(uint8_t*)&app_regs.test_byte, sizeof(app_regs.test_byte), U8},
-    {(uint8_t*)&app_regs.test_uint, sizeof(app_regs.test_uint), U32}
+    REG_LAYOUT(app_regs_t, test_byte),
+    REG_LAYOUT(app_regs_t, test_uint)
 };
+static_assert(reg_layouts_cover<app_regs_t>(app_reg_layouts),
+              "App register layouts must cover app_regs_t in order.");
 
 // Define register read-and-write handler functions.
 RegFnPair reg_handler_fns[reg_count]
@@ -66,7 +69,7 @@ HarpCApp& app = HarpCApp::init(who_am_i, hw_version_major, hw_version_minor,
                                fw_version_major, fw_version_minor,
                                serial_number, "Example C App",
                                (const uint8_t*)GIT_HASH, // in CMakeLists.txt.
-                               &app_regs, app_reg_specs,
+                               &app_regs, app_reg_layouts,
                                reg_handler_fns, reg_count, update_app_state,
                                app_reset);
 
@@ -4,11 +4,31 @@
 #include <reg_types.h>
 #include <core_reg_bits.h>
 #include <cstring>  // for strcpy
+#include <cstddef>  // for offsetof
 
 static const uint8_t CORE_REG_COUNT = 18;
 
 #define APP_REG_START_ADDRESS (32)
 
+static const uint8_t DIAG_REG_COUNT = 6;
+static const uint8_t SYNC_REG_COUNT = 8;
+
+// The protocol reserves addresses below APP_REG_START_ADDRESS for its common
+// registers, so the diagnostics and sync telemetry banks sit at the top of
+// the app's address range instead, after its last register. Define
+// DIAG_REG_START_ADDRESS to move them.
+#ifndef DIAG_REG_START_ADDRESS
+#define DIAG_REG_START_ADDRESS (240) // first register of the diagnostics
+                                     // bank. See DiagRegValues.
+#endif
+// First register of the sync telemetry bank, right after the diagnostics
+// bank. See SyncRegValues.
+#define SYNC_REG_START_ADDRESS (DIAG_REG_START_ADDRESS + DIAG_REG_COUNT)
+// App registers must end before the diagnostics bank.
+#define MAX_APP_REG_COUNT (DIAG_REG_START_ADDRESS - APP_REG_START_ADDRESS)
+
+#define REPLY_LATENCY_BIN_COUNT (16) // log2-scaled bins of R_REPLY_LATENCY.
+
 // R_OPERATION_CTRL bitfields.
 #define DUMP_OFFSET (3)
 #define MUTE_RPL_OFFSET (4)
@@ -22,6 +42,19 @@ static const uint8_t CORE_REG_COUNT = 18;
 #define BOOT_DEF_OFFSET (6)
 #define BOOT_EE_OFFSET (7)
 
+// R_PROFILE_CTRL bitfields
+#define PROFILE_PHASE_MASK (0x3F) // HarpProfiler::Phase of R_PROFILE.
+#define PROFILE_CORE_OFFSET (6)
+#define PROFILE_RESET_OFFSET (7)
+
+// R_CLOCK_CONFIG bitfields
+#define CLK_REP_OFFSET (0)
+#define CLK_GEN_OFFSET (1)
+#define REP_ABLE_OFFSET (3)
+#define GEN_ABLE_OFFSET (4)
+#define CLK_UNLOCK_OFFSET (6)
+#define CLK_LOCK_OFFSET (7)
+
 /**
  * \brief enum for easier interpretation of the OP_MODE bitfield in the
  *  R_OPERATION_CTRL register.
@@ -58,6 +91,20 @@ enum RegName : uint8_t
     TIMESTAMP_OFFSET = 15,
     UUID = 16,
     TAG = 17,
+    PROFILE_CTRL = DIAG_REG_START_ADDRESS,
+    PROFILE = DIAG_REG_START_ADDRESS + 1,
+    REPLY_LATENCY = DIAG_REG_START_ADDRESS + 2,
+    TX_STATS = DIAG_REG_START_ADDRESS + 3,
+    TX_DROP_SELECT = DIAG_REG_START_ADDRESS + 4,
+    TX_DROPS = DIAG_REG_START_ADDRESS + 5,
+    SYNC_STATUS = SYNC_REG_START_ADDRESS,
+    SYNC_CORRECTION = SYNC_REG_START_ADDRESS + 1,
+    SYNC_JITTER = SYNC_REG_START_ADDRESS + 2,
+    SYNC_FREQ = SYNC_REG_START_ADDRESS + 3,
+    SYNC_ERROR_ESTIMATE = SYNC_REG_START_ADDRESS + 4,
+    SYNC_PACKETS = SYNC_REG_START_ADDRESS + 5,
+    SYNC_TIME_SINCE_LOCK = SYNC_REG_START_ADDRESS + 6,
+    SYNC_EVENT_PERIOD = SYNC_REG_START_ADDRESS + 7,
 };
 
 
@@ -84,6 +131,58 @@ struct RegValues
     uint8_t R_UUID[16];
     uint8_t R_TAG[8];
 };
+
+/**
+ * \brief sync telemetry registers. Read-only, except for
+ *  R_SYNC_EVENT_PERIOD. Refreshed from the attached HarpSynchronizer (see
+ *  HarpSynchronizer::SyncStats) whenever they are read or sent as events.
+ */
+struct SyncRegValues
+{
+    volatile uint8_t R_SYNC_STATUS; ///< HarpSynchronizer::SyncStatus.
+    volatile int32_t R_SYNC_CORRECTION[4]; ///< last, min, max, and mean phase
+                                           ///< error corrected [us].
+    volatile uint32_t R_SYNC_JITTER; ///< [us]
+    volatile int32_t R_SYNC_FREQ; ///< learned frequency error [ppb].
+    volatile uint32_t R_SYNC_ERROR_ESTIMATE; ///< [us]
+    volatile uint32_t R_SYNC_PACKETS[3]; ///< received, missed, and malformed
+                                         ///< sync packet counts.
+    volatile uint32_t R_SYNC_TIME_SINCE_LOCK; ///< time since the last sync
+                                              ///< packet [ms].
+    volatile uint8_t R_SYNC_EVENT_PERIOD; ///< period of sync telemetry
+                                          ///< events [s]. Zero disables them.
+};
+
+/**
+ * \brief diagnostics registers. See HarpProfiler for R_PROFILE, which reads
+ *  all zeros unless the firmware is built with HARP_CORE_PROFILE.
+ *  The rest are always kept.
+ */
+struct DiagRegValues
+{
+    volatile uint8_t R_PROFILE_CTRL; ///< the phase (bits 0-5) and core (bit
+                                     ///< 6) that R_PROFILE reads. Bit 7
+                                     ///< resets all phases when written and
+                                     ///< reads as zero.
+    volatile uint32_t R_PROFILE[12]; ///< count, min, max, and mean duration
+                                     ///< [ticks] of the selected phase of
+                                     ///< run(), then its 8-bin histogram.
+    volatile uint32_t R_REPLY_LATENCY[REPLY_LATENCY_BIN_COUNT]; ///< number
+        ///< of requests whose first reply was queued within [2^i, 2^(i+1))
+        ///< [us] (bin 0: under 2[us]) of reading their first byte from the
+        ///< serial port. Writing resets it.
+    volatile uint32_t R_TX_STATS[2]; ///< number of outgoing messages that
+                                     ///< waited for room in the TX FIFO,
+                                     ///< then number dropped because none
+                                     ///< freed up in time. Writing resets
+                                     ///< it.
+    volatile uint8_t R_TX_DROP_SELECT; ///< register address whose drop count
+                                       ///< R_TX_DROPS reads.
+    volatile uint32_t R_TX_DROPS[2]; ///< number of outgoing messages from the
+                                     ///< selected register that were lost,
+                                     ///< then from all registers. Writing
+                                     ///< resets every count.
+};
 #pragma pack(pop)
 
 struct RegSpecs
@@ -93,6 +192,53 @@ struct RegSpecs
     const reg_type_t payload_type;
 };
 
+/**
+ * \brief location and type of one register within a packed struct of
+ *  registers. Unlike RegSpecs, this does not depend on where the struct
+ *  lives, so tables of them can be `constexpr` and stored in flash.
+ * \note build these with REG_LAYOUT() so that sizes and types always match
+ *  the struct.
+ */
+struct RegLayout
+{
+    uint16_t offset;
+    uint8_t num_bytes;
+    reg_type_t payload_type;
+
+/**
+ * \brief specs of this register within the struct of registers at \p base.
+ */
+    RegSpecs specs(volatile void* base) const
+    {return {(volatile uint8_t*)base + offset, num_bytes, payload_type};}
+};
+
+/**
+ * \brief RegLayout of \p member of the packed register struct \p reg_struct.
+ *  Its offset, size, and payload type are derived from the struct.
+ */
+#define REG_LAYOUT(reg_struct, member) \
+    RegLayout{uint16_t(offsetof(reg_struct, member)), \
+              uint8_t(sizeof(reg_struct::member)), \
+              reg_type_of<decltype(reg_struct::member)>::value}
+
+/**
+ * \brief true if \p layouts describe every byte of \p RegStruct in order,
+ *  one register after another. Useful in a `static_assert` to catch missing
+ *  or out-of-order registers.
+ */
+template <typename RegStruct, size_t N>
+constexpr bool reg_layouts_cover(const RegLayout (&layouts)[N])
+{
+    size_t offset = 0;
+    for (size_t i = 0; i < N; ++i)
+    {
+        if (layouts[i].offset != offset)
+            return false;
+        offset += layouts[i].num_bytes;
+    }
+    return offset == sizeof(RegStruct);
+}
+
 struct Registers
 {
     public:
@@ -109,27 +255,89 @@ struct Registers
 
     // Lookup table. Necessary because register data is not of equal size,
     //  so we can't index into it directly by enum.
-    // TODO: consider generating this table statically with a template.
-    const RegSpecs address_to_specs[CORE_REG_COUNT] =
-    {{(uint8_t*)&regs_.R_WHO_AM_I,         sizeof(regs_.R_WHO_AM_I),          U16},
-     {(uint8_t*)&regs_.R_HW_VERSION_H,     sizeof(regs_.R_HW_VERSION_H),      U8},
-     {(uint8_t*)&regs_.R_HW_VERSION_L,     sizeof(regs_.R_HW_VERSION_L),      U8},
-     {(uint8_t*)&regs_.R_ASSEMBLY_VERSION, sizeof(regs_.R_ASSEMBLY_VERSION),  U8},
-     {(uint8_t*)&regs_.R_HARP_VERSION_H,   sizeof(regs_.R_HARP_VERSION_H),    U8},
-     {(uint8_t*)&regs_.R_HARP_VERSION_L,   sizeof(regs_.R_HW_VERSION_L),      U8},
-     {(uint8_t*)&regs_.R_FW_VERSION_H,     sizeof(regs_.R_FW_VERSION_H),      U8},
-     {(uint8_t*)&regs_.R_FW_VERSION_L,     sizeof(regs_.R_FW_VERSION_L),      U8},
-     {(uint8_t*)&regs_.R_TIMESTAMP_SECOND, sizeof(regs_.R_TIMESTAMP_SECOND),  U32},
-     {(uint8_t*)&regs_.R_TIMESTAMP_MICRO,  sizeof(regs_.R_TIMESTAMP_MICRO),   U16},
-     {(uint8_t*)&regs_.R_OPERATION_CTRL,   sizeof(regs_.R_OPERATION_CTRL),    U8},
-     {(uint8_t*)&regs_.R_RESET_DEF,        sizeof(regs_.R_RESET_DEF),         U8},
-     {(uint8_t*)&regs_.R_DEVICE_NAME,      sizeof(regs_.R_DEVICE_NAME),       U8},
-     {(uint8_t*)&regs_.R_SERIAL_NUMBER,    sizeof(regs_.R_SERIAL_NUMBER),     U16},
-     {(uint8_t*)&regs_.R_CLOCK_CONFIG,     sizeof(regs_.R_CLOCK_CONFIG),      U8},
-     {(uint8_t*)&regs_.R_TIMESTAMP_OFFSET, sizeof(regs_.R_TIMESTAMP_OFFSET),  U8},
-     {(uint8_t*)&regs_.R_UUID, sizeof(regs_.R_UUID),  U8},
-     {(uint8_t*)&regs_.R_TAG, sizeof(regs_.R_TAG),  U8},
+    static constexpr RegLayout address_to_layout[CORE_REG_COUNT] =
+    {REG_LAYOUT(RegValues, R_WHO_AM_I),
+     REG_LAYOUT(RegValues, R_HW_VERSION_H),
+     REG_LAYOUT(RegValues, R_HW_VERSION_L),
+     REG_LAYOUT(RegValues, R_ASSEMBLY_VERSION),
+     REG_LAYOUT(RegValues, R_HARP_VERSION_H),
+     REG_LAYOUT(RegValues, R_HARP_VERSION_L),
+     REG_LAYOUT(RegValues, R_FW_VERSION_H),
+     REG_LAYOUT(RegValues, R_FW_VERSION_L),
+     REG_LAYOUT(RegValues, R_TIMESTAMP_SECOND),
+     REG_LAYOUT(RegValues, R_TIMESTAMP_MICRO),
+     REG_LAYOUT(RegValues, R_OPERATION_CTRL),
+     REG_LAYOUT(RegValues, R_RESET_DEF),
+     REG_LAYOUT(RegValues, R_DEVICE_NAME),
+     REG_LAYOUT(RegValues, R_SERIAL_NUMBER),
+     REG_LAYOUT(RegValues, R_CLOCK_CONFIG),
+     REG_LAYOUT(RegValues, R_TIMESTAMP_OFFSET),
+     REG_LAYOUT(RegValues, R_UUID),
+     REG_LAYOUT(RegValues, R_TAG),
     };
+    static_assert(reg_layouts_cover<RegValues>(address_to_layout),
+                  "Core register layouts must cover RegValues in order.");
+
+    DiagRegValues diag_regs_;
+
+    static constexpr RegLayout diag_address_to_layout[DIAG_REG_COUNT] =
+    {REG_LAYOUT(DiagRegValues, R_PROFILE_CTRL),
+     REG_LAYOUT(DiagRegValues, R_PROFILE),
+     REG_LAYOUT(DiagRegValues, R_REPLY_LATENCY),
+     REG_LAYOUT(DiagRegValues, R_TX_STATS),
+     REG_LAYOUT(DiagRegValues, R_TX_DROP_SELECT),
+     REG_LAYOUT(DiagRegValues, R_TX_DROPS),
+    };
+    static_assert(reg_layouts_cover<DiagRegValues>(diag_address_to_layout),
+                  "Diag register layouts must cover DiagRegValues in order.");
+    static_assert(DIAG_REG_START_ADDRESS >= APP_REG_START_ADDRESS,
+                  "Diag registers must not use protocol-reserved addresses.");
+
+    SyncRegValues sync_regs_;
+
+    static constexpr RegLayout sync_address_to_layout[SYNC_REG_COUNT] =
+    {REG_LAYOUT(SyncRegValues, R_SYNC_STATUS),
+     REG_LAYOUT(SyncRegValues, R_SYNC_CORRECTION),
+     REG_LAYOUT(SyncRegValues, R_SYNC_JITTER),
+     REG_LAYOUT(SyncRegValues, R_SYNC_FREQ),
+     REG_LAYOUT(SyncRegValues, R_SYNC_ERROR_ESTIMATE),
+     REG_LAYOUT(SyncRegValues, R_SYNC_PACKETS),
+     REG_LAYOUT(SyncRegValues, R_SYNC_TIME_SINCE_LOCK),
+     REG_LAYOUT(SyncRegValues, R_SYNC_EVENT_PERIOD),
+    };
+    static_assert(reg_layouts_cover<SyncRegValues>(sync_address_to_layout),
+                  "Sync register layouts must cover SyncRegValues in order.");
+    static_assert(SYNC_REG_START_ADDRESS + SYNC_REG_COUNT <= 256,
+                  "Sync registers must fit the address space.");
+
+/**
+ * \brief true if \p address is a core, diagnostics, or sync telemetry
+ *  register.
+ */
+    static constexpr bool is_core_address(uint8_t address)
+    {
+        return (address < CORE_REG_COUNT)
+               || (address >= DIAG_REG_START_ADDRESS
+                   && address < DIAG_REG_START_ADDRESS + DIAG_REG_COUNT)
+               || (address >= SYNC_REG_START_ADDRESS
+                   && address < SYNC_REG_START_ADDRESS + SYNC_REG_COUNT);
+    }
+
+/**
+ * \brief specs of the core, diagnostics, or sync telemetry register at
+ *  \p address.
+ * \note \p address must satisfy is_core_address().
+ */
+    RegSpecs address_to_specs(uint8_t address)
+    {
+        if (address < CORE_REG_COUNT)
+            return address_to_layout[address].specs(&regs_);
+        if (address < SYNC_REG_START_ADDRESS)
+            return diag_address_to_layout[address - DIAG_REG_START_ADDRESS]
+                        .specs(&diag_regs_);
+        return sync_address_to_layout[address - SYNC_REG_START_ADDRESS]
+                    .specs(&sync_regs_);
+    }
 
     // Syntactic Sugar. Make bitfields for certain registers easier to access.
     OperationCtrlBits& r_operation_ctrl_bits = *((OperationCtrlBits*)(&regs_.R_OPERATION_CTRL));
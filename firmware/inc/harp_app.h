@@ -0,0 +1,223 @@
+#ifndef HARP_APP_H
+#define HARP_APP_H
+#include <harp_core.h>
+#include <core_registers.h>
+#include <reg_types.h>
+#include <iterator> // for std::size
+#include <utility> // for std::index_sequence
+
+/**
+ * \brief Harp App whose register layout and handlers are compile-time
+ *  parameters. Handles core behaviors in addition to reads/writes to
+ *  app-specific registers.
+ *  Implemented as a singleton to simplify attaching interrupt callbacks
+ *  (and since you can only have one per device).
+ * \details Messages to app registers are dispatched with a compile-time
+ *  generated comparison chain (or jump table) instead of a table of
+ *  function pointers, so handlers can be inlined. Registers that use
+ *  HarpCore::read_reg_generic() or HarpCore::write_reg_generic() are
+ *  handled inline from their RegLayout. run() makes no virtual calls.
+ * \tparam RegStruct packed struct of app registers.
+ * \tparam Handlers struct with the following static members:
+ * \code
+ *  struct Handlers
+ *  {
+ *      // One per app register, in address order.
+ *      static constexpr RegLayout reg_layouts[] {REG_LAYOUT(RegStruct, ...)};
+ *      static constexpr RegFnPair reg_fns[] {{read_fn, write_fn}, ...};
+ *      static void update(); // called periodically from run().
+ *      static void reset(); // called when writing to the RESET_DEF register.
+ *  };
+ * \endcode
+ * \note HarpCApp remains available for apps whose registers are described
+ *  at runtime.
+ */
+template <typename RegStruct, typename Handlers>
+class HarpApp final: public HarpCore
+{
+public:
+    static constexpr size_t reg_count = std::size(Handlers::reg_layouts);
+    static_assert(std::size(Handlers::reg_fns) == reg_count,
+                  "There must be one RegFnPair per app register.");
+    static_assert(reg_layouts_cover<RegStruct>(Handlers::reg_layouts),
+                  "App register layouts must cover the register struct in "
+                  "order.");
+    static_assert(reg_count <= MAX_APP_REG_COUNT,
+                  "Too many app registers. They would overlap the diagnostics "
+                  "bank. See DIAG_REG_START_ADDRESS.");
+
+// Make constructor private to prevent creating instances outside of init().
+private:
+    HarpApp(uint16_t who_am_i,
+            uint8_t hw_version_major, uint8_t hw_version_minor,
+            uint8_t assembly_version,
+            uint8_t harp_version_major, uint8_t harp_version_minor,
+            uint8_t fw_version_major, uint8_t fw_version_minor,
+            uint16_t serial_number, const char name[],
+            const uint8_t tag[], RegStruct& app_regs)
+    :HarpCore(who_am_i, hw_version_major, hw_version_minor,
+              assembly_version, harp_version_major, harp_version_minor,
+              fw_version_major, fw_version_minor, serial_number, name, tag)
+    {
+        app_regs_ = &app_regs;
+        // Create a ptr to the first (and only) instance created.
+        if (self == nullptr)
+            self = this;
+    }
+
+    ~HarpApp(){self = nullptr;}
+
+public:
+    HarpApp() = delete;  // Disable default constructor.
+    HarpApp(HarpApp& other) = delete; // Disable copy constructor.
+    void operator=(const HarpApp& other) = delete; // Disable assignment operator.
+
+/**
+ * \brief initialize the harp app singleton with parameters and init Tinyusb.
+ * \param app_regs the app registers.
+ */
+    static HarpApp& init(uint16_t who_am_i,
+                         uint8_t hw_version_major, uint8_t hw_version_minor,
+                         uint8_t assembly_version,
+                         uint8_t harp_version_major, uint8_t harp_version_minor,
+                         uint8_t fw_version_major, uint8_t fw_version_minor,
+                         uint16_t serial_number, const char name[],
+                         const uint8_t tag[], RegStruct& app_regs)
+    {
+        static HarpApp app(who_am_i, hw_version_major, hw_version_minor,
+                           assembly_version,
+                           harp_version_major, harp_version_minor,
+                           fw_version_major, fw_version_minor, serial_number,
+                           name, tag, app_regs);
+        return app;
+    }
+
+    static inline HarpApp* self = nullptr; // pointer to the singleton instance.
+    static HarpApp& instance() {return *self;} ///< returns the singleton.
+
+/**
+ * \brief Periodically handle tasks based on the current time, state,
+ *      and inputs. Should be called in a loop. Same as HarpCore::run(), but
+ *      the app's functions are called directly.
+ */
+    void run()
+    {run_as(*this);}
+
+private:
+    friend class HarpCore; // so that run_as() can call the functions below.
+
+/**
+ * \brief entry point for handling incoming harp messages to app registers.
+ *  Implements virtual member fn in base class of the same name.
+ */
+    void handle_buffered_app_message()
+    {
+        msg_t msg = get_buffered_msg();
+        // Ignore out-of-range msgs.
+        if (msg.header.address < APP_REG_START_ADDRESS ||
+            msg.header.address >= (APP_REG_START_ADDRESS + reg_count))
+            return;
+        dispatch(msg, msg.header.address - APP_REG_START_ADDRESS,
+                 std::make_index_sequence<reg_count>{});
+        clear_msg();
+    }
+
+/**
+ * \brief update app state. Implements virtual member fn in base class of the
+ *  same name.
+ */
+    void update_app_state()
+    {Handlers::update();}
+
+/**
+ * \brief Reset the app state. Implements virtual member fn in base class of
+ *  the same name.
+ */
+    void reset_app()
+    {Handlers::reset();}
+
+/**
+ * \brief send one harp reply read message per app register.
+ *  Implements virtual member fn in base class of the same name.
+ */
+    void dump_app_registers()
+    {dump(std::make_index_sequence<reg_count>{});}
+
+/**
+ * \brief return app address's specs from the specified register address.
+ *  Implements virtual member fn in base class of the same name.
+ */
+    RegSpecs address_to_app_reg_specs(uint8_t address)
+    {return Handlers::reg_layouts[address - APP_REG_START_ADDRESS]
+                .specs(app_regs_);}
+
+/**
+ * \brief call the handler of the app register at \p index.
+ */
+    template <size_t... I>
+    static inline void dispatch(msg_t& msg, uint8_t index,
+                                std::index_sequence<I...>)
+    {((index == I && (handle<I>(msg), true)) || ...);}
+
+/**
+ * \brief call the handler of the app register at index \p I.
+ */
+    template <size_t I>
+    static inline void handle(msg_t& msg)
+    {
+        constexpr RegFnPair fns = Handlers::reg_fns[I];
+        switch (msg.header.type)
+        {
+            case READ:
+                if constexpr (fns.read_fn_ptr == &HarpCore::read_reg_generic)
+                    send_reg<I>(READ);
+                else
+                    fns.read_fn_ptr(msg.header.address);
+                break;
+            case WRITE:
+                if constexpr (fns.write_fn_ptr == &HarpCore::write_reg_generic)
+                    write_reg<I>(msg);
+                else
+                    fns.write_fn_ptr(msg);
+                break;
+            default:
+                break;
+        }
+    }
+
+/**
+ * \brief send the contents of the app register at index \p I. Equivalent to
+ *  HarpCore::send_harp_reply(reply_type, address).
+ */
+    template <size_t I>
+    static inline void send_reg(msg_type_t reply_type)
+    {
+        constexpr RegLayout layout = Handlers::reg_layouts[I];
+        send_harp_reply(reply_type, APP_REG_START_ADDRESS + I,
+                        (volatile uint8_t*)app_regs_ + layout.offset,
+                        layout.num_bytes, layout.payload_type);
+    }
+
+/**
+ * \brief write the message payload to the app register at index \p I and
+ *  reply. Equivalent to HarpCore::write_reg_generic().
+ */
+    template <size_t I>
+    static inline void write_reg(msg_t& msg)
+    {
+        constexpr RegLayout layout = Handlers::reg_layouts[I];
+        memcpy((uint8_t*)app_regs_ + layout.offset, msg.payload,
+               layout.num_bytes);
+        if (is_muted())
+            return;
+        send_reg<I>(WRITE);
+    }
+
+    template <size_t... I>
+    static inline void dump(std::index_sequence<I...>)
+    {(send_reg<I>(READ), ...);}
+
+    static inline RegStruct* app_regs_ = nullptr; ///< the app registers.
+};
+
+#endif // HARP_APP_H
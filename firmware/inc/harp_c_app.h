@@ -18,11 +18,17 @@ private:
 /**
  * \brief constructor
  * \param app_reg_values pointer to struct containing registers.
- * \param app_reg_specs array of reg specs, indexed by app register address.
+ * \param app_reg_specs array of reg specs, indexed by app register address,
+ *  or nullptr if \p app_reg_layouts is provided.
+ * \param app_reg_layouts array of reg layouts within \p app_reg_values,
+ *  indexed by app register address, or nullptr if \p app_reg_specs is
+ *  provided.
  * \param app_register_count number of app registers
  * \param reg_fns array of RegFnPairs {read fn ptr, write fn ptr}, indexed by
  *  register address.
- * \param app_reg_count number of app registers.
+ * \param app_reg_count number of app registers, at most #MAX_APP_REG_COUNT.
+ *  The constructor panics if there are more, since they would overlap the
+ *  diagnostics registers.
  * \param update_fn pointer to function that will be called periodically to
  *  update the app state.
  * \param reset_fn pointer to function that will reset the app state.
@@ -35,6 +41,7 @@ private:
              uint16_t serial_number, const char name[],
              const uint8_t tag[],
              void* app_reg_values, RegSpecs* app_reg_specs,
+             const RegLayout* app_reg_layouts,
              RegFnPair* reg_fns, size_t app_reg_count,
              void (* update_fn)(void), void (* reset_fn)(void));
 
@@ -59,6 +66,30 @@ public:
                           RegFnPair* reg_fns, size_t app_reg_count,
                           void (* update_fn)(void), void (*reset_fn)(void));
 
+/**
+ * \brief initialize the harp core app singleton with parameters and init
+ *  Tinyusb, where app registers are described by a `constexpr` table of
+ *  layouts built with REG_LAYOUT() instead of a table of RegSpecs.
+ * Usage:
+ * \code
+ *  constexpr RegLayout app_reg_layouts[]
+ *  {
+ *      REG_LAYOUT(app_regs_t, test_byte),
+ *      REG_LAYOUT(app_regs_t, test_uint)
+ *  };
+ * \endcode
+ */
+    static HarpCApp& init(uint16_t who_am_i,
+                          uint8_t hw_version_major, uint8_t hw_version_minor,
+                          uint8_t assembly_version,
+                          uint8_t harp_version_major, uint8_t harp_version_minor,
+                          uint8_t fw_version_major, uint8_t fw_version_minor,
+                          uint16_t serial_number, const char name[],
+                          const uint8_t tag[],
+                          void* app_reg_values, const RegLayout* app_reg_layouts,
+                          RegFnPair* reg_fns, size_t app_reg_count,
+                          void (* update_fn)(void), void (*reset_fn)(void));
+
     static inline HarpCApp* self = nullptr; // pointer to the singleton instance.
     static HarpCApp& instance() {return *self;} ///< returns the singleton.
 
@@ -95,12 +126,18 @@ private:
  *  and APP_REG_START_ADDRESS is the first app register.
  * \details used in Harp Core to extract specs for a particular app register.
  */
-    const RegSpecs& address_to_app_reg_specs(uint8_t address)
-    {return reg_specs_[address - APP_REG_START_ADDRESS];}
+    RegSpecs address_to_app_reg_specs(uint8_t address)
+    {
+        uint8_t app_reg_address = address - APP_REG_START_ADDRESS;
+        if (reg_layouts_ != nullptr)
+            return reg_layouts_[app_reg_address].specs(reg_values_);
+        return reg_specs_[app_reg_address];
+    }
 
 // Private Members
     void* reg_values_;
     RegSpecs* reg_specs_;
+    const RegLayout* reg_layouts_;
     RegFnPair* reg_fns_;
     size_t reg_count_;
     void (* update_fn_)(void);
@@ -0,0 +1,167 @@
+#ifndef HARP_CLOCK_OUTPUT_H
+#define HARP_CLOCK_OUTPUT_H
+#include <stdint.h>
+#include <pico/stdlib.h>
+#include <hardware/uart.h>
+#include <hardware/gpio.h>
+#include <hardware/sync.h>
+#include <hardware/timer.h>
+#include <harp_synchronizer.h>
+#include <harp_sync_encoder.h>
+
+#define HARP_CLOCK_OUTPUT_START_OFFSET_US \
+    (HARP_SYNC_PACKET_END_US + HARP_SYNC_PACKET_US) // time (in [us]) from
+                                  // the first start bit of a sync packet to
+                                  // the second that it marks.
+#define HARP_CLOCK_OUTPUT_REARM_US (2000) // packets further away (in [us])
+                                          // than this get a coarse alarm that
+                                          // re-arms closer in, so that their
+                                          // start follows the latest Harp
+                                          // time.
+#define HARP_CLOCK_OUTPUT_MIN_LEAD_US (50) // the next packet starts at least
+                                           // this long (in [us]) after it is
+                                           // scheduled.
+#define HARP_CLOCK_OUTPUT_MAX_LATE_US (20) // packets whose alarm runs later
+                                           // than this (in [us], two bits) are
+                                           // skipped rather than sent with the
+                                           // wrong timing.
+
+// Clock output that regenerates the Harp clock synchronizer's sync stream
+//  on a uart TX pin from the device's own Harp time. Singleton.
+class HarpClockOutput
+{
+public:
+/**
+ * \brief when the clock output sends sync packets.
+ */
+    enum Mode
+    {
+        OFF, ///< never.
+        REPEAT, ///< only while the Harp time is synchronized to an input.
+        GENERATE ///< always. The device is the clock source.
+    };
+
+/**
+ * \brief the Harp time that the clock output follows.
+ */
+    struct TimeSource
+    {
+        uint64_t (*harp_time_us_64)(); ///< current Harp time.
+        uint64_t (*harp_to_system_us_64)(uint64_t); ///< Harp to system time.
+        bool (*is_synced)(); ///< whether the Harp time follows an input.
+    };
+
+private:
+    // Make constructor/destructor private.
+    HarpClockOutput(uart_inst_t* uart_id, uint8_t uart_tx_pin);
+    ~HarpClockOutput();
+public:
+    // Disable default constructor, copy constructor, and assignment operator.
+    HarpClockOutput() = delete;
+    HarpClockOutput(HarpClockOutput& other) = delete;
+    void operator=(const HarpClockOutput& other) = delete;
+
+/**
+ * \brief init the HarpClockOutput singleton and return a reference to it.
+ * \details Sends on \p uart_tx_pin at the synchronizer's baud rate and
+ *  format. The uart may be the synchronizer's own uart (whose TX half is
+ *  otherwise unused), in which case its setup is left as is.
+ * \note Claims one hardware alarm, whose interrupt runs on the calling core.
+ *  Starts OFF, following the system time until set_time_source() is called.
+ */
+    static HarpClockOutput& init(uart_inst_t* uart, uint8_t uart_tx_pin);
+
+/**
+ * \brief return a reference to the one-and-only instance.
+ * \warning init() must be called first.
+ */
+    static HarpClockOutput& instance(){return *self;}
+
+/**
+ * \brief set the Harp time that packets are timed from.
+ * \note HarpCore::set_clock_output() sets this to HarpCore's Harp time.
+ */
+    static void set_time_source(const TimeSource& source);
+
+/**
+ * \brief set when sync packets are sent.
+ * \details Each packet is scheduled with a hardware alarm at its start in
+ *  system time. Packets further away first get a coarse alarm
+ *  #HARP_CLOCK_OUTPUT_REARM_US ahead that converts their start again, so
+ *  that rate corrections and steps to the Harp time in between are
+ *  followed. A packet whose alarm runs more than
+ *  #HARP_CLOCK_OUTPUT_MAX_LATE_US late (i.e: because the Harp time stepped
+ *  forward) is skipped.
+ */
+    static void set_mode(Mode mode);
+
+    static inline Mode mode()
+    {return self->mode_;}
+
+/**
+ * \brief number of sync packets sent since init().
+ */
+    static inline uint32_t sent_count()
+    {return self->sent_count_;}
+
+/**
+ * \brief number of sync packets skipped for running late since init().
+ */
+    static inline uint32_t skipped_count()
+    {return self->skipped_count_;}
+
+private:
+/**
+ * \brief a pointer to the one-and-only instance or nullptr if init() was
+ *      never called.
+ */
+    static inline HarpClockOutput* self = nullptr;
+
+/**
+ * \brief Callback fn for the hardware alarm. Sends the packet if it is due
+ *  and schedules the next one.
+ * \note Interrupt callbacks must be static, so this fn uses the self ptr
+ *      to access the singleton data members.
+ */
+    static void alarm_callback(uint alarm_num);
+
+/**
+ * \brief pick the next packet from the current Harp time and arm the alarm
+ *  for it (or for its coarse alarm).
+ */
+    void arm_packet();
+
+/**
+ * \brief send the packet for #next_seconds_ if the mode allows and it is on
+ *  time.
+ */
+    void send_packet();
+
+/**
+ * \brief default time source: the system time, never synchronized.
+ */
+    static uint64_t system_time_us_64(){return ::time_us_64();}
+    static uint64_t system_to_system_us_64(uint64_t time_us){return time_us;}
+    static bool never_synced(){return false;}
+
+    uart_inst_t* uart_id_;
+    uint alarm_num_;
+    TimeSource source_;
+    volatile Mode mode_;
+
+/**
+ * \brief second marked by the next packet.
+ */
+    uint32_t next_seconds_;
+
+/**
+ * \brief true if the armed alarm is the next packet's start rather than
+ *  its coarse alarm.
+ */
+    bool send_pending_;
+
+    volatile uint32_t sent_count_;
+    volatile uint32_t skipped_count_;
+};
+
+#endif // HARP_CLOCK_OUTPUT_H
@@ -4,7 +4,11 @@
 #include <harp_message.h>
 #include <core_registers.h>
 #include <harp_synchronizer.h>
+#include <harp_clock_output.h>
+#include <harp_profiler.h>
 #include <arm_regs.h>
+#include <spsc_queue.h>
+#include <mpsc_queue.h>
 #include <cstring> // for memcpy
 #include <tusb.h>
 
@@ -12,8 +16,11 @@
 #include <hardware/structs/timer.h>
 #include <pico/divider.h> // for fast hardware division with remainder.
 #include <hardware/timer.h>
+#include <pico/time.h> // for the default alarm pool.
 #include <pico/unique_id.h>
 #include <pico/bootrom.h>
+#include <pico/multicore.h>
+#include <hardware/irq.h>
 
 #define HARP_VERSION_MAJOR (0)
 #define HARP_VERSION_MINOR (0)
@@ -26,11 +33,107 @@
                                         // to IDLE.
 #define HEARTBEAT_ACTIVE_INTERVAL_US (1'000'000UL)
 #define HEARTBEAT_STANDBY_INTERVAL_US (3'000'000UL)
+#define HEARTBEAT_ALARM_MIN_DELAY_US (10UL) // Lead time given to a heartbeat
+                                            // alarm that is already due, so
+                                            // that the alarm pool fires it.
+#define RX_RING_SIZE (512) // Must be a power of two that fits at least two
+                          // max-size messages.
+#define RX_TIMEOUT_US (10'000UL) // Max time to wait for the rest of a partially
+                                // received message before discarding it.
+#define RX_MSG_QUEUE_DEPTH (4) // Max complete messages buffered between the
+                               // CDC RX interrupt and run(). Power of two.
+#define MAX_MSGS_PER_RUN (8) // Default limit on messages dispatched per run()
+                             // so that app updates are not starved.
+#define TX_FLUSH_MAX_LATENCY_US (1'000UL) // Default max time outgoing data
+                                          // waits in the TX FIFO under the
+                                          // FLUSH_ON_DEADLINE policy.
+#define TX_STALL_TIMEOUT_US (10'000UL) // Max time to wait for room in the TX
+                                     // FIFO for a whole outgoing message
+                                     // before dropping it.
+#define APP_MSG_QUEUE_DEPTH (8) // Max app register messages waiting for core0
+                                // in dual-core mode. Power of two.
+#define APP_TX_QUEUE_DEPTH (8) // Max outgoing messages from core0 waiting for
+                               // core1 in dual-core mode. Power of two.
+#define EVENT_QUEUE_DEPTH (32) // Max events queued with queue_harp_event()
+                               // waiting for run(). Power of two.
+#define TX_QUEUE_DEPTH (32) // Max queued events waiting for room in the TX
+                           // FIFO. Power of two.
+#define SPEED_STREAM_MAX_REGS (8) // Max registers streamed in SPEED mode.
+#define SPEED_STATE_UPDATE_INTERVAL_US (10'000UL) // How often the connection
+                                                 // and sync state are checked
+                                                 // in SPEED mode. Every run()
+                                                 // otherwise.
+#define EVENT_MAX_PAYLOAD_SIZE (16) // Max payload bytes of a queued event.
+#define RX_CHUNK_LOG_DEPTH (8) // Max reads from the serial port whose arrival
+                               // times are tracked while their bytes wait in
+                               // the rx ring. Power of two.
+
+/**
+ * \brief policy for when outgoing messages queued in TinyUSB's TX FIFO are
+ *  flushed to the PC as a USB packet.
+ * \note TinyUSB always sends a packet as soon as a full packet's worth of
+ *  data is queued, regardless of the policy.
+ */
+enum tx_flush_policy_t: uint8_t
+{
+    FLUSH_PER_MSG = 0,          ///< flush after every message (default).
+    FLUSH_PER_RUN = 1,          ///< flush once at the end of each run().
+    FLUSH_ON_FULL_PACKET = 2,   ///< only send full packets.
+    FLUSH_ON_DEADLINE = 3       ///< flush once the oldest queued data has
+                                ///< waited longer than the max latency.
+};
+
+static_assert(CFG_TUD_CDC_TX_BUFSIZE >= MAX_PACKET_SIZE + 2,
+              "The TX FIFO must fit a whole max-size message.");
+static_assert((HEARTBEAT_ACTIVE_INTERVAL_US % 1'000'000UL == 0)
+              && (HEARTBEAT_STANDBY_INTERVAL_US % 1'000'000UL == 0),
+              "Heartbeats must be a whole number of seconds apart.");
+
+// Register streamed in SPEED mode, with its message header pre-built.
+struct speed_stream_t
+{
+    msg_header_t header;
+    const volatile uint8_t* data;
+};
+
+/**
+ * \brief policy for which queued events are lost when the PC does not read
+ *  them as fast as they are produced and the TX queue is full.
+ * \note every lost event is counted against its register. See
+ *  HarpCore::tx_drop_count().
+ */
+enum tx_overflow_policy_t: uint8_t
+{
+    DROP_NEWEST = 0,        ///< keep what is queued (default).
+    DROP_OLDEST = 1,        ///< make room by dropping the oldest queued event.
+    COALESCE_LATEST = 2     ///< overwrite the newest queued event from the
+                            ///< same register, so each register still sends
+                            ///< its latest value. Drops the newest event if
+                            ///< none is queued.
+};
 
 // Create a typedef to simplify syntax for array of static function ptrs.
 typedef void (*read_reg_fn)(uint8_t reg);
 typedef void (*write_reg_fn)(msg_t& msg);
 
+// Buffer for one complete message.
+struct msg_buffer_t
+{
+    alignas(uint32_t) uint8_t data[MAX_PACKET_SIZE + 2];
+    uint32_t rx_time_us; ///< local system time when the first byte of a
+                         ///< received message was read from the serial port.
+};
+
+// Event captured with queue_harp_event(), waiting to be sent.
+struct queued_event_t
+{
+    uint64_t system_time_us;
+    uint8_t address;
+    uint8_t num_bytes;
+    reg_type_t payload_type;
+    alignas(uint32_t) uint8_t payload[EVENT_MAX_PAYLOAD_SIZE];
+};
+
 // Convenience struct for aggregating an array of fn ptrs to handle each
 // register.
 struct RegFnPair
@@ -84,18 +187,21 @@ public:
  * \brief Periodically handle tasks based on the current time, state,
  *      and inputs. Should be called in a loop. Calls tud_task() and
  *      process_cdc_input().
+ * \details every complete message already received is dispatched, up to
+ *  the limit set with set_max_msgs_per_run().
  */
-    void run();
+    void run()
+    {run_as(*this);}
 
 /**
- * \brief return a reference to the message header in the #rx_buffer_.
+ * \brief return a reference to the header of the buffered message.
  * \warning this should only be accessed if new_msg() is true.
  */
     msg_header_t& get_buffered_msg_header()
-    {return *((msg_header_t*)(&rx_buffer_));}
+    {return *((msg_header_t*)(rx_msg_[get_core_num()]));}
 
 /**
- * \brief return a reference to the message in the #rx_buffer_. Inline.
+ * \brief return a reference to the buffered message. Inline.
  * \warning this should only be accessed if new_msg() is true.
  */
     msg_t get_buffered_msg();
@@ -106,17 +212,32 @@ public:
     RegValues& regs = regs_.regs_;
 
 /**
- * \brief flag indicating whether or not a new message is in the #rx_buffer_.
+ * \brief reference to the struct of sync telemetry reg values.
+ * \note only current right after update_sync_regs().
+ */
+    SyncRegValues& sync_regs = regs_.sync_regs_;
+
+/**
+ * \brief reference to the struct of diagnostics reg values.
+ * \note R_PROFILE is only current right after update_profile_reg().
+ */
+    DiagRegValues& diag_regs = regs_.diag_regs_;
+
+/**
+ * \brief flag indicating whether or not a new message is buffered.
  */
     bool new_msg()
-    {return new_msg_;}
+    {return new_msg_[get_core_num()];}
 
 /**
  * \brief flag that new message has been handled. Inline.
  * \note Does not affect internal behavior.
  */
     void clear_msg()
-    {new_msg_ = false;}
+    {
+        new_msg_[get_core_num()] = false;
+        reply_latency_pending_[get_core_num()] = false;
+    }
 
 /**
  * \brief generic handler function to write a message payload to a core or
@@ -229,7 +350,72 @@ public:
                         specs.payload_type, harp_time_us);
     }
 
+/**
+ * \brief Queue a Harp EVENT message to be sent by run(), timestamped with the
+ *  local system time at which it was queued.
+ * \details Unlike send_harp_reply(), this function does not call into
+ *  TinyUSB, so it is safe to call from interrupts and from either core. The
+ *  payload is copied, and the timestamp is converted to Harp time with
+ *  system_to_harp_us_64() when the event is sent.
+ * \param reg_name address to mark the origin point of the data.
+ * \param data pointer to payload content of the data.
+ * \param num_bytes `sizeof(data)`. At most EVENT_MAX_PAYLOAD_SIZE.
+ * \param payload_type `U8`, `S8`, `U16`, `U32`, `U64`, `S64`, or `Float` enum.
+ * \param system_time_us local system time (in microseconds) at which the
+ *  event happened.
+ * \returns false if the event was dropped because the queue was full or the
+ *  payload is too large.
+ */
+    static bool queue_harp_event(uint8_t reg_name, const volatile uint8_t* data,
+                                 uint8_t num_bytes, reg_type_t payload_type,
+                                 uint64_t system_time_us);
+
+/**
+ * \brief Queue a Harp EVENT message to be sent by run(), timestamped now.
+ *  Safe to call from interrupts and from either core.
+ * \param reg_name address to mark the origin point of the data.
+ * \param data pointer to payload content of the data.
+ * \param num_bytes `sizeof(data)`. At most EVENT_MAX_PAYLOAD_SIZE.
+ * \param payload_type `U8`, `S8`, `U16`, `U32`, `U64`, `S64`, or `Float` enum.
+ * \returns false if the event was dropped.
+ */
+    static inline bool queue_harp_event(uint8_t reg_name,
+                                        const volatile uint8_t* data,
+                                        uint8_t num_bytes,
+                                        reg_type_t payload_type)
+    {return queue_harp_event(reg_name, data, num_bytes, payload_type,
+                             time_us_64());}
+
+/**
+ * \brief Queue a Harp EVENT message to be sent by run(), timestamped now,
+ *  where the payload is a snapshot of the specified register.
+ *  Safe to call from interrupts and from either core.
+ * \param reg_name address to mark the origin point of the data.
+ * \returns false if the event was dropped.
+ */
+    static inline bool queue_harp_event(uint8_t reg_name)
+    {
+        uint64_t system_time_us = time_us_64(); // Capture this first.
+        const RegSpecs& specs = self->reg_address_to_specs(reg_name);
+        return queue_harp_event(reg_name, specs.base_ptr, specs.num_bytes,
+                                specs.payload_type, system_time_us);
+    }
 
+/**
+ * \brief total number of events dropped because the event queue was full.
+ * \note does not include events lost to the #tx_overflow_policy_t. See
+ *  tx_drop_count().
+ */
+    static uint32_t event_drop_count()
+    {return self->event_queue_.drop_count();}
+
+/**
+ * \brief number of outgoing messages from register \p reg_name that were
+ *  lost: events that did not fit in the event or TX queues, and messages
+ *  dropped after waiting for the TX FIFO.
+ */
+    static uint32_t tx_drop_count(uint8_t reg_name)
+    {return self->tx_drop_counts_[reg_name];}
 
 /**
  * \brief true if the mute flag has been set in the R_OPERATION_CTRL register.
@@ -239,10 +425,11 @@ public:
 
 /**
  * \brief true if the device is synchronized via external CLKIN input.
- * \details true if the device has received and handled at least one
- *  synchronization signal from its external CLKIN input. As implemented, this
- *  function will never return false after synchronizing at least once, but
- *  that may change later.
+ * \details true if synchronization signals are arriving on the external
+ *  CLKIN input. Returns false again if they stop for longer than
+ *  #HARP_SYNC_HOLDOVER_TIMEOUT_US, in which case the synchronizer
+ *  extrapolates the Harp time until they return.
+ *  See HarpSynchronizer::status().
  */
     static inline bool is_synced()
     {
@@ -253,10 +440,47 @@ public:
 
 /**
  * \brief true if the "events enabled" flag has been set in the
- *  R_OPERATION_CTRL register. Equivalent to the device Op Mode being ACTIVE.
+ *  R_OPERATION_CTRL register. Equivalent to the device Op Mode being ACTIVE
+ *  or SPEED.
  */
     static inline bool events_enabled()
-    {return self->get_op_mode() == ACTIVE;}
+    {
+        op_mode_t op_mode = self->get_op_mode();
+        return (op_mode == ACTIVE) || (op_mode == SPEED);
+    }
+
+/**
+ * \brief refresh the sync telemetry registers from the attached
+ *  synchronizer.
+ * \details Without a synchronizer, the status reads UNSYNCED, the error
+ *  estimate and time since lock read UINT32_MAX, and the rest read zero.
+ *  See HarpSynchronizer::stats().
+ */
+    static void update_sync_regs();
+
+/**
+ * \brief refresh R_PROFILE from HarpProfiler with the stats of the phase and
+ *  core selected in R_PROFILE_CTRL.
+ * \details Reads all zeros unless built with HARP_CORE_PROFILE.
+ */
+    static void update_profile_reg();
+
+/**
+ * \brief refresh R_REPLY_LATENCY with the request-to-reply latency
+ *  histogram of both cores.
+ */
+    static void update_reply_latency_reg();
+
+/**
+ * \brief refresh R_TX_STATS with the TX stall and drop counts.
+ */
+    static void update_tx_stats_reg();
+
+/**
+ * \brief refresh R_TX_DROPS with the drop count of the register selected in
+ *  R_TX_DROP_SELECT and the total.
+ */
+    static void update_tx_drops_reg();
 
 /**
  * \brief get the total elapsed microseconds (64-bit) in "Harp" time.
@@ -264,11 +488,25 @@ public:
  *  \f$t_{Harp} = t_{local} - t_{offset} \f$
  * \warning this value is not monotonic and can change at any time if (1) an
  *  external synchronizer is physically connected and operating and (2) this
- *  class instance has configured a synchronizer with set_synchronizer().
+ *  class instance has configured a synchronizer with set_synchronizer(),
+ *  unless the synchronizer is in SLEW mode.
+ *  See HarpSynchronizer::set_clock_mode().
  */
     static inline uint64_t harp_time_us_64()
     {return system_to_harp_us_64(time_us_64());}
 
+/**
+ * \brief get the total elapsed microseconds (32-bit) in "Harp" time.
+ * \details equal to `uint32_t(harp_time_us_64())`, but only reads the lower
+ *  32 bits of the timer and a cached 32-bit offset, both of which are read
+ *  atomically, so it is safe to call from interrupts and hot loops.
+ *  Truncated times wrap around every ~71.6 minutes, so compare them with
+ *  signed differences, i.e: `int32_t(t1 - t0)`, over short intervals.
+ * \warning this value is not monotonic. See harp_time_us_64().
+ */
+    static inline uint32_t harp_time_us_32()
+    {return system_to_harp_us_32(::time_us_32());}
+
 /**
  * \brief get the current elapsed seconds in "Harp" time.
  * \note the returned seconds are rounded down to the most recent second that
@@ -306,7 +544,9 @@ public:
  * \param harp_time_us the current time in microseconds
  */
     static inline uint32_t harp_to_system_us_32(uint64_t harp_time_us)
-    {return uint32_t(harp_to_system_us_64(harp_time_us));}
+    {return (self->sync_ == nullptr)?
+                uint32_t(harp_time_us) + self->offset_us_32_:
+                self->sync_->harp_to_system_us_32(harp_time_us);}
 
 /**
  * \brief convert system time (in 64-bit microseconds) to local system time
@@ -315,8 +555,6 @@ public:
  *  local time domain and then calculating when they happened in Harp time.
  * \note If the synchronizer is attached, the conversion will be in referenced
  *  to the synchronized time.
- * \note A `system_to_harp_us_32()` command does not exist because Harp time
- *  is only available in 64-bit time.
  * \param system_time_us the current system time in microseconds
  */
     static inline uint64_t system_to_harp_us_64(uint64_t system_time_us)
@@ -324,6 +562,19 @@ public:
                 system_time_us - self->offset_us_64_:
                 self->sync_->system_to_harp_us_64(system_time_us);}
 
+/**
+ * \brief convert system time (in 32-bit microseconds) to Harp time (in
+ *  32-bit microseconds).
+ * \details exact modulo 2^32, since truncation commutes with subtraction.
+ *  Useful for short intervals measured in interrupts and hot loops.
+ * \param system_time_us the current system time in microseconds, i.e:
+ *  `time_us_32()`.
+ */
+    static inline uint32_t system_to_harp_us_32(uint32_t system_time_us)
+    {return (self->sync_ == nullptr)?
+                system_time_us - self->offset_us_32_:
+                self->sync_->system_to_harp_us_32(system_time_us);}
+
 /**
  * \brief Override the current Harp time with a specific time.
  * \note useful if a separate entity besides the synchronizer input jack
@@ -335,7 +586,8 @@ public:
     static inline void set_harp_time_us_64(uint64_t harp_time_us)
     {if (self->sync_ != nullptr)
         self->sync_->set_harp_time_us_64(harp_time_us);
-     self->offset_us_64_ = time_us_64() - harp_time_us;}
+     self->offset_us_64_ = time_us_64() - harp_time_us;
+     self->offset_us_32_ = uint32_t(self->offset_us_64_);}
 
 /**
  * \brief attach a synchronizer. If the synchronizer is attached, then calls to
@@ -345,6 +597,135 @@ public:
     static void set_synchronizer(HarpSynchronizer* sync)
     {self->sync_ = sync;}
 
+/**
+ * \brief attach a clock output, which then regenerates the sync stream from
+ *  this device's Harp time as configured by the R_CLOCK_CONFIG register.
+ * \details Sets the REP_ABLE and GEN_ABLE bits. Writing CLK_GEN sends
+ *  packets at all times, so this device can clock others downstream.
+ *  Writing CLK_REP sends packets only while the attached synchronizer (if
+ *  any) is locked. CLK_GEN takes priority if both are written.
+ */
+    static void set_clock_output(HarpClockOutput* clock_output);
+
+/**
+ * \brief set when outgoing messages are flushed to the PC.
+ * \details Coalescing several messages into one USB packet increases
+ *  throughput for devices that stream events. Replies to PC requests (i.e:
+ *  any non-EVENT message) are always flushed by the end of the run()
+ *  iteration that produced them, so request/reply latency is unaffected.
+ * \param policy when to flush queued data.
+ * \param max_latency_us the longest time (in microseconds) that queued
+ *  events may wait under the FLUSH_ON_DEADLINE policy.
+ */
+    static void set_tx_flush_policy(
+        tx_flush_policy_t policy,
+        uint32_t max_latency_us = TX_FLUSH_MAX_LATENCY_US)
+    {
+        self->tx_flush_policy_ = policy;
+        self->tx_max_latency_us_ = max_latency_us;
+    }
+
+/**
+ * \brief select the registers that publish EVENTs while the Op Mode is
+ *  SPEED, and how often.
+ * \details SPEED is a lean streaming mode: each period, every selected
+ *  register is sent with one Harp timestamp and a pre-built header, and the
+ *  batch is flushed at once. Heartbeats stop, and the connection and sync
+ *  state are only checked every #SPEED_STATE_UPDATE_INTERVAL_US. Samples
+ *  that do not fit in the TX FIFO are dropped and counted (see
+ *  tx_drop_count()) rather than waited on. Periods missed while run() was
+ *  busy are skipped, since only the current values matter.
+ *  The PC enters and leaves SPEED through R_OPERATION_CTRL, like ACTIVE.
+ * \param reg_names addresses of existing registers. Copied.
+ * \param reg_count at most #SPEED_STREAM_MAX_REGS.
+ * \param rate_hz batches per second. Zero stops the stream. Rates above
+ *  1[MHz] send one batch per run().
+ * \returns false, leaving the stream unchanged, if there are too many
+ *  registers or one is too large for a timestamped message (over 245
+ *  bytes).
+ */
+    static bool set_speed_stream(const uint8_t* reg_names, uint8_t reg_count,
+                                 uint32_t rate_hz);
+
+/**
+ * \brief set which queued events are lost when the TX queue overflows.
+ * \details Events wait in a TX queue of #TX_QUEUE_DEPTH while TinyUSB's TX
+ *  FIFO is full (i.e: while the PC is not reading), so sending them never
+ *  blocks run(). Streaming devices may prefer DROP_OLDEST or
+ *  COALESCE_LATEST so that the PC receives the most recent data once it
+ *  catches up.
+ */
+    static void set_tx_overflow_policy(tx_overflow_policy_t policy)
+    {self->tx_overflow_policy_ = policy;}
+
+/**
+ * \brief set the maximum number of messages dispatched per call to run().
+ * \details Messages beyond this limit stay buffered until the next run(),
+ *  so a PC that sends many requests at once cannot starve app updates.
+ */
+    static void set_max_msgs_per_run(uint8_t max_msgs)
+    {self->max_msgs_per_run_ = (max_msgs == 0)? 1: max_msgs;}
+
+/**
+ * \brief receive and parse incoming messages from the USB interrupt instead
+ *  of polling for them in run().
+ * \details When enabled, TinyUSB is serviced from a low-priority interrupt
+ *  that is triggered by USB activity. The CDC RX callback parses complete
+ *  messages into a lock-free queue, and run() only pulls parsed messages
+ *  from that queue, so messages are received even while the app's update
+ *  function is busy. Outgoing messages briefly mask the interrupt while
+ *  writing to TinyUSB.
+ * \note should be called before the first call to run().
+ * \note On the host build, there is no USB interrupt, so TinyUSB is still
+ *  serviced by run(), but messages are received through the same queue.
+ */
+    static void set_cdc_rx_irq_enabled(bool enabled);
+
+/**
+ * \brief hand the USB stack, message parsing, core register handling,
+ *  timestamping and message transmission over to core1.
+ * \details In dual-core mode, core1 services TinyUSB and the core registers
+ *  in a loop of its own, so heavy app work cannot delay core register
+ *  replies or heartbeats. Messages to app registers are forwarded to core0
+ *  through a lock-free queue, and run() (called from core0) only updates the
+ *  app and handles those messages. Messages that core0 sends are assembled
+ *  on core0 and handed back to core1 through a second lock-free queue.
+ * \note should be called once from core0 before the first call to run().
+ *  Disables receiving messages from the USB interrupt.
+ * \warning in dual-core mode, send_harp_reply() may only be called from
+ *  core0's main context or from core1, since the outgoing queue only
+ *  supports one producer. It blocks while that queue is full. Interrupts
+ *  should use queue_harp_event() instead.
+ * \note replies to core and app registers may be reordered relative to each
+ *  other, but the order within each is preserved.
+ */
+    static void launch_core1();
+
+/**
+ * \brief true if the USB/protocol engine runs on core1.
+ */
+    static bool dual_core_enabled()
+    {return self->dual_core_enabled_;}
+
+/**
+ * \brief total number of received bytes discarded because they did not
+ *  belong to a valid message.
+ */
+    static uint32_t rx_discarded_byte_count()
+    {return self->rx_discarded_byte_count_;}
+
+/**
+ * \brief total number of received messages that failed their checksum.
+ */
+    static uint32_t rx_checksum_error_count()
+    {return self->rx_checksum_error_count_;}
+
+/**
+ * \brief total number of times a partially received message timed out.
+ */
+    static uint32_t rx_timeout_count()
+    {return self->rx_timeout_count_;}
+
 /**
  * \brief attach a callback function to control external visual indicators
  *  (i.e: LEDs).
@@ -381,6 +762,15 @@ public:
     }
 
 protected:
+/**
+ * \brief implementation of run() where the app's update and message handler
+ *  functions are called through \p app.
+ * \details if \p App is a `final` derived class, these calls are resolved
+ *  at compile time and can be inlined. Otherwise, they are virtual calls.
+ */
+    template <typename App>
+    void run_as(App& app);
+
 /**
  * \brief entry point for handling incoming harp messages to core registers.
  *      Dispatches message to the appropriate handler.
@@ -423,13 +813,32 @@ protected:
  */
     virtual void dump_app_registers(){};
 
-    virtual const RegSpecs& address_to_app_reg_specs(uint8_t address)
-    {return regs_.address_to_specs[0];} // should never happen.
+    virtual RegSpecs address_to_app_reg_specs(uint8_t /*address*/)
+    {return regs_.address_to_specs(0);} // should never happen.
+
+/**
+ * \brief flags indicating whether or not a new message is buffered, one per
+ *  core.
+ */
+    bool new_msg_[2];
+
+/**
+ * \brief local system time when the first byte of the buffered message was
+ *  read from the serial port, one per core.
+ */
+    uint32_t rx_msg_time_us_[2];
+
+/**
+ * \brief flags indicating that the buffered message has not been replied to
+ *  yet, one per core. The first reply records its latency.
+ */
+    bool reply_latency_pending_[2];
 
 /**
- * \brief flag indicating whether or not a new message is in the #rx_buffer_.
+ * \brief request-to-reply latency histogram, one per core so that each core
+ *  records without a lock. See #REPLY_LATENCY_BIN_COUNT.
  */
-    bool new_msg_;
+    volatile uint32_t reply_latency_bins_[2][REPLY_LATENCY_BIN_COUNT];
 
 /**
  * \brief function pointer to function that enables/disables visual indicators.
@@ -441,41 +850,166 @@ protected:
  */
     HarpSynchronizer* sync_;
 
+/**
+ * \brief pointer to clock output if configured.
+ */
+    HarpClockOutput* clock_output_;
+
 private:
 /**
- * \brief recompute the next heartbeat event time based on the current time.
- */
-    static inline void update_next_heartbeat_from_curr_harp_time_us(
-        uint64_t curr_harp_time_us)
-    {
-        // Recompute next whole second (in [us]) based on synchronized time.
-        // Round *up* to the nearest whole second.
-#if defined(PICO_RP2040) // Invoke pico-specific fast-integer-division hardware.
-        uint64_t remainder;
-        uint64_t quotient = divmod_u64u64_rem(curr_harp_time_us, 1'000'000ULL,
-                                              &remainder);
- #else
-        uint64_t remainder = curr_harp_time_us % 1'000'000ULL;
- #endif
-        self->next_heartbeat_time_us_ =
-            harp_to_system_us_32(curr_harp_time_us - remainder)
-            + self->heartbeat_interval_us_;
-    }
+ * \brief recompute the next heartbeat from the current Harp time and re-arm
+ *  its alarm.
+ * \details the next heartbeat falls on a whole Harp second, one heartbeat
+ *  interval after the current one.
+ */
+    static void update_next_heartbeat_from_curr_harp_time_us(
+        uint64_t curr_harp_time_us);
+
+/**
+ * \brief (re)arm the heartbeat alarm for #next_heartbeat_seconds_.
+ * \details if that time already passed, the alarm fires as soon as possible
+ *  from the alarm pool, on core0, rather than from the caller.
+ */
+    static void arm_heartbeat_alarm();
+
+/**
+ * \brief Callback fn for the heartbeat alarm. Queues the periodic core
+ *  events timestamped exactly at the heartbeat's second boundary, then
+ *  reschedules itself for the next one.
+ * \details If the Harp time slewed since the alarm was armed, so that the
+ *  boundary is still ahead, the alarm is rescheduled for the remainder. If
+ *  the Harp time stepped, the next heartbeat is recomputed from the new time
+ *  without sending. An alarm that was replaced while firing does nothing.
+ * \returns the delay until the next heartbeat, for the alarm pool to
+ *  reschedule the alarm with (so a late alarm never recurses).
+ */
+    static int64_t heartbeat_alarm_callback(alarm_id_t id, void* user_data);
+
+/**
+ * \brief queue the heartbeat of Harp second \p seconds (if enabled) and any
+ *  due sync telemetry events, timestamped at \p system_time_us.
+ * \note called from the heartbeat alarm interrupt.
+ */
+    static void queue_core_events(uint32_t seconds, uint64_t system_time_us);
+
+/**
+ * \brief ring buffer to contain data read from the serial port.
+ */
+    uint8_t rx_ring_[RX_RING_SIZE];
+
+/**
+ * \brief free-running #rx_ring_ index where the next incoming byte will be
+ *  written.
+ */
+    uint16_t rx_ring_head_;
+
+/**
+ * \brief free-running #rx_ring_ index of the first byte that has not yet been
+ *  parsed into a message.
+ */
+    uint16_t rx_ring_tail_;
+
+/**
+ * \brief pointers to the start of the buffered message, one per core.
+ *  Points into the #rx_ring_ unless the message wraps around its end, in
+ *  which case the message is copied to the #rx_buffer_. In dual-core mode,
+ *  core0's points into the #app_msg_queue_.
+ */
+    uint8_t* rx_msg_[2];
+
+/**
+ * \brief start of a whole second in Harp time.
+ */
+    struct second_cache_t
+    {
+        uint64_t start_us; ///< Harp time of the start of the second.
+        uint32_t seconds; ///< Harp time in whole seconds.
+    };
+
+/**
+ * \brief most recent whole second computed by harp_time_to_seconds(), one
+ *  per core.
+ */
+    second_cache_t second_cache_[2];
+
+/**
+ * \brief buffer to contain a message that wraps around the end of the
+ *  #rx_ring_.
+ */
+    uint8_t rx_buffer_[MAX_PACKET_SIZE + 2];
+
+/**
+ * \brief maximum number of messages dispatched per call to run().
+ */
+    uint8_t max_msgs_per_run_;
+
+/**
+ * \brief local system time when bytes were last read from the serial port.
+ */
+    uint32_t rx_last_byte_time_us_;
+
+/**
+ * \brief end (in #rx_ring_ indices) and arrival time of a read from the
+ *  serial port whose bytes are still in the #rx_ring_.
+ */
+    struct rx_chunk_t
+    {
+        uint16_t end; ///< free-running #rx_ring_ index past its last byte.
+        uint32_t time_us; ///< local system time when it was read.
+    };
+
+/**
+ * \brief log of reads from the serial port, oldest first, so that each
+ *  message can be stamped with the arrival time of its first byte.
+ * \note If the log fills up, later reads are merged into the newest entry,
+ *  which overstates their latency.
+ */
+    rx_chunk_t rx_chunks_[RX_CHUNK_LOG_DEPTH];
+    uint8_t rx_chunk_head_; ///< free-running #rx_chunks_ write index.
+    uint8_t rx_chunk_tail_; ///< free-running #rx_chunks_ read index.
+
+/**
+ * \brief total number of received bytes that were discarded.
+ */
+    uint32_t rx_discarded_byte_count_;
+
+/**
+ * \brief total number of received messages that failed their checksum.
+ */
+    uint32_t rx_checksum_error_count_;
+
+/**
+ * \brief total number of times a partially received message timed out.
+ */
+    uint32_t rx_timeout_count_;
+
+/**
+ * \brief return the byte at \p index bytes past the #rx_ring_ tail.
+ */
+    inline uint8_t rx_ring_peek(uint16_t index)
+    {return rx_ring_[(rx_ring_tail_ + index) & (RX_RING_SIZE - 1)];}
+
 /**
- * \brief the total number of bytes read into the the msg receive buffer.
- *  This is implemented as a read-only reference to the #rx_buffer_index_.
+ * \brief true if the (possibly partial) message at the #rx_ring_ tail could
+ *  be the start of a valid PC-to-device message.
+ * \param bytes_buffered number of bytes in the #rx_ring_.
+ * \details only checks the header bytes that have arrived so far.
  */
-    const uint8_t& total_bytes_read_;
+    bool rx_ring_msg_is_plausible(uint16_t bytes_buffered);
 
 /**
- * \brief buffer to contain data read from the serial port.
+ * \brief true if the checksum of the \p msg_size byte message at the #rx_ring_
+ *  tail matches its contents.
  */
-    uint8_t rx_buffer_[MAX_PACKET_SIZE];
+    bool rx_ring_msg_checksum_ok(uint16_t msg_size);
 
 /**
- * \brief #rx_buffer_ index where the next incoming byte will be written.
+ * \brief word-aligned scratch buffer where outgoing messages are assembled
+ *  so that they can be handed to TinyUSB in a single write.
+ * \note sized to fit the largest message (257 bytes) rounded up to a whole
+ *  number of words.
  */
-    uint8_t rx_buffer_index_;
+    alignas(uint32_t) static inline uint8_t tx_buffer_[MAX_PACKET_SIZE + 5];
 
 /**
  * \brief local offset from "Harp time" to device hardware timer tracing
@@ -487,18 +1021,47 @@ private:
     uint64_t offset_us_64_;
 
 /**
- * \brief next time a heartbeat message is scheduled to issue.
- * \note only valid if Op Mode is in the ACTIVE state.
- * \note this value is currently specified in 32-bit local system time
- *  since it is a short interval.
+ * \brief lower 32 bits of #offset_us_64_, which can be read atomically.
+ */
+    volatile uint32_t offset_us_32_;
+
+/**
+ * \brief Harp time, in whole seconds, of the next heartbeat. Guarded by
+ *  #heartbeat_lock_.
+ * \note heartbeats are only sent if Op Mode is in the ACTIVE state.
+ */
+    volatile uint32_t next_heartbeat_seconds_;
+
+/**
+ * \brief id of the armed heartbeat alarm in the default alarm pool, or 0.
+ *  Guarded by #heartbeat_lock_.
+ */
+    volatile alarm_id_t heartbeat_alarm_id_;
+
+/**
+ * \brief true if the heartbeat alarm could not be armed because the alarm
+ *  pool had no free slots. update_state() retries until it succeeds.
+ */
+    volatile bool heartbeat_rearm_pending_;
+
+/**
+ * \brief hardware spin lock guarding the heartbeat alarm, which fires on
+ *  core0 but may be re-armed from core1 in dual-core mode.
+ */
+    spin_lock_t* heartbeat_lock_;
+
+/**
+ * \brief the current interval, in whole seconds, at which
+ *  #next_heartbeat_seconds_ is being updated.
  */
-    uint32_t next_heartbeat_time_us_;
+    uint32_t heartbeat_interval_s_;
 
 /**
- * \brief the current interval at which the \p next_neartbeat_time_us_ is being
- * updated.
+ * \brief ACTIVE heartbeats left until the sync telemetry registers are sent
+ *  as events.
+ * \note only valid if R_SYNC_EVENT_PERIOD is nonzero.
  */
-    uint32_t heartbeat_interval_us_;
+    volatile uint8_t sync_event_countdown_s_;
 
 /**
  * \brief last time device detects no connection with the PC in microseconds.
@@ -527,12 +1090,379 @@ private:
     bool sync_handled_;
 
 /**
- * \brief Read incoming bytes from the USB serial port. Does not block.
+ * \brief when outgoing messages are flushed to the PC.
+ */
+    tx_flush_policy_t tx_flush_policy_;
+
+/**
+ * \brief longest time (in microseconds) queued events may wait under the
+ *  FLUSH_ON_DEADLINE policy.
+ */
+    uint32_t tx_max_latency_us_;
+
+/**
+ * \brief local system time when data was first queued since the last flush.
+ * \note only valid if #tx_pending_ is true.
+ */
+    uint32_t tx_pending_start_time_us_;
+
+/**
+ * \brief true if messages have been queued since the last flush.
+ */
+    bool tx_pending_;
+
+/**
+ * \brief true if a reply to a PC request has been queued since the last flush.
+ */
+    bool tx_reply_pending_;
+
+/**
+ * \brief true after an outgoing message was dropped, until one fits in the
+ *  TX FIFO again. Messages that do not fit meanwhile are dropped without
+ *  waiting.
+ */
+    bool tx_stalled_;
+
+/**
+ * \brief number of outgoing messages that had to wait for room in the TX
+ *  FIFO.
+ */
+    volatile uint32_t tx_stall_count_;
+
+/**
+ * \brief number of outgoing messages dropped because the TX FIFO did not
+ *  free up within #TX_STALL_TIMEOUT_US.
+ */
+    volatile uint32_t tx_drop_count_;
+
+/**
+ * \brief dispatch the buffered message to the core or \p app handler
+ *  functions and clear it.
+ */
+    template <typename App>
+    void handle_buffered_message_as(App& app);
+
+#ifdef DEBUG_HARP_MSG_IN
+/**
+ * \brief print the fields of the buffered message.
+ */
+    void print_buffered_msg();
+#endif
+
+/**
+ * \brief flush queued outgoing messages if the #tx_flush_policy_ requires it.
+ *  Called once at the end of every run().
+ */
+    void update_tx_flush();
+
+/**
+ * \brief true if messages are received from the USB interrupt.
+ */
+    volatile bool cdc_rx_irq_enabled_;
+
+/**
+ * \brief complete messages parsed in the CDC RX callback, waiting to be
+ *  dispatched by run().
+ */
+    SpscQueue<msg_buffer_t, RX_MSG_QUEUE_DEPTH> rx_msg_queue_;
+
+/**
+ * \brief true if the USB/protocol engine runs on core1.
+ */
+    volatile bool dual_core_enabled_;
+
+/**
+ * \brief true if core1 has received a request to reset the app that core0
+ *  has yet to carry out.
+ */
+    volatile bool app_reset_pending_;
+
+/**
+ * \brief in dual-core mode, messages to app registers, waiting for core0.
+ */
+    SpscQueue<msg_buffer_t, APP_MSG_QUEUE_DEPTH> app_msg_queue_;
+
+/**
+ * \brief in dual-core mode, complete outgoing messages assembled on core0,
+ *  waiting for core1 to send them.
+ */
+    SpscQueue<msg_buffer_t, APP_TX_QUEUE_DEPTH> app_tx_queue_;
+
+/**
+ * \brief events queued with queue_harp_event(), waiting to be sent.
+ */
+    MpscQueue<queued_event_t, EVENT_QUEUE_DEPTH> event_queue_;
+
+/**
+ * \brief events moved from the #event_queue_ that are waiting for room in
+ *  the TX FIFO. Owned by the caller of send_queued_events().
+ */
+    queued_event_t tx_queue_[TX_QUEUE_DEPTH];
+    uint8_t tx_queue_head_; ///< free-running #tx_queue_ write index.
+    uint8_t tx_queue_tail_; ///< free-running #tx_queue_ read index.
+
+/**
+ * \brief which queued events are lost when the #tx_queue_ is full.
+ */
+    tx_overflow_policy_t tx_overflow_policy_;
+
+/**
+ * \brief lost outgoing messages, per register address. See tx_drop_count().
+ *  Guarded by #tx_drop_lock_.
+ */
+    volatile uint32_t tx_drop_counts_[256];
+
+/**
+ * \brief sum of #tx_drop_counts_. Guarded by #tx_drop_lock_.
+ */
+    volatile uint32_t tx_drop_total_;
+
+/**
+ * \brief hardware spin lock guarding the drop counts, which interrupts and
+ *  both cores update.
+ */
+    spin_lock_t* tx_drop_lock_;
+
+/**
+ * \brief send the events queued with queue_harp_event(), in order, while
+ *  they fit in the TX FIFO. Leaves the rest in the #tx_queue_.
+ * \note moves at most one #event_queue_'s worth per call so that a steady
+ *  stream of events cannot stall the caller.
+ */
+    void send_queued_events();
+
+/**
+ * \brief registers streamed in SPEED mode. See set_speed_stream().
+ */
+    speed_stream_t speed_streams_[SPEED_STREAM_MAX_REGS];
+    uint8_t speed_stream_count_;
+    uint32_t speed_period_us_; ///< zero if the stream is stopped.
+    uint64_t next_speed_stream_us_; ///< local system time of the next batch.
+
+/**
+ * \brief local system time of the last update_state() in SPEED mode.
+ */
+    uint32_t last_state_update_us_;
+
+/**
+ * \brief true if update_state() should run this iteration: always, except
+ *  in SPEED mode, where it runs every #SPEED_STATE_UPDATE_INTERVAL_US.
+ */
+    inline bool state_update_due()
+    {
+        if (regs_.r_operation_ctrl_bits.OP_MODE != SPEED)
+            return true;
+        uint32_t time_us = ::time_us_32();
+        if ((time_us - last_state_update_us_) < SPEED_STATE_UPDATE_INTERVAL_US)
+            return false;
+        last_state_update_us_ = time_us;
+        return true;
+    }
+
+/**
+ * \brief in SPEED mode, send one batch of the selected registers if it is
+ *  due. See set_speed_stream().
+ */
+    void publish_speed_stream();
+
+/**
+ * \brief append \p event to the #tx_queue_, applying the
+ *  #tx_overflow_policy_ if it is full.
+ */
+    void push_tx_event(const queued_event_t& event);
+
+/**
+ * \brief count one lost outgoing message from register \p reg_name.
+ * \note the Cortex-M0+ has no atomic increment, so this takes the
+ *  #tx_drop_lock_ with interrupts disabled. Safe from interrupts and either
+ *  core.
+ */
+    static inline void count_tx_drop(uint8_t reg_name)
+    {
+        uint32_t irq_status = spin_lock_blocking(self->tx_drop_lock_);
+        self->tx_drop_counts_[reg_name] = self->tx_drop_counts_[reg_name] + 1;
+        self->tx_drop_total_ = self->tx_drop_total_ + 1;
+        spin_unlock(self->tx_drop_lock_, irq_status);
+    }
+
+/**
+ * \brief entry point of core1 in dual-core mode. Never returns.
+ */
+    static void core1_main();
+
+/**
+ * \brief one iteration of the core1 loop in dual-core mode. Services
+ *  TinyUSB, sends messages queued by core0, handles core register messages,
+ *  and forwards app register messages to core0.
+ */
+    void run_engine();
+
+/**
+ * \brief core0's part of run() in dual-core mode. Updates the \p app and
+ *  handles the app register messages forwarded by core1.
+ */
+    template <typename App>
+    void run_app_as(App& app);
+
+#if defined(PICO_RP2040)
+/**
+ * \brief low-priority user interrupt that services TinyUSB when
+ *  #cdc_rx_irq_enabled_ is set.
+ */
+    static inline uint usb_task_irq_;
+
+/**
+ * \brief shared USBCTRL_IRQ handler that pends the #usb_task_irq_.
+ */
+    static void usb_irq_handler()
+    {irq_set_pending(usb_task_irq_);}
+
+/**
+ * \brief handler for the #usb_task_irq_.
+ * \note also picks up input left over from previous interrupts.
+ */
+    static void usb_task_irq_handler()
+    {
+        tud_task();
+        self->queue_cdc_input();
+    }
+#endif
+
+/**
+ * \brief true if TinyUSB is serviced by the USB task interrupt rather than
+ *  by calls to tud_task() from the main context.
+ * \note always false on the host, which has no USB interrupt.
+ */
+    static inline bool usb_serviced_by_irq()
+    {
+#if defined(PICO_RP2040)
+        return self->cdc_rx_irq_enabled_;
+#else
+        return false;
+#endif
+    }
+
+/**
+ * \brief trigger the USB task interrupt.
+ */
+    static inline void pend_usb_task_irq()
+    {
+#if defined(PICO_RP2040)
+        irq_set_pending(usb_task_irq_);
+#else
+        self->queue_cdc_input(); // No USB interrupt on the host. Do its work.
+#endif
+    }
+
+/**
+ * \brief prevent the USB interrupt from servicing TinyUSB while the main
+ *  context calls into it.
+ */
+    static inline void lock_usb()
+    {
+#if defined(PICO_RP2040)
+        if (self->cdc_rx_irq_enabled_)
+            irq_set_enabled(usb_task_irq_, false);
+#endif
+    }
+
+/**
+ * \brief undo lock_usb().
+ */
+    static inline void unlock_usb()
+    {
+#if defined(PICO_RP2040)
+        if (self->cdc_rx_irq_enabled_)
+            irq_set_enabled(usb_task_irq_, true);
+#endif
+    }
+
+/**
+ * \brief move every complete message in the #rx_ring_ into the
+ *  #rx_msg_queue_ while there is room.
+ * \note called from the TinyUSB CDC RX callback and the USB task interrupt.
+ */
+    void queue_cdc_input();
+
+/**
+ * \brief buffer the next received message from the #rx_msg_queue_ or, if
+ *  empty and polling, from the serial port.
+ * \returns true if the message came from the #rx_msg_queue_ and must be
+ *  released after it is handled.
+ */
+    bool receive_msg();
+
+/**
+ * \brief TinyUSB CDC RX callback is a friend so that it can call
+ *  queue_cdc_input().
+ */
+    friend void tud_cdc_rx_cb(uint8_t itf);
+
+/**
+ * \brief Read incoming bytes from the USB serial port into the #rx_ring_ and
+ *  buffer the next complete message, if any. Does not block.
  *  \warning If called again before handling previous message in the buffer, the
  *      buffered message may be be overwritten if a new message has arrived.
  */
     void process_cdc_input();
 
+/**
+ * \brief Read as many incoming bytes from the USB serial port as fit into the
+ *  #rx_ring_. Does not block.
+ */
+    void read_cdc_into_rx_ring();
+
+/**
+ * \brief remove the next valid message from the #rx_ring_, discarding any
+ *  invalid bytes in front of it.
+ * \param rx_time_us set to the local system time when the message's first
+ *  byte was read from the serial port.
+ * \returns pointer to the contiguous message or nullptr if no complete
+ *  message has arrived.
+ * \note the message stays intact until the next call to
+ *  read_cdc_into_rx_ring().
+ */
+    uint8_t* pop_rx_ring_msg(uint32_t& rx_time_us);
+
+/**
+ * \brief local system time when the byte at the #rx_ring_ tail was read
+ *  from the serial port. Drops older entries from the #rx_chunks_ log.
+ */
+    uint32_t rx_ring_tail_time_us();
+
+/**
+ * \brief make \p msg the buffered message of the calling core.
+ * \param rx_time_us local system time when its first byte was read from
+ *  the serial port.
+ */
+    inline void set_buffered_msg(uint8_t* msg, uint32_t rx_time_us)
+    {
+        uint8_t core_num = get_core_num();
+        rx_msg_[core_num] = msg;
+        rx_msg_time_us_[core_num] = rx_time_us;
+        reply_latency_pending_[core_num] = true;
+        new_msg_[core_num] = true;
+    }
+
+/**
+ * \brief record the time since the calling core's buffered message arrived
+ *  if this is its first reply.
+ */
+    static void record_reply_latency();
+
+/**
+ * \brief histogram bin of a request-to-reply latency of \p latency_us.
+ * \details Bin 0 counts latencies under 2[us], and bin i > 0 counts
+ *  latencies in [2^i, 2^(i+1)) [us]. The last bin counts the rest.
+ */
+    static constexpr uint8_t reply_latency_bin(uint32_t latency_us)
+    {
+        uint8_t bin = 0;
+        while ((latency_us >>= 1) && bin < REPLY_LATENCY_BIN_COUNT - 1)
+            ++bin;
+        return bin;
+    }
+
 /**
  * \brief update internal state machine.
  * \param force. If true, the state will change to the #forced_next_state.
@@ -558,12 +1488,141 @@ private:
     static void set_timestamp_regs(uint64_t harp_time_us);
 
 /**
- * \brief return a reference to the specified core or app register's specs used
+ * \brief split a Harp time into the representation of the timestamp
+ *  registers: whole seconds and 32-microsecond ticks.
+ */
+    static inline void split_harp_time_us(uint64_t harp_time_us,
+                                          uint32_t& seconds, uint16_t& micros)
+    {
+        uint32_t elapsed_us;
+        seconds = harp_time_to_seconds(harp_time_us, elapsed_us);
+        // Note: R_TIMESTAMP_MICRO can only represent values up to 31249.
+        micros = uint16_t(elapsed_us >> 5);
+    }
+
+/**
+ * \brief convert a Harp time into whole seconds without dividing.
+ * \details the start of the most recent whole second is cached (per core).
+ *  Times within that second or the next one only need a compare and a
+ *  subtract. Otherwise (i.e: after the Harp time is changed), the quotient
+ *  is computed with divide_harp_time_us().
+ * \warning not reentrant. Do not call from interrupts.
+ * \param elapsed_us the microseconds elapsed since the start of the second.
+ * \returns the number of whole seconds.
+ */
+    static inline uint32_t harp_time_to_seconds(uint64_t harp_time_us,
+                                                uint32_t& elapsed_us)
+    {
+        second_cache_t& cache = self->second_cache_[get_core_num()];
+        uint64_t delta_us = harp_time_us - cache.start_us;
+        if (delta_us < 1'000'000ULL)
+        {
+            elapsed_us = uint32_t(delta_us);
+            return cache.seconds;
+        }
+        if (delta_us < 2'000'000ULL)
+        {
+            cache.start_us += 1'000'000ULL;
+            cache.seconds += 1;
+            elapsed_us = uint32_t(delta_us) - 1'000'000UL;
+            return cache.seconds;
+        }
+        return update_second_cache(harp_time_us, elapsed_us);
+    }
+
+/**
+ * \brief recompute the cached whole second for an arbitrary Harp time.
+ *  Slow path of harp_time_to_seconds().
+ */
+    static uint32_t update_second_cache(uint64_t harp_time_us,
+                                        uint32_t& elapsed_us);
+
+/**
+ * \brief convert a Harp time into whole seconds with a reciprocal multiply
+ *  instead of a 64-bit division.
+ * \details stateless, unlike harp_time_to_seconds(), so it is safe to call
+ *  from interrupts.
+ * \param elapsed_us the microseconds elapsed since the start of the second.
+ * \returns the number of whole seconds, truncated to 32 bits.
+ */
+    static uint32_t divide_harp_time_us(uint64_t harp_time_us,
+                                        uint32_t& elapsed_us);
+
+/**
+ * \brief assemble a complete timestamped message into a word-aligned
+ *  \p frame buffer with room for a whole number of words.
+ * \returns the message size in bytes.
+ */
+    static uint16_t assemble_frame(uint8_t* frame, msg_type_t reply_type,
+                                   uint8_t reg_name,
+                                   const volatile uint8_t* data,
+                                   uint8_t num_bytes, reg_type_t payload_type,
+                                   uint32_t seconds, uint16_t micros);
+
+/**
+ * \brief assemble a complete timestamped message with a pre-built \p header
+ *  into a word-aligned \p frame buffer with room for a whole number of words.
+ * \param data the payload, header.payload_length() bytes long.
+ * \returns the message size in bytes.
+ */
+    static uint16_t assemble_frame(uint8_t* frame, msg_header_t header,
+                                   const volatile uint8_t* data,
+                                   uint32_t seconds, uint16_t micros);
+
+/**
+ * \brief hand a complete message to TinyUSB and flush it according to the
+ *  #tx_flush_policy_.
+ * \details Messages are never truncated. If the TX FIFO lacks room for the
+ *  whole message, waits for it with wait_for_tx_space(), and drops the
+ *  message if none frees up. See #tx_stalled_.
+ */
+    static void write_frame(const uint8_t* frame, uint16_t frame_size,
+                            msg_type_t reply_type);
+
+/**
+ * \brief send what is in the TX FIFO and service USB until \p frame_size
+ *  bytes are free, for at most #TX_STALL_TIMEOUT_US.
+ * \returns true if there is room, or false if the time ran out or the PC is
+ *  not connected.
+ * \note Must be called with USB locked. Unlocks it while waiting for the USB
+ *  interrupt.
+ */
+    static bool wait_for_tx_space(uint16_t frame_size);
+
+/**
+ * \brief sum the bytes of a word-aligned buffer four-at-a-time.
+ * \param words buffer to sum. Trailing pad bytes in the last word must be zero.
+ * \param word_count number of 32-bit words to sum.
+ * \returns the sum of all bytes, truncated to 8 bits (i.e: the Harp checksum).
+ */
+    static inline uint8_t checksum_words(const uint32_t* words,
+                                         uint8_t word_count)
+    {
+        // Accumulate byte lanes 0+1 and 2+3 in separate 16-bit halves. Each
+        // half gains at most 510 per word, so the low half only carries into
+        // the high one past 128 words (512 bytes).
+        uint32_t sum = 0;
+        for (uint8_t i = 0; i < word_count; ++i)
+            sum += (words[i] & 0x00FF00FF) + ((words[i] >> 8) & 0x00FF00FF);
+        return uint8_t(sum + (sum >> 16));
+    }
+    static_assert((MAX_PACKET_SIZE + 2 + 3) / 4 <= 128,
+                  "checksum_words() must not overflow its 16-bit halves.");
+
+/**
+ * \brief return the specified core or app register's specs used
  *  for issuing a harp reply for that register.
  * \details address	is the full address range where 0 is the first core
- *  register, and APP_REG_START_ADDRESS is the first app register.
+ *  register, APP_REG_START_ADDRESS is the first app register, and the
+ *  diagnostics and sync telemetry banks follow the app registers from
+ *  DIAG_REG_START_ADDRESS.
  */
-    const RegSpecs& reg_address_to_specs(uint8_t address);
+    inline RegSpecs reg_address_to_specs(uint8_t address)
+    {
+        if (Registers::is_core_address(address))
+            return regs_.address_to_specs(address);
+        return address_to_app_reg_specs(address); // virtual. Implemented by app.
+    }
 
     // core register read handler functions. Handles read operations on those
     // registers. One-per-harp-register where necessary, but read_reg_generic()
@@ -571,6 +1630,11 @@ private:
     // Note: these all need to have the same function signature.
     static void read_timestamp_second(uint8_t reg_name);
     static void read_timestamp_microsecond(uint8_t reg_name);
+    static void read_sync_reg(uint8_t reg_name);
+    static void read_profile(uint8_t reg_name);
+    static void read_reply_latency(uint8_t reg_name);
+    static void read_tx_stats(uint8_t reg_name);
+    static void read_tx_drops(uint8_t reg_name);
 
 
     // write handler function per core register. Handles write
@@ -595,6 +1659,39 @@ private:
     static void write_serial_number(msg_t& msg);
     static void write_clock_config(msg_t& msg);
     static void write_timestamp_offset(msg_t& msg);
+    static void write_sync_event_period(msg_t& msg);
+
+/**
+ * \brief Handle writing to the `R_PROFILE_CTRL` register. Selects the phase
+ *  and core that R_PROFILE reads, and resets the stats of every phase if the
+ *  reset bit is set.
+ * \note Replies with a WRITE_ERROR for a phase that does not exist.
+ */
+    static void write_profile_ctrl(msg_t& msg);
+
+/**
+ * \brief Handle writing to the `R_REPLY_LATENCY` register. Any write resets
+ *  the histogram. The payload is ignored.
+ */
+    static void write_reply_latency(msg_t& msg);
+
+/**
+ * \brief Handle writing to the `R_TX_STATS` register. Any write resets the
+ *  counts. The payload is ignored.
+ */
+    static void write_tx_stats(msg_t& msg);
+
+/**
+ * \brief Handle writing to the `R_TX_DROPS` register. Any write resets the
+ *  drop counts of every register. The payload is ignored.
+ */
+    static void write_tx_drops(msg_t& msg);
+
+/**
+ * \brief queue the sync telemetry registers (except R_SYNC_EVENT_PERIOD) as
+ *  events timestamped at \p system_time_us.
+ */
+    static void queue_sync_events(uint64_t system_time_us);
 
     Registers regs_; ///< struct of Harp core registers
 
@@ -624,6 +1721,134 @@ private:
         {&HarpCore::read_reg_generic, &HarpCore::write_to_read_only_reg_error},
         {&HarpCore::read_reg_generic, &HarpCore::write_to_read_only_reg_error},
     };
+
+/**
+ * \brief Function table containing the read/write handler functions, one pair
+ *  per diagnostics register. Index is the register address minus
+ *  #DIAG_REG_START_ADDRESS.
+ */
+    RegFnPair diag_reg_func_table_[DIAG_REG_COUNT] =
+    {
+        // { <read_fn_ptr>, <write_fn_prt>},
+        {&HarpCore::read_reg_generic, &HarpCore::write_profile_ctrl},
+        {&HarpCore::read_profile, &HarpCore::write_to_read_only_reg_error},
+        {&HarpCore::read_reply_latency, &HarpCore::write_reply_latency},
+        {&HarpCore::read_tx_stats, &HarpCore::write_tx_stats},
+        {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+        {&HarpCore::read_tx_drops, &HarpCore::write_tx_drops},
+    };
+
+/**
+ * \brief Function table containing the read/write handler functions, one pair
+ *  per sync telemetry register. Index is the register address minus
+ *  #SYNC_REG_START_ADDRESS.
+ */
+    RegFnPair sync_reg_func_table_[SYNC_REG_COUNT] =
+    {
+        // { <read_fn_ptr>, <write_fn_prt>},
+        {&HarpCore::read_sync_reg, &HarpCore::write_to_read_only_reg_error},
+        {&HarpCore::read_sync_reg, &HarpCore::write_to_read_only_reg_error},
+        {&HarpCore::read_sync_reg, &HarpCore::write_to_read_only_reg_error},
+        {&HarpCore::read_sync_reg, &HarpCore::write_to_read_only_reg_error},
+        {&HarpCore::read_sync_reg, &HarpCore::write_to_read_only_reg_error},
+        {&HarpCore::read_sync_reg, &HarpCore::write_to_read_only_reg_error},
+        {&HarpCore::read_sync_reg, &HarpCore::write_to_read_only_reg_error},
+        {&HarpCore::read_reg_generic, &HarpCore::write_sync_event_period},
+    };
 };
 
+template <typename App>
+inline void HarpCore::run_as(App& app)
+{
+    if (dual_core_enabled_)
+    {
+        run_app_as(app);
+        return;
+    }
+    HARP_PROFILE_STAMP(run_start);
+    HARP_PROFILE_STAMP(phase_start);
+    if (not usb_serviced_by_irq())
+    {
+        tud_task();
+        HARP_PROFILE_MARK(phase_start, USB_TASK);
+    }
+    if (state_update_due())
+        update_state();
+    HARP_PROFILE_MARK(phase_start, UPDATE_STATE);
+    app.update_app_state(); // Does nothing unless a derived class implements it.
+    HARP_PROFILE_MARK(phase_start, APP_UPDATE);
+    // Dispatch every message that has already arrived, up to a limit.
+    for (uint8_t msg_count = 0; msg_count < max_msgs_per_run_; ++msg_count)
+    {
+        bool msg_is_queued = receive_msg();
+        HARP_PROFILE_MARK(phase_start, RECEIVE);
+        if (not new_msg())
+            break;
+        handle_buffered_message_as(app);
+        HARP_PROFILE_MARK(phase_start, DISPATCH);
+        if (not msg_is_queued)
+            continue;
+        rx_msg_queue_.pop();
+        // Revisit leftover input now that there is room in the queue, even
+        // if no new data arrives to trigger the interrupt.
+        if (rx_ring_head_ != rx_ring_tail_)
+            pend_usb_task_irq();
+    }
+    // Revisit leftover input to time out a partial message.
+    if (cdc_rx_irq_enabled_ && (rx_ring_head_ != rx_ring_tail_))
+        pend_usb_task_irq();
+    HARP_PROFILE_STAMP(tx_start);
+    publish_speed_stream();
+    send_queued_events();
+    update_tx_flush();
+    HARP_PROFILE_MARK(tx_start, TX);
+    HARP_PROFILE_MARK(run_start, RUN);
+}
+
+template <typename App>
+inline void HarpCore::run_app_as(App& app)
+{
+    HARP_PROFILE_STAMP(run_start);
+    if (app_reset_pending_)
+    {
+        app_reset_pending_ = false;
+        app.reset_app();
+    }
+    HARP_PROFILE_STAMP(phase_start);
+    app.update_app_state(); // Does nothing unless a derived class implements it.
+    HARP_PROFILE_MARK(phase_start, APP_UPDATE);
+    for (uint8_t msg_count = 0; msg_count < max_msgs_per_run_; ++msg_count)
+    {
+        msg_buffer_t* app_msg = app_msg_queue_.front();
+        if (app_msg == nullptr)
+            break;
+        set_buffered_msg(app_msg->data, app_msg->rx_time_us);
+        handle_buffered_message_as(app);
+        app_msg_queue_.pop();
+        HARP_PROFILE_MARK(phase_start, DISPATCH);
+    }
+    HARP_PROFILE_MARK(run_start, RUN);
+}
+
+template <typename App>
+inline void HarpCore::handle_buffered_message_as(App& app)
+{
+#ifdef DEBUG_HARP_MSG_IN
+    print_buffered_msg();
+#endif
+    // Handle in-range register msgs and clear them. Ignore out-of-range msgs.
+    handle_buffered_core_message(); // Handle msg. Clear it if handled.
+    if (not new_msg())
+        return;
+    app.handle_buffered_app_message(); // Handle msg. Clear it if handled.
+    // Always clear any unhandled messages, so we don't lock up.
+    if (new_msg())
+    {
+#ifdef DEBUG_HARP_MSG_IN
+    printf("Ignoring out-of-range msg!\r\n");
+#endif
+        clear_msg();
+    }
+}
+
 #endif //HARP_CORE_H
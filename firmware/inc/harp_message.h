@@ -35,10 +35,10 @@ struct msg_header_t
     uint8_t payload_base_index_offset()
     {return has_timestamp()? 11: 5;}
 
-    uint8_t checksum_index_offset()
-    {return 2 + raw_length;}
+    uint16_t checksum_index_offset()
+    {return 1 + raw_length;}
 
-    uint8_t msg_size()
+    uint16_t msg_size()
     {return raw_length + 2;}
 };
 #pragma pack(pop)
@@ -0,0 +1,224 @@
+#ifndef HARP_PROFILER_H
+#define HARP_PROFILER_H
+#include <stdint.h>
+#include <pico/platform.h> // for get_core_num().
+#if defined(HARP_CORE_PROFILE)
+#if defined(PICO_RP2040)
+#include <hardware/regs/addressmap.h> // for PPB_BASE.
+#include <arm_regs.h>
+#else
+#include <chrono>
+#endif
+#endif
+
+#define HARP_PROFILE_CORE_COUNT (2) // cores with separate stats.
+#define HARP_PROFILE_HIST_BINS (8) // histogram bins per phase.
+#define HARP_PROFILE_HIST_FIRST_BITS (8) // the first bin holds durations
+                                         // under 2^8 ticks. Each following
+                                         // bin is 4x wider, and the last one
+                                         // holds the rest.
+#define HARP_PROFILE_TICK_MASK (0x00FFFFFFUL) // ticks wrap at 24 bits, like
+                                              // SysTick, so phases must be
+                                              // shorter than ~134[ms] at
+                                              // 125[MHz].
+
+/**
+ * \brief Optional instrumentation of the phases of HarpCore::run().
+ * \details Each phase's duration is measured in ticks of the core's SysTick
+ *  timer (one tick per processor clock cycle) on the RP2040, or in [ns]
+ *  elsewhere, and kept as a count, min, max, mean, and log-scaled histogram
+ *  that can be read back through the R_PROFILE register.
+ *  Timing is only compiled in if HARP_CORE_PROFILE is defined. Otherwise the
+ *  HARP_PROFILE_*() macros expand to nothing and stats() reads all zeros.
+ * \note Each core keeps its own stats, so recording needs no lock. Stats
+ *  read (or reset) from the other core may be off by one sample.
+ */
+class HarpProfiler
+{
+public:
+/**
+ * \brief phases of run() that are timed separately.
+ * \note With launch_core1(), core1 records USB_TASK, UPDATE_STATE, RECEIVE,
+ *  DISPATCH (of core registers), TX, and RUN (one pass of its loop), and
+ *  core0 records APP_UPDATE, DISPATCH (of app registers), and RUN.
+ */
+    enum Phase: uint8_t
+    {
+        USB_TASK = 0, ///< tud_task().
+        UPDATE_STATE = 1, ///< update_state().
+        APP_UPDATE = 2, ///< the app's update_app_state().
+        RECEIVE = 3, ///< pulling one message from the usb serial port.
+        DISPATCH = 4, ///< handling one message.
+        TX = 5, ///< sending queued events and app messages, and flushing.
+        RUN = 6, ///< one whole call to run().
+        PHASE_COUNT
+    };
+
+/**
+ * \brief duration statistics of one phase since the last reset.
+ * \details Bin i of the histogram counts durations under
+ *  2^(#HARP_PROFILE_HIST_FIRST_BITS + 2i) ticks that did not fit in the bins
+ *  before it. The last bin counts the rest.
+ */
+    struct PhaseStats
+    {
+        uint32_t count;
+        uint32_t min_ticks; ///< zero if count is zero.
+        uint32_t max_ticks;
+        uint32_t mean_ticks;
+        uint32_t histogram[HARP_PROFILE_HIST_BINS];
+    };
+
+    static constexpr bool enabled()
+    {
+#if defined(HARP_CORE_PROFILE)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+/**
+ * \brief start the tick source on the calling core.
+ * \note The SysTick timer is per-core, so each core that records phases must
+ *  call this once.
+ */
+    static inline void init_ticks()
+    {
+#if defined(HARP_CORE_PROFILE) && defined(PICO_RP2040)
+        SYST_RVR = HARP_PROFILE_TICK_MASK;
+        SYST_CVR = 0; // Any write clears it.
+        SYST_CSRbits.CLKSOURCE = 1; // processor clock.
+        SYST_CSRbits.ENABLE = 1;
+#endif
+    }
+
+/**
+ * \brief the current tick count. Counts up and wraps at
+ *  #HARP_PROFILE_TICK_MASK.
+ */
+    static inline uint32_t ticks()
+    {
+#if defined(HARP_CORE_PROFILE) && defined(PICO_RP2040)
+        return (~SYST_CVR) & HARP_PROFILE_TICK_MASK; // SysTick counts down.
+#elif defined(HARP_CORE_PROFILE)
+        return uint32_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count())
+               & HARP_PROFILE_TICK_MASK;
+#else
+        return 0;
+#endif
+    }
+
+/**
+ * \brief record the time elapsed since \p stamp as one sample of \p phase,
+ *  and restart \p stamp from now.
+ */
+    static inline void mark(uint32_t& stamp, Phase phase)
+    {
+        uint32_t now = ticks();
+        record(phase, (now - stamp) & HARP_PROFILE_TICK_MASK);
+        stamp = now;
+    }
+
+/**
+ * \brief add one sample of \p elapsed_ticks to \p phase.
+ */
+    static inline void record(Phase phase, uint32_t elapsed_ticks)
+    {
+#if defined(HARP_CORE_PROFILE)
+        Accumulator& acc = accumulators_[get_core_num()][phase];
+        if (acc.count == 0 || elapsed_ticks < acc.min_ticks)
+            acc.min_ticks = elapsed_ticks;
+        if (elapsed_ticks > acc.max_ticks)
+            acc.max_ticks = elapsed_ticks;
+        acc.total_ticks += elapsed_ticks;
+        ++acc.histogram[bin(elapsed_ticks)];
+        ++acc.count;
+#else
+        (void)phase;
+        (void)elapsed_ticks;
+#endif
+    }
+
+/**
+ * \brief histogram bin of a duration of \p elapsed_ticks.
+ */
+    static constexpr uint8_t bin(uint32_t elapsed_ticks)
+    {
+        uint8_t bits = 0;
+        while (bits < 32 && (elapsed_ticks >> bits))
+            ++bits;
+        if (bits <= HARP_PROFILE_HIST_FIRST_BITS)
+            return 0;
+        uint8_t index = (bits - HARP_PROFILE_HIST_FIRST_BITS + 1) / 2;
+        return (index < HARP_PROFILE_HIST_BINS)?
+                    index: HARP_PROFILE_HIST_BINS - 1;
+    }
+
+/**
+ * \brief write the stats of \p phase recorded on core \p core into
+ *  \p stats. All zeros if profiling is compiled out.
+ */
+    static inline void stats(uint8_t core, Phase phase, PhaseStats& stats)
+    {
+        stats = PhaseStats{};
+#if defined(HARP_CORE_PROFILE)
+        const Accumulator& acc = accumulators_[core][phase];
+        stats.count = acc.count;
+        stats.min_ticks = acc.min_ticks;
+        stats.max_ticks = acc.max_ticks;
+        stats.mean_ticks = acc.count? uint32_t(acc.total_ticks / acc.count): 0;
+        for (uint8_t i = 0; i < HARP_PROFILE_HIST_BINS; ++i)
+            stats.histogram[i] = acc.histogram[i];
+#else
+        (void)core;
+        (void)phase;
+#endif
+    }
+
+/**
+ * \brief clear the stats of every phase on both cores.
+ */
+    static inline void reset()
+    {
+#if defined(HARP_CORE_PROFILE)
+        for (Accumulator (&core_accs)[PHASE_COUNT]: accumulators_)
+            for (Accumulator& acc: core_accs)
+                acc = Accumulator{};
+#endif
+    }
+
+private:
+#if defined(HARP_CORE_PROFILE)
+    struct Accumulator
+    {
+        uint32_t count;
+        uint32_t min_ticks;
+        uint32_t max_ticks;
+        uint64_t total_ticks;
+        uint32_t histogram[HARP_PROFILE_HIST_BINS];
+    };
+    static inline Accumulator
+        accumulators_[HARP_PROFILE_CORE_COUNT][PHASE_COUNT] = {};
+#endif
+};
+
+static_assert(HarpProfiler::bin(255) == 0 && HarpProfiler::bin(256) == 1
+              && HarpProfiler::bin(1023) == 1 && HarpProfiler::bin(1024) == 2
+              && HarpProfiler::bin(HARP_PROFILE_TICK_MASK)
+                 == HARP_PROFILE_HIST_BINS - 1,
+              "Histogram bins must start at 2^8 ticks and grow 4x.");
+
+// Instrumentation points. These compile to nothing unless HARP_CORE_PROFILE
+// is defined.
+#if defined(HARP_CORE_PROFILE)
+#define HARP_PROFILE_STAMP(stamp) uint32_t stamp = HarpProfiler::ticks()
+#define HARP_PROFILE_MARK(stamp, phase) \
+    HarpProfiler::mark(stamp, HarpProfiler::phase)
+#else
+#define HARP_PROFILE_STAMP(stamp)
+#define HARP_PROFILE_MARK(stamp, phase)
+#endif
+
+#endif // HARP_PROFILER_H
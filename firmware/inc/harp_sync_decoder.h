@@ -0,0 +1,119 @@
+#ifndef HARP_SYNC_DECODER_H
+#define HARP_SYNC_DECODER_H
+#include <stdint.h>
+
+/**
+ * \brief Decoder for the Harp clock synchronizer's byte stream, shared by the
+ *  synchronizer's receive backends (uart or PIO).
+ * \details Each sync packet is the header `0xAA 0xAF` followed by the
+ *  previous whole Harp second as a 4-byte little-endian integer. Bytes are
+ *  pushed one at a time along with when they arrived, so that backends that
+ *  timestamp each byte can recover when the packet's final byte arrived.
+ *  Does not touch hardware, so it can be checked on the host.
+ */
+class HarpSyncDecoder
+{
+public:
+    enum State
+    {
+        RECEIVE_HEADER_0,
+        RECEIVE_HEADER_1,
+        RECEIVE_TIMESTAMP
+    };
+
+/**
+ * \brief outcome of pushing one byte.
+ */
+    enum Result
+    {
+        NONE, ///< the byte was consumed. No packet yet.
+        PACKET, ///< the byte completed a packet. See seconds().
+        MALFORMED ///< the byte broke off a packet header.
+    };
+
+/**
+ * \brief decode the next byte of the stream.
+ * \param time_us time that the byte arrived. Any fixed point in the byte
+ *  (i.e: its start bit, or the interrupt that read it) works, as long as
+ *  the caller accounts for it.
+ */
+    inline Result push(uint8_t byte, uint32_t time_us)
+    {
+        switch (state_)
+        {
+            case RECEIVE_HEADER_0:
+                if (byte == 0xAA)
+                    state_ = RECEIVE_HEADER_1;
+                return NONE;
+            case RECEIVE_HEADER_1:
+                if (byte == 0xAF)
+                {
+                    state_ = RECEIVE_TIMESTAMP;
+                    return NONE;
+                }
+                // A repeated 0xAA may still start a packet.
+                if (byte != 0xAA)
+                    state_ = RECEIVE_HEADER_0;
+                return MALFORMED;
+            case RECEIVE_TIMESTAMP:
+                data_[packet_index_++] = byte;
+                if (packet_index_ < sizeof(data_))
+                    return NONE;
+                state_ = RECEIVE_HEADER_0;
+                packet_index_ = 0;
+                final_byte_time_us_ = time_us;
+                // Add 1[s] per protocol spec since the 4-byte sequence encodes
+                // the previous second.
+                seconds_ = (uint32_t(data_[0]) | (uint32_t(data_[1]) << 8)
+                            | (uint32_t(data_[2]) << 16)
+                            | (uint32_t(data_[3]) << 24)) + 1;
+                return PACKET;
+        }
+        return NONE;
+    }
+
+/**
+ * \brief drop any partially-received packet.
+ */
+    void reset()
+    {
+        state_ = RECEIVE_HEADER_0;
+        packet_index_ = 0;
+    }
+
+    State state() const {return state_;}
+
+/**
+ * \brief Harp second that the last packet marks (i.e: one more than the
+ *  second it encodes).
+ */
+    uint32_t seconds() const {return seconds_;}
+
+/**
+ * \brief time that the last packet's final byte arrived, as pushed.
+ */
+    uint32_t final_byte_time_us() const {return final_byte_time_us_;}
+
+/**
+ * \brief Harp time (in [us]) at a point \p offset_us before the second
+ *  \p seconds.
+ */
+    static inline uint64_t harp_time_us(uint32_t seconds, uint32_t offset_us)
+    {return uint64_t(seconds) * 1'000'000 - offset_us;}
+
+/**
+ * \brief widen a 32-bit time \p time_us at or shortly before \p now_us
+ *  (within 2^32 [us]) to 64 bits.
+ */
+    static inline uint64_t widen_time_us(uint32_t time_us, uint64_t now_us)
+    {return now_us - uint32_t(uint32_t(now_us) - time_us);}
+
+private:
+    State state_ = RECEIVE_HEADER_0;
+    uint8_t packet_index_ = 0;
+    uint8_t data_[4] = {0, 0, 0, 0};
+    uint32_t seconds_ = 0;
+    uint32_t final_byte_time_us_ = 0;
+};
+
+#endif // HARP_SYNC_DECODER_H
@@ -0,0 +1,54 @@
+#ifndef HARP_SYNC_ENCODER_H
+#define HARP_SYNC_ENCODER_H
+#include <stdint.h>
+#include <harp_sync_decoder.h>
+
+#define HARP_SYNC_PACKET_SIZE (6) // bytes per sync packet.
+
+/**
+ * \brief Encoder for the Harp clock synchronizer's byte stream, the inverse
+ *  of HarpSyncDecoder.
+ * \details Each sync packet is the header `0xAA 0xAF` followed by the
+ *  previous whole Harp second as a 4-byte little-endian integer, and must
+ *  start a fixed offset before the second that it marks.
+ *  Does not touch hardware, so it can be checked on the host.
+ */
+class HarpSyncEncoder
+{
+public:
+/**
+ * \brief write the packet that marks the Harp second \p seconds.
+ */
+    static inline void encode(uint32_t seconds,
+                              uint8_t (&packet)[HARP_SYNC_PACKET_SIZE])
+    {
+        // Per protocol spec, the 4-byte sequence encodes the previous second.
+        uint32_t payload = seconds - 1;
+        packet[0] = 0xAA;
+        packet[1] = 0xAF;
+        packet[2] = uint8_t(payload);
+        packet[3] = uint8_t(payload >> 8);
+        packet[4] = uint8_t(payload >> 16);
+        packet[5] = uint8_t(payload >> 24);
+    }
+
+/**
+ * \brief Harp time (in [us]) at which the packet that marks the second
+ *  \p seconds starts, given that packets start \p offset_us before the
+ *  second that they mark.
+ */
+    static inline uint64_t packet_start_harp_us(uint32_t seconds,
+                                                uint32_t offset_us)
+    {return HarpSyncDecoder::harp_time_us(seconds, offset_us);}
+
+/**
+ * \brief the second marked by the first packet that starts at or after the
+ *  Harp time \p harp_time_us, given that packets start \p offset_us before
+ *  the second that they mark.
+ */
+    static inline uint32_t next_seconds(uint64_t harp_time_us,
+                                        uint32_t offset_us)
+    {return uint32_t((harp_time_us + offset_us + 999'999) / 1'000'000);}
+};
+
+#endif // HARP_SYNC_ENCODER_H
@@ -3,9 +3,15 @@
 #include <stdint.h>
 #include <pico/stdlib.h>
 #include <hardware/uart.h>
+#include <hardware/gpio.h>
 #include <hardware/irq.h>
 #include <hardware/sync.h>
 #include <hardware/structs/timer.h>
+#include <harp_sync_decoder.h>
+#include <atomic>
+#if defined(PICO_RP2040)
+#include <hardware/pio.h>
+#endif
 
 #ifdef DEBUG
 #include <cstdio> // for printf
@@ -16,20 +22,107 @@
 #define HARP_SYNC_STOP_BITS (1)
 #define HARP_SYNC_PARITY (UART_PARITY_NONE)
 
-#define HARP_SYNC_OFFSET_US (672 - 90) // time (in [us]) from the **end** of
-                                       // the last packet byte and the time
-                                       // specified in that packet.
+#define HARP_SYNC_PACKET_END_US (672) // time (in [us]) from the **end** of
+                                      // the last packet byte and the time
+                                      // specified in that packet.
+#define HARP_SYNC_OFFSET_US (HARP_SYNC_PACKET_END_US - 90) // same as above,
+                                       // but from when the last byte's
+                                       // interrupt runs in PER_BYTE mode.
+
+#define HARP_SYNC_BIT_US (1'000'000UL / HARP_SYNC_BAUDRATE) // [us] per bit.
+#define HARP_SYNC_PACKET_US (6 * 10 * HARP_SYNC_BIT_US) // duration of a sync
+                                                        // packet (6 bytes of
+                                                        // 10 bits each).
+#define HARP_SYNC_FINAL_BYTE_US (HARP_SYNC_PACKET_END_US + 10 * HARP_SYNC_BIT_US)
+                                  // time (in [us]) from the start bit of the
+                                  // last packet byte and the time specified in
+                                  // that packet.
+#define HARP_SYNC_RX_TIMEOUT_US (32 * HARP_SYNC_BIT_US) // time after the last
+                                                        // byte before the uart
+                                                        // RX timeout interrupt.
+#define HARP_SYNC_MAX_RX_LATENCY_US (1000) // In PER_PACKET mode, max time
+                                           // (in [us]) between the RX timeout
+                                           // and its interrupt for which the
+                                           // packet's start edge is trusted.
+
+#define HARP_SYNC_PERIOD_US (1'000'000) // nominal time between sync packets.
+#define HARP_SYNC_HOLDOVER_TIMEOUT_US (1'500'000) // time (in [us]) without a
+                                                  // sync packet before
+                                                  // entering holdover.
+#define HARP_SYNC_HOLDOVER_DRIFT_PPM (1) // minimum assumed frequency
+                                         // instability during holdover.
+#define HARP_SYNC_STEP_THRESHOLD_US (1000) // In SLEW mode, phase errors larger
+                                           // than this (in [us]) step the
+                                           // clock instead (or larger than
+                                           // twice the estimated error if
+                                           // returning from holdover).
+#define HARP_SYNC_MAX_RELOCK_SLEW_US (100'000) // phase errors larger than this
+                                               // (in [us]) always step.
+#define HARP_SYNC_MAX_FREQ_PPM (500) // limit on the learned frequency error.
+#define HARP_SYNC_MAX_SLEW_PPM (1000) // limit on the rate adjustment while
+                                      // slewing out phase errors.
+#define HARP_SYNC_KP_SHIFT (2) // Phase gain of the clock loop: 1/2^KP_SHIFT of
+                               // the phase error is slewed out per packet.
+#define HARP_SYNC_KI_SHIFT (5) // Frequency gain of the clock loop: 1/2^KI_SHIFT
+                               // of the phase error per packet is attributed
+                               // to frequency error.
+#define HARP_SYNC_STATS_WINDOW (16) // number of recent sync packets that the
+                                    // correction statistics cover. Must be a
+                                    // power of two.
 
 // Synchronizer that updates RP2040's timekeeping registers according to
 //  specific uart input. Singleton.
 class HarpSynchronizer
 {
 public:
-    enum SyncState
+/**
+ * \brief whether the Harp time is tracking the sync packets.
+ */
+    enum SyncStatus
+    {
+        UNSYNCED, ///< no sync packet has been received yet.
+        LOCKED, ///< sync packets are arriving.
+        HOLDOVER ///< sync packets stopped. Harp time is extrapolated from the
+                 ///< learned frequency error.
+    };
+
+/**
+ * \brief how sync packets correct the Harp time.
+ */
+    enum ClockMode
     {
-        RECEIVE_HEADER_0,
-        RECEIVE_HEADER_1,
-        RECEIVE_TIMESTAMP
+        STEP, ///< overwrite the Harp time with each packet's time.
+        SLEW  ///< discipline the rate of the Harp time to track the packets.
+    };
+
+/**
+ * \brief how sync packets are received from the uart.
+ */
+    enum RxMode
+    {
+        PER_BYTE, ///< one interrupt per byte with the uart FIFO disabled.
+        PER_PACKET ///< one interrupt per packet from the uart RX timeout, plus
+                   ///< one to timestamp the packet's first start bit.
+    };
+
+/**
+ * \brief statistics of the synchronizer's input and of the phase errors
+ *  corrected by recent sync packets.
+ * \details Minimum, maximum, mean, and jitter cover the last
+ *  #HARP_SYNC_STATS_WINDOW packets. Counts accumulate since init().
+ */
+    struct SyncStats
+    {
+        int32_t last_error_us; ///< phase error corrected by the last packet.
+        int32_t min_error_us; ///< most negative phase error in the window.
+        int32_t max_error_us; ///< most positive phase error in the window.
+        int32_t mean_error_us; ///< mean phase error in the window.
+        uint32_t jitter_us; ///< mean magnitude of the change in phase error
+                            ///< from one packet to the next in the window.
+        uint32_t packet_count; ///< sync packets received.
+        uint32_t missed_count; ///< sync packets that never arrived.
+        uint32_t malformed_count; ///< packet headers that were cut short or
+                                  ///< corrupted.
     };
 
 private:
@@ -47,12 +140,64 @@ public:
  */
     static HarpSynchronizer& init(uart_inst_t* uart, uint8_t uart_rx_pin);
 
+#if defined(PICO_RP2040)
+/**
+ * \brief init the HarpSynchronizer singleton with a PIO backend instead of a
+ *  uart and return a reference to it.
+ * \details A PIO state machine decodes the sync stream on \p rx_pin and
+ *  latches the system timer at the start bit of every byte: a DMA channel,
+ *  paced by the state machine's TX FIFO, keeps that FIFO full of timer
+ *  reads, and the state machine empties it at each start bit so that it
+ *  refills with the current time. Packets are timestamped from the start
+ *  bit of their final byte (see #HARP_SYNC_FINAL_BYTE_US), to within the
+ *  state machine's sampling period of #HARP_SYNC_BIT_US / 16, instead of
+ *  from interrupt latency. Frees the uart.
+ * \note Claims one state machine on \p pio, its program space, and one DMA
+ *  channel. Adds a shared handler to the PIO's IRQ 0.
+ * \warning call only one of the init() functions.
+ */
+    static HarpSynchronizer& init(PIO pio, uint8_t rx_pin);
+#endif
+
 /**
  * \brief return a pointer to the one-and-only instance or nullptr if
  *      init() was never called.
  */
     static HarpSynchronizer& instance(){return *self;}
 
+/**
+ * \brief set how sync packets correct the Harp time.
+ * \details In STEP mode (the default), each sync packet overwrites the Harp
+ *  time, so it jumps by the accumulated crystal error once per second.
+ *  In SLEW mode, the synchronizer learns the crystal's frequency error from
+ *  successive packets and adjusts the rate of the Harp time to remove phase
+ *  errors gradually, so the Harp time stays monotonic. Phase errors above
+ *  #HARP_SYNC_STEP_THRESHOLD_US (i.e: when first synchronizing) still step.
+ * \note In both modes, the learned frequency error is used to extrapolate
+ *  the Harp time during holdover.
+ */
+    static void set_clock_mode(ClockMode mode)
+    {self->clock_mode_ = mode;}
+
+/**
+ * \brief set how sync packets are received from the uart. Does nothing with
+ *  the PIO backend.
+ * \details In PER_BYTE mode (the default), the uart FIFO is disabled and
+ *  each of the 6 packet bytes raises an interrupt. The packet is timestamped
+ *  from when the last byte's interrupt runs, so interrupt latency adds
+ *  jitter.
+ *  In PER_PACKET mode, the uart FIFO is enabled and only the RX timeout
+ *  interrupt (#HARP_SYNC_RX_TIMEOUT_US after the last byte) processes the
+ *  packet. The packet is timestamped from a falling edge interrupt on the
+ *  RX pin, armed only while waiting for a packet, that captures the timer at
+ *  the first start bit. Since the synchronizer sends the packet bytes
+ *  back-to-back, the packet ends #HARP_SYNC_PACKET_US later. If the edge was
+ *  missed, the packet is timestamped from the RX timeout interrupt instead.
+ * \note PER_PACKET mode attaches a raw IO_IRQ_BANK0 handler to the RX pin,
+ *  so it coexists with other GPIO interrupt callbacks.
+ */
+    static void set_rx_mode(RxMode mode);
+
 /**
  * \brief convert system time (in 64-bit microseconds) to local system time
  *  (in 64-bit microseconds)
@@ -62,7 +207,13 @@ public:
  *  will be in local system time.
  */
     static inline uint64_t system_to_harp_us_64(uint64_t system_time_us)
-    {return system_time_us - self->offset_us_64_;}
+    {
+        const clock_model_t& model = self->clock_model();
+        // Signed, since events can be timestamped before the anchor point.
+        int64_t elapsed_us = int64_t(system_time_us - model.system_us);
+        uint32_t frac;
+        return model.harp_us + elapsed_us + gained_us(model, elapsed_us, frac);
+    }
 
 /**
  * \brief Override the current Harp time with a specific time.
@@ -70,13 +221,12 @@ public:
  *  needs to set the time (i.e: specifying the time over Harp protocol by
  *  writing to timestamp registers).
  */
-    static inline void set_harp_time_us_64(uint64_t harp_time_us)
-    {self->offset_us_64_ = ::time_us_64() - harp_time_us;}
+    static void set_harp_time_us_64(uint64_t harp_time_us);
 
 /**
  * \brief get the total elapsed microseconds (64-bit) in "Harp" time.
- * \warning this value is not monotonic and can change at any time if an
- *  external synchronizer is physically connected and operating.
+ * \warning this value is not monotonic in STEP mode and can change at any
+ *  time if an external synchronizer is physically connected and operating.
  * \note if the device is unsynchronized (i.e: offset = 0), the returned time
  *  will be in local system time.
  */
@@ -85,13 +235,32 @@ public:
 
 /**
  * \brief get the total elapsed microseconds (32-bit) in "Harp" time.
- * \warning this value is not monotonic and can change at any time if an
- *  external synchronizer is physically connected and operating.
+ * \details equal to `uint32_t(time_us_64())`, but only reads the lower 32
+ *  bits of the timer, so it is safe to call from interrupts and hot loops.
+ *  Truncated times wrap around every ~71.6 minutes, so compare them with
+ *  signed differences, i.e: `int32_t(t1 - t0)`, over short intervals.
+ * \warning this value is not monotonic in STEP mode and can change at any
+ *  time if an external synchronizer is physically connected and operating.
  */
     static inline uint32_t time_us_32()
-    {return uint32_t(time_us_64());}    // FIXME: this should execute faster
-                                        // but truncating for speed involves
-                                        // checking a bunch of edge cases.
+    {return system_to_harp_us_32(::time_us_32());}
+
+/**
+ * \brief convert system time (in 32-bit microseconds) to Harp time (in
+ *  32-bit microseconds).
+ * \details exact modulo 2^32 if \p system_time_us is less than 2^31 [us]
+ *  (~35.8 minutes) before or after the last sync packet (or change to the
+ *  Harp time), since truncation commutes with subtraction.
+ */
+    static inline uint32_t system_to_harp_us_32(uint32_t system_time_us)
+    {
+        const clock_model_t& model = self->clock_model();
+        int32_t elapsed_us = int32_t(system_time_us
+                                     - uint32_t(model.system_us));
+        uint32_t frac;
+        return uint32_t(model.harp_us) + elapsed_us
+               + uint32_t(gained_us(model, elapsed_us, frac));
+    }
 
 /**
  * \brief convert harp time (in 64-bit microseconds) to local system time
@@ -101,7 +270,15 @@ public:
  *  the harp time.
  */
     static inline uint64_t harp_to_system_us_64(uint64_t harp_time_us)
-    {return harp_time_us + self->offset_us_64_;}
+    {
+        // First-order inverse of system_to_harp_us_64(). The error is
+        // negligible for any rate within #HARP_SYNC_MAX_SLEW_PPM.
+        const clock_model_t& model = self->clock_model();
+        int64_t elapsed_us = int64_t(harp_time_us - model.harp_us);
+        uint32_t frac;
+        return model.system_us + elapsed_us
+               - gained_us(model, elapsed_us, frac);
+    }
 
 /**
  * \brief convert harp time (in 32-bit microseconds) to local system time
@@ -111,16 +288,181 @@ public:
  *  the harp time.
  */
     static inline uint32_t harp_to_system_us_32(uint64_t harp_time_us)
-    {return uint32_t(harp_to_system_us_64(harp_time_us));}
+    {
+        const clock_model_t& model = self->clock_model();
+        int32_t elapsed_us = int32_t(uint32_t(harp_time_us)
+                                     - uint32_t(model.harp_us));
+        uint32_t frac;
+        return uint32_t(model.system_us) + elapsed_us
+               - uint32_t(gained_us(model, elapsed_us, frac));
+    }
 
 /**
- * \brief true if the synchronizer has received at least one external sync
- *  signal.
+ * \brief whether the Harp time is tracking the sync packets.
+ * \details HOLDOVER is entered when no sync packet arrives for
+ *  #HARP_SYNC_HOLDOVER_TIMEOUT_US and is left with the next sync packet.
+ */
+    static inline SyncStatus status()
+    {
+        if (!self->has_synced_)
+            return UNSYNCED;
+        uint64_t since_sync_us = ::time_us_64()
+                                 - self->clock_model().sync_system_us;
+        return (since_sync_us > HARP_SYNC_HOLDOVER_TIMEOUT_US)?
+                    HOLDOVER: LOCKED;
+    }
+
+/**
+ * \brief true if sync packets are arriving, i.e: status() is LOCKED.
  */
     static inline bool is_synced()
-    {return self->has_synced_;}
+    {return status() == LOCKED;}
+
+/**
+ * \brief estimate of the current Harp time error (in [us]).
+ * \details While LOCKED, this is the recent peak phase error between the
+ *  Harp time and the sync packets. During HOLDOVER, it grows with the time
+ *  since the last sync packet at the recently observed frequency
+ *  instability, but at least #HARP_SYNC_HOLDOVER_DRIFT_PPM.
+ * \returns UINT32_MAX if UNSYNCED.
+ */
+    static uint32_t estimated_error_us();
+
+/**
+ * \brief get the current sync statistics.
+ * \details Safe to call outside of the sync uart ISR. If a packet arrives
+ *  while reading, the window may mix values from before and after it.
+ * \note The window excludes the packet that first synchronizes the clock,
+ *  since its phase error is the whole Harp time.
+ */
+    static SyncStats stats();
+
+/**
+ * \brief learned frequency error of the system clock relative to the Harp
+ *  clock in parts-per-billion. Positive if the system clock runs slow.
+ */
+    static inline int32_t freq_ppb()
+    {return int32_t((int64_t(self->freq_) * 1'000'000'000) >> 32);}
+
+/**
+ * \brief time (in [us]) since the last sync packet.
+ * \returns UINT64_MAX if UNSYNCED.
+ */
+    static inline uint64_t time_since_sync_us()
+    {
+        if (!self->has_synced_)
+            return UINT64_MAX;
+        return ::time_us_64() - self->clock_model().sync_system_us;
+    }
 
 private:
+/**
+ * \brief linear map from system time to Harp time, anchored at the most
+ *  recent correction.
+ */
+    struct clock_model_t
+    {
+        uint64_t system_us; ///< system time of the anchor point.
+        uint64_t harp_us; ///< Harp time at the anchor point (whole [us]).
+        uint32_t harp_frac; ///< Harp time at the anchor point (2^-32 [us]).
+        int32_t freq; ///< Harp time rate relative to system time, minus one
+                      ///< (in units of 2^-32).
+        int32_t slew; ///< rate added to #freq for the first #slew_us after
+                      ///< the anchor point.
+        uint32_t slew_us; ///< duration of the slew.
+        uint64_t sync_system_us; ///< system time of the last sync packet.
+    };
+
+/**
+ * \brief convert parts-per-million to #clock_model_t::rate units.
+ */
+    static constexpr int32_t ppm_to_rate(int32_t ppm)
+    {return int32_t(int64_t(ppm) * (1LL << 32) / 1'000'000);}
+
+/**
+ * \brief compute the whole microseconds of Harp time gained (or lost)
+ *  relative to system time over \p elapsed_us since the anchor point of
+ *  \p model.
+ * \param elapsed_us negative before the anchor point, where the model
+ *  extrapolates at #clock_model_t::freq without the slew.
+ * \param frac set to the fraction of a microsecond left over.
+ * \note only 32x32-bit multiplies while elapsed_us is in [0, 2^32).
+ */
+    static inline int64_t gained_us(const clock_model_t& model,
+                                    int64_t elapsed_us, uint32_t& frac)
+    {
+        uint32_t slewed_us = (elapsed_us <= 0)? 0:
+                             (elapsed_us < model.slew_us)?
+                                uint32_t(elapsed_us): model.slew_us;
+        int64_t lower = int64_t(uint32_t(elapsed_us)) * model.freq
+                        + int64_t(slewed_us) * model.slew + model.harp_frac;
+        frac = uint32_t(lower);
+        // The upper word shifts arithmetically, so it is negative (and the
+        // lower word still counts up from it) before the anchor point.
+        if ((elapsed_us >> 32) == 0)
+            return lower >> 32;
+        return int64_t(elapsed_us >> 32) * model.freq + (lower >> 32);
+    }
+
+/**
+ * \brief model that runs at the learned frequency from an anchor point.
+ *  In STEP mode, the first #HARP_SYNC_PERIOD_US run at the system rate.
+ */
+    clock_model_t step_model(uint64_t system_us, uint64_t harp_us,
+                             uint64_t sync_system_us);
+
+/**
+ * \brief advance \p model to a new anchor point at \p system_us without
+ *  changing the Harp time it produces.
+ */
+    static clock_model_t reanchor(const clock_model_t& model,
+                                  uint64_t system_us);
+
+/**
+ * \brief the current clock model.
+ * \details Models are double-buffered: writers fill the inactive model and
+ *  then flip #model_index_, so readers (including interrupts and the other
+ *  core) never see a partially-written model without locking.
+ */
+    inline const clock_model_t& clock_model()
+    {return models_[model_index_.load(std::memory_order_acquire)];}
+
+/**
+ * \brief make \p model the current clock model.
+ * \warning only one writer at a time. Interrupts must be disabled outside
+ *  of the sync uart ISR.
+ */
+    inline void publish_clock_model(const clock_model_t& model)
+    {
+        uint8_t next_index = model_index_.load(std::memory_order_relaxed) ^ 1;
+        models_[next_index] = model;
+        model_index_.store(next_index, std::memory_order_release);
+    }
+
+/**
+ * \brief estimate of the Harp time error (in [us]) \p since_sync_us after
+ *  the last sync packet.
+ */
+    uint32_t estimated_error_us(uint64_t since_sync_us);
+
+/**
+ * \brief apply a \p correction to the learned frequency #freq_.
+ */
+    void update_freq(int64_t correction);
+
+/**
+ * \brief add the phase error of a sync packet that arrived \p interval_us
+ *  after the previous one to the statistics.
+ */
+    void update_stats(int32_t error_us, uint64_t interval_us);
+
+/**
+ * \brief correct the clock model from a sync packet.
+ * \param system_us system time when the packet was received.
+ * \param harp_us Harp time when the packet was received.
+ */
+    void discipline(uint64_t system_us, uint64_t harp_us);
+
 /**
  * \brief a pointer to the one-and-only instance or nullptr if init() was
  *      never called.
@@ -134,25 +476,128 @@ private:
  */
     static void uart_rx_callback();
 
+/**
+ * \brief correct the clock model from a decoded sync packet.
+ * \param packet_system_us system time of a point in the packet.
+ * \param packet_harp_us Harp time of the same point in the packet.
+ */
+    void apply_packet(uint64_t packet_system_us, uint64_t packet_harp_us);
+
+#if defined(PICO_RP2040)
+/**
+ * \brief claim and start the PIO state machine and DMA channel of the PIO
+ *  backend.
+ */
+    void setup_pio(PIO pio);
+
+/**
+ * \brief Callback fn for the PIO backend's RX FIFO interrupt.
+ */
+    static void pio_rx_callback();
+#endif
+
+/**
+ * \brief Callback fn for the falling edge interrupt on the RX pin in
+ *  PER_PACKET mode. Captures the time of the packet's first start bit.
+ */
+    static void rx_edge_callback();
+
+/**
+ * \brief clear any captured start edge and listen for the next one.
+ */
+    void arm_rx_edge();
+
+/**
+ * \brief system time when the last packet byte ended, given the time of the
+ *  RX timeout interrupt, \p rx_timeout_us.
+ */
+    uint64_t packet_end_time_us(uint64_t rx_timeout_us);
+
     uart_inst_t* uart_id_;
+    uint8_t uart_rx_pin_;
+    RxMode rx_mode_;
+    bool rx_edge_handler_added_;
+
+/**
+ * \brief system time of the first start bit of the packet being received.
+ *  Only valid if #rx_edge_captured_.
+ */
+    volatile uint64_t rx_edge_time_us_;
+    volatile bool rx_edge_captured_;
+
+#if defined(PICO_RP2040)
+    PIO pio_ = nullptr; ///< PIO of the PIO backend, or nullptr.
+    uint pio_sm_ = 0;
+    uint pio_dma_chan_ = 0;
+#endif
 
-    // members edited within an ISR must be volatile.
-    volatile SyncState state_;
-    volatile uint8_t packet_index_;
-    volatile bool new_timestamp_;
+/**
+ * \brief decoder of the sync byte stream. Only used within the receive ISR.
+ */
+    HarpSyncDecoder decoder_;
 
-    volatile uint64_t offset_us_64_;
+/**
+ * \brief double-buffered clock models. See clock_model().
+ */
+    clock_model_t models_[2];
+    std::atomic<uint8_t> model_index_; ///< index of the current model.
+
+    volatile ClockMode clock_mode_;
+
+/**
+ * \brief learned frequency error of the system clock relative to the Harp
+ *  clock (in #clock_model_t::rate units). Only updated in SLEW mode.
+ */
+    int32_t freq_;
+
+/**
+ * \brief true once #freq_ has been seeded from two consecutive packets.
+ */
+    bool freq_acquired_;
+
+/**
+ * \brief recent average magnitude of corrections to #freq_ (in
+ *  #clock_model_t::freq units). Bounds the drift during holdover.
+ */
+    int32_t freq_noise_;
+
+/**
+ * \brief phase error (in [us]) measured with the last sync packet.
+ */
+    volatile int32_t last_error_us_;
+
+/**
+ * \brief recent peak magnitude of the phase error (in [us]) left after
+ *  each sync packet.
+ */
+    volatile uint32_t phase_error_bound_us_;
+
+/**
+ * \brief Harp time of the last sync packet.
+ */
+    uint64_t last_sync_harp_us_;
 
     volatile bool has_synced_;
+
 /**
- * \brief container to store the little-endian timestamp and then
- *  reinterpret-cast to the value.
+ * \brief phase errors (in [us]) of the last #HARP_SYNC_STATS_WINDOW sync
+ *  packets, oldest first from #error_history_index_.
  */
-    alignas(uint32_t) volatile uint8_t sync_data_[4];
+    volatile int32_t error_history_us_[HARP_SYNC_STATS_WINDOW];
+    volatile uint8_t error_history_index_; ///< where the next error goes.
+    volatile uint8_t error_history_count_; ///< valid entries (up to the size).
+    static_assert((HARP_SYNC_STATS_WINDOW & (HARP_SYNC_STATS_WINDOW - 1)) == 0
+                  && HARP_SYNC_STATS_WINDOW <= 128,
+                  "HARP_SYNC_STATS_WINDOW must be a power of two up to 128.");
+
+    // Counts since init(). See SyncStats.
+    volatile uint32_t packet_count_;
+    volatile uint32_t missed_count_;
+    volatile uint32_t malformed_count_;
 
 /**
  * \brief HarpCore is a friend such that updating the HarpCore's timestamp
- *  registers will update the HarpSynchronizer #offset_us_64_ instead of
+ *  registers will update the HarpSynchronizer's clock model instead of
  *  the HarpCore's internal offset.
  */
     friend class HarpCore;
@@ -0,0 +1,98 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+#include <stdint.h>
+#include <atomic>
+#include <hardware/sync.h>
+
+/**
+ * \brief multi-producer/single-consumer queue of fixed-size slots.
+ * \details Producers reserve a slot with reserve(), fill it in place, and
+ *  then publish it with commit(). The consumer reads the slot returned by
+ *  front() in place and then releases it with pop(). Producers may be
+ *  interrupts or either core.
+ * \note the RP2040's Cortex-M0+ cores have no atomic read-modify-write
+ *  instructions, so reserve() claims a slot under a hardware spin lock with
+ *  interrupts disabled for a few instructions. Filling, committing, and
+ *  consuming slots are lock-free.
+ * \note slots are consumed in reservation order, so a reserved slot that has
+ *  yet to be committed holds back the ones behind it.
+ * \tparam T slot type.
+ * \tparam N number of slots. Must be a power of two.
+ */
+template <typename T, uint16_t N>
+class MpscQueue
+{
+static_assert((N & (N - 1)) == 0, "MpscQueue size must be a power of two.");
+
+public:
+    MpscQueue()
+    : head_{0}, tail_{0}, drop_count_{0},
+      lock_{spin_lock_instance(spin_lock_claim_unused(true))}
+    {
+        for (uint16_t i = 0; i < N; ++i)
+            ready_[i].store(false, std::memory_order_relaxed);
+    }
+
+/**
+ * \brief producer: reserve the next free slot, or return nullptr (and count a
+ *  drop) if the queue is full.
+ */
+    T* reserve()
+    {
+        uint32_t irq_status = spin_lock_blocking(lock_);
+        uint16_t head = head_;
+        if (uint16_t(head - tail_.load(std::memory_order_acquire)) == N)
+        {
+            ++drop_count_;
+            spin_unlock(lock_, irq_status);
+            return nullptr;
+        }
+        head_ = head + 1;
+        spin_unlock(lock_, irq_status);
+        return &slots_[head & (N - 1)];
+    }
+
+/**
+ * \brief producer: publish a slot returned by reserve().
+ */
+    void commit(T* slot)
+    {ready_[slot - slots_].store(true, std::memory_order_release);}
+
+/**
+ * \brief consumer: return the oldest slot if it has been committed, or
+ *  nullptr otherwise.
+ */
+    T* front()
+    {
+        uint16_t index = tail_.load(std::memory_order_relaxed) & (N - 1);
+        if (not ready_[index].load(std::memory_order_acquire))
+            return nullptr;
+        return &slots_[index];
+    }
+
+/**
+ * \brief consumer: release the slot returned by front().
+ */
+    void pop()
+    {
+        uint16_t tail = tail_.load(std::memory_order_relaxed);
+        ready_[tail & (N - 1)].store(false, std::memory_order_relaxed);
+        tail_.store(tail + 1, std::memory_order_release);
+    }
+
+/**
+ * \brief total number of reservations refused because the queue was full.
+ */
+    uint32_t drop_count()
+    {return drop_count_;}
+
+private:
+    T slots_[N];
+    std::atomic<bool> ready_[N]; ///< true once a slot is committed.
+    uint16_t head_; ///< free-running index. Guarded by #lock_.
+    std::atomic<uint16_t> tail_; ///< free-running index. Written by consumer.
+    volatile uint32_t drop_count_; ///< Guarded by #lock_.
+    spin_lock_t* lock_;
+};
+
+#endif // MPSC_QUEUE_H
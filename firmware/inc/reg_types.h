@@ -1,5 +1,8 @@
 #ifndef REG_TYPES_H
 #define REG_TYPES_H
+#include <stdint.h>
+#include <stddef.h>
+#include <type_traits>
 
 // Payload flags. These need their type enforced.
 #define IS_SIGNED ((uint8_t)0x80)
@@ -30,4 +33,40 @@ enum reg_type_t: uint8_t
     TimestampedFloat = HAS_TIMESTAMP | Float
 };
 
+/**
+ * \brief the Harp payload type of one element of type \p T, without
+ *  cv-qualifiers. Specialized per supported type.
+ */
+template <typename T> struct reg_element_type_of;
+template <> struct reg_element_type_of<char>
+{static constexpr reg_type_t value = U8;};
+template <> struct reg_element_type_of<uint8_t>
+{static constexpr reg_type_t value = U8;};
+template <> struct reg_element_type_of<int8_t>
+{static constexpr reg_type_t value = S8;};
+template <> struct reg_element_type_of<uint16_t>
+{static constexpr reg_type_t value = U16;};
+template <> struct reg_element_type_of<int16_t>
+{static constexpr reg_type_t value = S16;};
+template <> struct reg_element_type_of<uint32_t>
+{static constexpr reg_type_t value = U32;};
+template <> struct reg_element_type_of<int32_t>
+{static constexpr reg_type_t value = S32;};
+template <> struct reg_element_type_of<uint64_t>
+{static constexpr reg_type_t value = U64;};
+template <> struct reg_element_type_of<int64_t>
+{static constexpr reg_type_t value = S64;};
+template <> struct reg_element_type_of<float>
+{static constexpr reg_type_t value = Float;};
+
+/**
+ * \brief the Harp payload type of a register of type \p T, i.e:
+ *  `reg_type_of<volatile uint16_t>::value == U16`.
+ * \details cv-qualifiers are ignored, and arrays take the payload type of
+ *  their elements. Unsupported types fail to compile.
+ */
+template <typename T>
+struct reg_type_of: reg_element_type_of<
+    std::remove_cv_t<std::remove_all_extents_t<T>>>{};
+
 #endif // REG_TYPES_H
@@ -0,0 +1,77 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * \brief Lock-free single-producer/single-consumer queue of fixed-size slots.
+ * \details The producer fills the slot returned by back() in place and then
+ *  commits it with push(). The consumer reads the slot returned by front() in
+ *  place and then releases it with pop(). Safe between one interrupt (or
+ *  core) producing and the main loop (or other core) consuming, since each
+ *  index is only ever written by one side and only loaded/stored whole.
+ * \tparam T slot type.
+ * \tparam N number of slots. Must be a power of two.
+ */
+template <typename T, uint16_t N>
+class SpscQueue
+{
+static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two.");
+
+public:
+    SpscQueue(): head_{0}, tail_{0}{}
+
+/**
+ * \brief producer: return the next free slot, or nullptr if the queue is full.
+ */
+    T* back()
+    {
+        uint16_t head = head_.load(std::memory_order_relaxed);
+        if (uint16_t(head - tail_.load(std::memory_order_acquire)) == N)
+            return nullptr;
+        return &slots_[head & (N - 1)];
+    }
+
+/**
+ * \brief producer: commit the slot returned by back().
+ */
+    void push()
+    {head_.store(head_.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_release);}
+
+/**
+ * \brief consumer: return the oldest committed slot, or nullptr if the queue
+ *  is empty.
+ */
+    T* front()
+    {
+        uint16_t tail = tail_.load(std::memory_order_relaxed);
+        if (head_.load(std::memory_order_acquire) == tail)
+            return nullptr;
+        return &slots_[tail & (N - 1)];
+    }
+
+/**
+ * \brief consumer: release the slot returned by front().
+ */
+    void pop()
+    {tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_release);}
+
+/**
+ * \brief number of committed slots. Approximate if called from neither side.
+ */
+    uint16_t size()
+    {return head_.load(std::memory_order_acquire)
+            - tail_.load(std::memory_order_acquire);}
+
+    bool empty()
+    {return size() == 0;}
+
+private:
+    T slots_[N];
+    std::atomic<uint16_t> head_; ///< free-running index. Written by producer.
+    std::atomic<uint16_t> tail_; ///< free-running index. Written by consumer.
+};
+
+#endif // SPSC_QUEUE_H
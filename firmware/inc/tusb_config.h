@@ -33,7 +33,7 @@
 
 #define CFG_TUD_CDC             (1)
 #define CFG_TUD_CDC_RX_BUFSIZE  (256)
-#define CFG_TUD_CDC_TX_BUFSIZE  (256)
+#define CFG_TUD_CDC_TX_BUFSIZE  (512)
 
 // We use a vendor specific interface but with our own driver
 #define CFG_TUD_VENDOR            (0)
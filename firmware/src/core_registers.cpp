@@ -18,7 +18,9 @@ Registers::Registers(uint16_t who_am_i,
        .R_OPERATION_CTRL = 0,
        .R_SERIAL_NUMBER = serial_number,
        .R_UUID = {0} // all zeros.
-        }
+        },
+ diag_regs_{}, // all zeros.
+ sync_regs_{} // all zeros.
 {
     strcpy((char*)regs_.R_DEVICE_NAME, name);
     strcpy((char*)regs_.R_TAG, (char*)tag);
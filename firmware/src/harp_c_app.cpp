@@ -15,7 +15,27 @@ HarpCApp& HarpCApp::init(uint16_t who_am_i,
                         assembly_version,
                         harp_version_major, harp_version_minor,
                         fw_version_major, fw_version_minor, serial_number,
-                        name, tag, app_reg_values, app_reg_specs,
+                        name, tag, app_reg_values, app_reg_specs, nullptr,
+                        app_reg_fns, app_reg_count, update_fn, reset_fn);
+    return app;
+}
+
+HarpCApp& HarpCApp::init(uint16_t who_am_i,
+                         uint8_t hw_version_major, uint8_t hw_version_minor,
+                         uint8_t assembly_version,
+                         uint8_t harp_version_major, uint8_t harp_version_minor,
+                         uint8_t fw_version_major, uint8_t fw_version_minor,
+                         uint16_t serial_number, const char name[],
+                         const uint8_t tag[],
+                         void* app_reg_values, const RegLayout* app_reg_layouts,
+                         RegFnPair* app_reg_fns, size_t app_reg_count,
+                         void (* update_fn)(void), void (* reset_fn)(void))
+{
+    static HarpCApp app(who_am_i, hw_version_major, hw_version_minor,
+                        assembly_version,
+                        harp_version_major, harp_version_minor,
+                        fw_version_major, fw_version_minor, serial_number,
+                        name, tag, app_reg_values, nullptr, app_reg_layouts,
                         app_reg_fns, app_reg_count, update_fn, reset_fn);
     return app;
 }
@@ -28,18 +48,25 @@ HarpCApp::HarpCApp(uint16_t who_am_i,
                    uint16_t serial_number, const char name[],
                    const uint8_t tag[],
                    void* app_reg_values, RegSpecs* app_reg_specs,
+                   const RegLayout* app_reg_layouts,
                    RegFnPair* app_reg_fns, size_t app_reg_count,
                    void (*update_fn)(void), void (* reset_fn)(void))
-:reg_values_{app_reg_values},
+:HarpCore(who_am_i, hw_version_major, hw_version_minor,
+          assembly_version, harp_version_major, harp_version_minor,
+          fw_version_major, fw_version_minor, serial_number, name, tag),
+ reg_values_{app_reg_values},
  reg_specs_{app_reg_specs},
+ reg_layouts_{app_reg_layouts},
  reg_fns_{app_reg_fns},
  reg_count_{app_reg_count},
  update_fn_{update_fn},
- reset_fn_{reset_fn},
- HarpCore(who_am_i, hw_version_major, hw_version_minor,
-          assembly_version, harp_version_major, harp_version_minor,
-          fw_version_major, fw_version_minor, serial_number, name, tag)
+ reset_fn_{reset_fn}
 {
+    // More app registers would overlap the diagnostics bank. HarpApp checks
+    // this at compile time.
+    if (app_reg_count > MAX_APP_REG_COUNT)
+        panic("Too many app registers: %u. The max is %u.",
+              unsigned(app_reg_count), unsigned(MAX_APP_REG_COUNT));
     // Call base class constructor.
     // Create a ptr to the first (and only) derived class instance created.
     if (self == nullptr)
@@ -0,0 +1,115 @@
+#include <harp_clock_output.h>
+
+
+HarpClockOutput::HarpClockOutput(uart_inst_t* uart_id, uint8_t uart_tx_pin)
+:uart_id_{uart_id}, alarm_num_{0},
+ source_{system_time_us_64, system_to_system_us_64, never_synced},
+ mode_{OFF}, next_seconds_{0}, send_pending_{false}, sent_count_{0},
+ skipped_count_{0}
+{
+    // Create a pointer to the first (and one-and-only) instance created.
+    if (self == nullptr)
+        self = this;
+    // Setup uart unless the synchronizer already has (for its RX half).
+    if (!uart_is_enabled(uart_id_))
+    {
+        uart_init(uart_id_, HARP_SYNC_BAUDRATE);
+        uart_set_hw_flow(uart_id_, false, false);
+        uart_set_format(uart_id_, HARP_SYNC_DATA_BITS, HARP_SYNC_STOP_BITS,
+                        HARP_SYNC_PARITY);
+    }
+    // Setup the TX pin by using the function select on the GPIO
+    gpio_set_function(uart_tx_pin, GPIO_FUNC_UART);
+    // Claim an alarm whose interrupt runs on this core.
+    alarm_num_ = hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(alarm_num_, alarm_callback);
+}
+
+HarpClockOutput::~HarpClockOutput(){self = nullptr;}
+
+HarpClockOutput& HarpClockOutput::init(uart_inst_t* uart_id,
+                                       uint8_t uart_tx_pin)
+{
+    static HarpClockOutput clock_output(uart_id, uart_tx_pin);
+    return clock_output;
+}
+
+void HarpClockOutput::set_time_source(const TimeSource& source)
+{
+    uint32_t interrupt_status = save_and_disable_interrupts();
+    self->source_ = source;
+    // Reschedule the next packet from the new Harp time.
+    if (self->mode_ != OFF)
+    {
+        hardware_alarm_cancel(self->alarm_num_);
+        self->arm_packet();
+    }
+    restore_interrupts(interrupt_status);
+}
+
+void HarpClockOutput::set_mode(Mode mode)
+{
+    uint32_t interrupt_status = save_and_disable_interrupts();
+    hardware_alarm_cancel(self->alarm_num_);
+    self->mode_ = mode;
+    if (mode != OFF)
+        self->arm_packet();
+    restore_interrupts(interrupt_status);
+}
+
+void HarpClockOutput::alarm_callback(uint alarm_num)
+{
+    (void)alarm_num;
+    if (self->send_pending_)
+        self->send_packet();
+    if (self->mode_ != OFF)
+        self->arm_packet();
+}
+
+void HarpClockOutput::arm_packet()
+{
+    uint64_t harp_us = source_.harp_time_us_64();
+    next_seconds_ = HarpSyncEncoder::next_seconds(
+        harp_us + HARP_CLOCK_OUTPUT_MIN_LEAD_US,
+        HARP_CLOCK_OUTPUT_START_OFFSET_US);
+    while (true)
+    {
+        uint64_t start_us = source_.harp_to_system_us_64(
+            HarpSyncEncoder::packet_start_harp_us(
+                next_seconds_, HARP_CLOCK_OUTPUT_START_OFFSET_US));
+        // Convert far-off starts again closer in, since the Harp time may
+        // change rate or step in the meantime.
+        int64_t lead_us = int64_t(start_us - ::time_us_64());
+        send_pending_ = (lead_us <= HARP_CLOCK_OUTPUT_REARM_US);
+        uint64_t alarm_us = send_pending_?
+                                start_us:
+                                start_us - HARP_CLOCK_OUTPUT_REARM_US;
+        if (!hardware_alarm_set_target(alarm_num_,
+                                       from_us_since_boot(alarm_us)))
+            return;
+        // The start passed while scheduling it. Move on to the next packet.
+        ++next_seconds_;
+    }
+}
+
+void HarpClockOutput::send_packet()
+{
+    if (mode_ == OFF || (mode_ == REPEAT && !source_.is_synced()))
+        return;
+    // Skip the packet rather than mark the wrong time downstream.
+    int64_t late_us = int64_t(source_.harp_time_us_64()
+        - HarpSyncEncoder::packet_start_harp_us(
+            next_seconds_, HARP_CLOCK_OUTPUT_START_OFFSET_US));
+    if (late_us > HARP_CLOCK_OUTPUT_MAX_LATE_US
+        || late_us < -HARP_CLOCK_OUTPUT_MAX_LATE_US)
+    {
+        skipped_count_ = skipped_count_ + 1;
+        return;
+    }
+    uint8_t packet[HARP_SYNC_PACKET_SIZE];
+    HarpSyncEncoder::encode(next_seconds_, packet);
+    // The packet fits in the uart's TX FIFO, so this does not block, and
+    // the bytes go out back-to-back.
+    uart_write_blocking(uart_id_, packet, sizeof(packet));
+    sent_count_ = sent_count_ + 1;
+}
@@ -24,13 +24,36 @@ HarpCore::HarpCore(uint16_t who_am_i,
                    uint8_t fw_version_major, uint8_t fw_version_minor,
                    uint16_t serial_number, const char name[],
                    const uint8_t tag[])
-:regs_{who_am_i, hw_version_major, hw_version_minor, assembly_version,
-       harp_version_major, harp_version_minor,
-       fw_version_major, fw_version_minor, serial_number, name, tag},
- rx_buffer_index_{0}, total_bytes_read_{rx_buffer_index_}, new_msg_{false},
- set_visual_indicators_fn_{nullptr}, sync_{nullptr}, offset_us_64_{0},
+:new_msg_{false, false}, rx_msg_time_us_{0, 0},
+ reply_latency_pending_{false, false}, reply_latency_bins_{},
+ set_visual_indicators_fn_{nullptr}, sync_{nullptr}, clock_output_{nullptr},
+ rx_ring_head_{0}, rx_ring_tail_{0}, rx_msg_{rx_buffer_, rx_buffer_},
+ second_cache_{{0, 0}, {0, 0}},
+ max_msgs_per_run_{MAX_MSGS_PER_RUN}, rx_last_byte_time_us_{0},
+ rx_chunk_head_{0}, rx_chunk_tail_{0},
+ rx_discarded_byte_count_{0}, rx_checksum_error_count_{0},
+ rx_timeout_count_{0},
+ offset_us_64_{0},
+ offset_us_32_{0},
+ next_heartbeat_seconds_{0}, heartbeat_alarm_id_{0},
+ heartbeat_rearm_pending_{false},
+ heartbeat_lock_{spin_lock_instance(spin_lock_claim_unused(true))},
+ heartbeat_interval_s_{HEARTBEAT_STANDBY_INTERVAL_US / 1'000'000UL},
+ sync_event_countdown_s_{0},
  disconnect_handled_{false}, connect_handled_{false}, sync_handled_{false},
- heartbeat_interval_us_{HEARTBEAT_STANDBY_INTERVAL_US}
+ tx_flush_policy_{FLUSH_PER_MSG}, tx_max_latency_us_{TX_FLUSH_MAX_LATENCY_US},
+ tx_pending_{false}, tx_reply_pending_{false},
+ tx_stalled_{false}, tx_stall_count_{0}, tx_drop_count_{0},
+ cdc_rx_irq_enabled_{false}, dual_core_enabled_{false},
+ app_reset_pending_{false},
+ tx_queue_head_{0}, tx_queue_tail_{0}, tx_overflow_policy_{DROP_NEWEST},
+ tx_drop_counts_{}, tx_drop_total_{0},
+ tx_drop_lock_{spin_lock_instance(spin_lock_claim_unused(true))},
+ speed_stream_count_{0}, speed_period_us_{0}, next_speed_stream_us_{0},
+ last_state_update_us_{0},
+ regs_{who_am_i, hw_version_major, hw_version_minor, assembly_version,
+       harp_version_major, harp_version_minor,
+       fw_version_major, fw_version_minor, serial_number, name, tag}
 {
     // Create a pointer to the first (and one-and-only) instance created.
     if (self == nullptr)
@@ -44,21 +67,309 @@ HarpCore::HarpCore(uint16_t who_am_i,
 #else
 #pragma warning("Harp Core Register UUID not autodetected for this board.")
 #endif
+    HarpProfiler::init_ticks();
     // Initialize next heartbeat.
     update_next_heartbeat_from_curr_harp_time_us(harp_time_us_64());
 }
 
 HarpCore::~HarpCore(){self = nullptr;}
 
-void HarpCore::run()
+bool HarpCore::receive_msg()
+{
+    // Drain queued messages first, even if the RX interrupt has since been
+    // disabled.
+    msg_buffer_t* queued_msg = rx_msg_queue_.front();
+    if (queued_msg != nullptr)
+    {
+        set_buffered_msg(queued_msg->data, queued_msg->rx_time_us);
+        return true;
+    }
+    if (not cdc_rx_irq_enabled_)
+        process_cdc_input();
+    return false;
+}
+
+void HarpCore::launch_core1()
+{
+    if (self->dual_core_enabled_)
+        return;
+    // Core1 polls TinyUSB instead.
+    // Note: the USB interrupt stays on core0. TinyUSB's event queue is guarded
+    // by a multicore-safe critical section, so tud_task() may run on core1.
+    set_cdc_rx_irq_enabled(false);
+    self->dual_core_enabled_ = true;
+    multicore_launch_core1(core1_main);
+}
+
+void HarpCore::core1_main()
+{
+    HarpProfiler::init_ticks(); // SysTick is per-core.
+    while (true)
+    {
+        self->run_engine();
+        tight_loop_contents();
+    }
+}
+
+void HarpCore::run_engine()
 {
+    HARP_PROFILE_STAMP(run_start);
+    HARP_PROFILE_STAMP(phase_start);
     tud_task();
-    update_state();
-    update_app_state(); // Does nothing unless a derived class implements it.
-    process_cdc_input();
-    if (not new_msg_)
+    HARP_PROFILE_MARK(phase_start, USB_TASK);
+    if (state_update_due())
+        update_state();
+    HARP_PROFILE_MARK(phase_start, UPDATE_STATE);
+    // Send what core0 has queued, in order. Like core1's own messages, these
+    // wait for room in the TX FIFO and are dropped (and counted) once the PC
+    // stops reading, so a stalled PC never blocks core0 for good.
+    for (msg_buffer_t* frame = app_tx_queue_.front(); frame != nullptr;
+         frame = app_tx_queue_.front())
+    {
+        uint16_t frame_size = uint16_t(frame->data[1]) + 2;
+        write_frame(frame->data, frame_size, msg_type_t(frame->data[0]));
+        app_tx_queue_.pop();
+    }
+    HARP_PROFILE_MARK(phase_start, TX);
+    // Handle core register messages here and forward the rest to core0.
+    for (uint8_t msg_count = 0; msg_count < max_msgs_per_run_; ++msg_count)
+    {
+        msg_buffer_t* app_msg = app_msg_queue_.back();
+        if (app_msg == nullptr)
+            break; // Leave input buffered until core0 catches up.
+        process_cdc_input();
+        HARP_PROFILE_MARK(phase_start, RECEIVE);
+        if (not new_msg())
+            break;
+        if (Registers::is_core_address(get_buffered_msg_header().address))
+        {
+            handle_buffered_core_message();
+            HARP_PROFILE_MARK(phase_start, DISPATCH);
+            continue;
+        }
+        uint8_t* msg = rx_msg_[1];
+        memcpy(app_msg->data, msg, uint16_t(msg[1]) + 2);
+        app_msg->rx_time_us = rx_msg_time_us_[1];
+        app_msg_queue_.push();
+        clear_msg();
+        HARP_PROFILE_MARK(phase_start, DISPATCH);
+    }
+    HARP_PROFILE_STAMP(tx_start);
+    publish_speed_stream();
+    send_queued_events();
+    update_tx_flush();
+    HARP_PROFILE_MARK(tx_start, TX);
+    HARP_PROFILE_MARK(run_start, RUN);
+}
+
+bool HarpCore::set_speed_stream(const uint8_t* reg_names, uint8_t reg_count,
+                                uint32_t rate_hz)
+{
+    if (reg_count > SPEED_STREAM_MAX_REGS)
+        return false;
+    // Each timestamped message must fit its one-byte length.
+    for (uint8_t i = 0; i < reg_count; ++i)
+    {
+        if (self->reg_address_to_specs(reg_names[i]).num_bytes
+            > MAX_PACKET_SIZE - 10)
+            return false;
+    }
+    // Stop the stream while it changes.
+    self->speed_period_us_ = 0;
+    for (uint8_t i = 0; i < reg_count; ++i)
+    {
+        const RegSpecs& specs = self->reg_address_to_specs(reg_names[i]);
+        speed_stream_t& stream = self->speed_streams_[i];
+        stream.header = msg_header_t{EVENT, uint8_t(specs.num_bytes + 10),
+                                     reg_names[i], 255,
+                                     (reg_type_t)(HAS_TIMESTAMP
+                                                  | specs.payload_type)};
+        stream.data = specs.base_ptr;
+    }
+    self->speed_stream_count_ = reg_count;
+    self->next_speed_stream_us_ = ::time_us_64();
+    if (rate_hz == 0 || reg_count == 0)
+        return true;
+    self->speed_period_us_ = (rate_hz > 1'000'000UL)? 1: 1'000'000UL / rate_hz;
+    return true;
+}
+
+void HarpCore::publish_speed_stream()
+{
+    if ((regs_.r_operation_ctrl_bits.OP_MODE != SPEED)
+        || (speed_period_us_ == 0) || is_muted())
+        return;
+    uint64_t time_us = ::time_us_64();
+    if (time_us < next_speed_stream_us_)
         return;
+    // Skip periods missed while run() was busy. Only current values matter.
+    next_speed_stream_us_ += speed_period_us_;
+    if (next_speed_stream_us_ <= time_us)
+        next_speed_stream_us_ = time_us + speed_period_us_;
+    // One timestamp for the whole batch.
+    uint32_t seconds;
+    uint16_t micros;
+    split_harp_time_us(system_to_harp_us_64(time_us), seconds, micros);
+    lock_usb();
+    uint32_t bytes_free = tud_cdc_write_available();
+    for (uint8_t i = 0; i < speed_stream_count_; ++i)
+    {
+        speed_stream_t& stream = speed_streams_[i];
+        uint16_t frame_size = stream.header.msg_size();
+        if (bytes_free < frame_size)
+        {
+            count_tx_drop(stream.header.address);
+            continue;
+        }
+        bytes_free -= frame_size;
+        assemble_frame(tx_buffer_, stream.header, stream.data, seconds, micros);
+        tud_cdc_write(tx_buffer_, frame_size);
+    }
+    tud_cdc_write_flush(); // Once per batch, whatever the flush policy.
+    unlock_usb();
+}
+
+bool HarpCore::queue_harp_event(uint8_t reg_name, const volatile uint8_t* data,
+                                uint8_t num_bytes, reg_type_t payload_type,
+                                uint64_t system_time_us)
+{
+    if (num_bytes > EVENT_MAX_PAYLOAD_SIZE)
+        return false;
+    queued_event_t* event = self->event_queue_.reserve();
+    if (event == nullptr)
+    {
+        count_tx_drop(reg_name);
+        return false;
+    }
+    event->system_time_us = system_time_us;
+    event->address = reg_name;
+    event->num_bytes = num_bytes;
+    event->payload_type = payload_type;
+    memcpy(event->payload, (const void*)data, num_bytes);
+    self->event_queue_.commit(event);
+    return true;
+}
+
+void HarpCore::send_queued_events()
+{
+    // Free the event queue for producers, even while the PC is not reading.
+    for (uint8_t event_count = 0; event_count < EVENT_QUEUE_DEPTH;
+         ++event_count)
+    {
+        queued_event_t* event = event_queue_.front();
+        if (event == nullptr)
+            break;
+        push_tx_event(*event);
+        event_queue_.pop();
+    }
+    // Send without waiting on the TX FIFO. Whatever does not fit waits here.
+    while (tx_queue_tail_ != tx_queue_head_)
+    {
+        queued_event_t& event =
+            tx_queue_[tx_queue_tail_ & (TX_QUEUE_DEPTH - 1)];
+        if (tud_cdc_write_available() < uint32_t(event.num_bytes) + 12)
+            return;
+        send_harp_reply(EVENT, event.address, event.payload, event.num_bytes,
+                        event.payload_type,
+                        system_to_harp_us_64(event.system_time_us));
+        ++tx_queue_tail_;
+    }
+}
+
+void HarpCore::push_tx_event(const queued_event_t& event)
+{
+    if (uint8_t(tx_queue_head_ - tx_queue_tail_) == TX_QUEUE_DEPTH)
+    {
+        switch (tx_overflow_policy_)
+        {
+            case DROP_OLDEST:
+                count_tx_drop(
+                    tx_queue_[tx_queue_tail_ & (TX_QUEUE_DEPTH - 1)].address);
+                ++tx_queue_tail_;
+                break;
+            case COALESCE_LATEST:
+                // Search from the newest so that the register's values stay
+                // in order.
+                for (uint8_t index = tx_queue_head_;
+                     index != tx_queue_tail_; --index)
+                {
+                    queued_event_t& queued =
+                        tx_queue_[uint8_t(index - 1) & (TX_QUEUE_DEPTH - 1)];
+                    if (queued.address != event.address)
+                        continue;
+                    count_tx_drop(queued.address);
+                    queued = event;
+                    return;
+                }
+                count_tx_drop(event.address);
+                return;
+            default: // DROP_NEWEST
+                count_tx_drop(event.address);
+                return;
+        }
+    }
+    tx_queue_[tx_queue_head_ & (TX_QUEUE_DEPTH - 1)] = event;
+    ++tx_queue_head_;
+}
+
+void HarpCore::set_cdc_rx_irq_enabled(bool enabled)
+{
+    if (enabled == self->cdc_rx_irq_enabled_)
+        return;
+#if defined(PICO_RP2040)
+    if (enabled)
+    {
+        // Service TinyUSB from a low-priority interrupt that is pended by
+        // USB activity (like pico_stdio_usb does).
+        usb_task_irq_ = user_irq_claim_unused(true);
+        irq_set_exclusive_handler(usb_task_irq_, usb_task_irq_handler);
+        irq_add_shared_handler(USBCTRL_IRQ, usb_irq_handler,
+                               PICO_SHARED_IRQ_HANDLER_LOWEST_ORDER_PRIORITY);
+        self->cdc_rx_irq_enabled_ = true;
+        irq_set_enabled(usb_task_irq_, true);
+        irq_set_pending(usb_task_irq_); // Pick up anything already received.
+        return;
+    }
+    irq_set_enabled(usb_task_irq_, false);
+    self->cdc_rx_irq_enabled_ = false;
+    irq_remove_handler(USBCTRL_IRQ, usb_irq_handler);
+    irq_remove_handler(usb_task_irq_, usb_task_irq_handler);
+    user_irq_unclaim(usb_task_irq_);
+#else
+    self->cdc_rx_irq_enabled_ = enabled;
+#endif
+}
+
+void tud_cdc_rx_cb(uint8_t itf)
+{
+    (void)itf;
+    HarpCore* core = HarpCore::self;
+    if ((core == nullptr) || not core->cdc_rx_irq_enabled_)
+        return;
+    core->queue_cdc_input();
+}
+
+void HarpCore::queue_cdc_input()
+{
+    // Parse and queue messages until we run out of room. Anything left over
+    // stays in the ring buffer (or TinyUSB's FIFO) until the next interrupt.
+    read_cdc_into_rx_ring();
+    while (true)
+    {
+        msg_buffer_t* queued_msg = rx_msg_queue_.back();
+        if (queued_msg == nullptr)
+            return;
+        uint8_t* msg = pop_rx_ring_msg(queued_msg->rx_time_us);
+        if (msg == nullptr)
+            return;
+        memcpy(queued_msg->data, msg, uint16_t(msg[1]) + 2);
+        rx_msg_queue_.push();
+    }
+}
+
 #ifdef DEBUG_HARP_MSG_IN
+void HarpCore::print_buffered_msg()
+{
     msg_t msg = get_buffered_msg();
     printf("Msg data: \r\n");
     printf("  type: %d\r\n", msg.header.type);
@@ -75,82 +386,225 @@ void HarpCore::run()
             printf("%d, ", ((uint8_t*)(msg.payload))[i]);
     }
     printf("\r\n\r\n");
+}
 #endif
-    // Handle in-range register msgs and clear them. Ignore out-of-range msgs.
-    handle_buffered_core_message(); // Handle msg. Clear it if handled.
-    if (not new_msg_)
+
+void HarpCore::update_tx_flush()
+{
+    if (not tx_pending_)
         return;
-    handle_buffered_app_message(); // Handle msg. Clear it if handled.
-    // Always clear any unhandled messages, so we don't lock up.
-    if (new_msg_)
+    lock_usb();
+    // TinyUSB sends full packets on its own. Nothing left to do if the FIFO
+    // has emptied.
+    if (tud_cdc_write_available() == CFG_TUD_CDC_TX_BUFSIZE)
     {
-#ifdef DEBUG_HARP_MSG_IN
-    printf("Ignoring out-of-range msg!\r\n");
-#endif
-        clear_msg();
+        unlock_usb();
+        tx_pending_ = false;
+        tx_reply_pending_ = false;
+        return;
+    }
+    bool flush = tx_reply_pending_;
+    switch (tx_flush_policy_)
+    {
+        case FLUSH_PER_RUN:
+            flush = true;
+            break;
+        case FLUSH_ON_DEADLINE:
+            flush |= (::time_us_32() - tx_pending_start_time_us_)
+                     >= tx_max_latency_us_;
+            break;
+        default: // FLUSH_ON_FULL_PACKET
+            break;
+    }
+    if (flush)
+    {
+        tud_cdc_write_flush();
+        tx_pending_ = false;
+        tx_reply_pending_ = false;
     }
+    unlock_usb();
 }
 
 void HarpCore::process_cdc_input()
 {
-    // TODO: Consider a timeout if we never receive a fully formed message.
-    // TODO: scan for partial messages.
-    // Fetch all data in the serial port. If it's at least a header's worth,
-    // check the payload size and keep reading up to the end of the packet.
-    if (not tud_cdc_available())
-        return;
-    // If the header has arrived, only read up to the full payload so we can
-    // process one message at a time.
-    uint32_t max_bytes_to_read = sizeof(rx_buffer_) - rx_buffer_index_;
-    if (total_bytes_read_ >= sizeof(msg_header_t))
-    {
-        // Reinterpret contents of the rx buffer as a message header.
-        msg_header_t& header = get_buffered_msg_header();
-        // Read only the remainder of a single harp message.
-        max_bytes_to_read = header.msg_size() - total_bytes_read_;
-    }
-    uint32_t bytes_read = tud_cdc_read(&(rx_buffer_[rx_buffer_index_]),
-                                       max_bytes_to_read);
-    rx_buffer_index_ += bytes_read;
-    // See if we have a message header's worth of data yet. Baily early if not.
-    if (total_bytes_read_ < sizeof(msg_header_t))
-        return;
-    // Reinterpret contents of the rx buffer as a message header.
-    msg_header_t& header = get_buffered_msg_header();
-    // Bail early if the full message (with payload) has not fully arrived.
-    if (total_bytes_read_ < header.msg_size())
+    read_cdc_into_rx_ring();
+    uint32_t rx_time_us;
+    uint8_t* msg = pop_rx_ring_msg(rx_time_us);
+    if (msg == nullptr)
         return;
-    rx_buffer_index_ = 0; // Reset buffer index for the next message.
-    new_msg_ = true;
-    return;
+    set_buffered_msg(msg, rx_time_us);
+}
+
+void HarpCore::read_cdc_into_rx_ring()
+{
+    // Fetch as much data from the serial port as fits in the ring buffer.
+    uint16_t free_bytes = RX_RING_SIZE
+                          - uint16_t(rx_ring_head_ - rx_ring_tail_);
+    while (free_bytes && tud_cdc_available())
+    {
+        uint16_t head_index = rx_ring_head_ & (RX_RING_SIZE - 1);
+        uint16_t max_bytes_to_read = RX_RING_SIZE - head_index;
+        if (max_bytes_to_read > free_bytes)
+            max_bytes_to_read = free_bytes;
+        uint32_t bytes_read = tud_cdc_read(&rx_ring_[head_index],
+                                           max_bytes_to_read);
+        if (bytes_read == 0)
+            break;
+        rx_ring_head_ += bytes_read;
+        free_bytes -= bytes_read;
+        rx_last_byte_time_us_ = ::time_us_32();
+        // Log when these bytes arrived, or fold them into the newest entry
+        // if the log is full.
+        if (uint8_t(rx_chunk_head_ - rx_chunk_tail_) < RX_CHUNK_LOG_DEPTH)
+        {
+            rx_chunks_[rx_chunk_head_ & (RX_CHUNK_LOG_DEPTH - 1)] =
+                rx_chunk_t{rx_ring_head_, rx_last_byte_time_us_};
+            ++rx_chunk_head_;
+        }
+        else
+            rx_chunks_[(rx_chunk_head_ - 1) & (RX_CHUNK_LOG_DEPTH - 1)].end =
+                rx_ring_head_;
+    }
+}
+
+uint32_t HarpCore::rx_ring_tail_time_us()
+{
+    // Drop reads whose bytes have all been consumed.
+    while (rx_chunk_head_ != rx_chunk_tail_)
+    {
+        const rx_chunk_t& chunk =
+            rx_chunks_[rx_chunk_tail_ & (RX_CHUNK_LOG_DEPTH - 1)];
+        if (int16_t(chunk.end - rx_ring_tail_) > 0)
+            return chunk.time_us;
+        ++rx_chunk_tail_;
+    }
+    return rx_last_byte_time_us_; // should never happen.
+}
+
+uint8_t* HarpCore::pop_rx_ring_msg(uint32_t& rx_time_us)
+{
+    // Scan for the next valid message. Discard one byte at a time from the
+    // front of the ring buffer until one is found so that we resynchronize
+    // on the next message boundary after corrupted or partial messages.
+    bool timed_out = false;
+    while (true)
+    {
+        uint16_t bytes_buffered = rx_ring_head_ - rx_ring_tail_;
+        if (bytes_buffered == 0)
+            return nullptr;
+        if (not rx_ring_msg_is_plausible(bytes_buffered))
+        {
+            ++rx_ring_tail_;
+            ++rx_discarded_byte_count_;
+            continue;
+        }
+        // Note: plausible headers have a raw length of at least 4.
+        uint16_t msg_size = (bytes_buffered >= sizeof(msg_header_t))?
+                                uint16_t(rx_ring_peek(1)) + 2:
+                                sizeof(msg_header_t) + 1;
+        if (bytes_buffered >= msg_size)
+        {
+            if (rx_ring_msg_checksum_ok(msg_size))
+                break;
+            ++rx_checksum_error_count_;
+            ++rx_ring_tail_;
+            ++rx_discarded_byte_count_;
+            continue;
+        }
+        // Wait for the rest of the message unless the PC has gone quiet.
+        // If so, everything left is garbage unless a complete message is
+        // hiding behind it, so keep scanning.
+        if (not timed_out
+            && (::time_us_32() - rx_last_byte_time_us_) < RX_TIMEOUT_US)
+            return nullptr;
+        if (not timed_out)
+            ++rx_timeout_count_;
+        timed_out = true;
+        ++rx_ring_tail_;
+        ++rx_discarded_byte_count_;
+    }
+    rx_time_us = rx_ring_tail_time_us();
+    // Refer to the message in place unless it wraps around the end of the
+    // ring buffer.
+    uint8_t* msg = rx_buffer_;
+    uint16_t tail_index = rx_ring_tail_ & (RX_RING_SIZE - 1);
+    uint16_t msg_size = uint16_t(rx_ring_peek(1)) + 2;
+    if (tail_index + msg_size <= RX_RING_SIZE)
+        msg = &rx_ring_[tail_index];
+    else
+    {
+        uint16_t first_chunk_size = RX_RING_SIZE - tail_index;
+        memcpy(rx_buffer_, &rx_ring_[tail_index], first_chunk_size);
+        memcpy(&rx_buffer_[first_chunk_size], rx_ring_,
+               msg_size - first_chunk_size);
+    }
+    rx_ring_tail_ += msg_size;
+    return msg;
+}
+
+bool HarpCore::rx_ring_msg_is_plausible(uint16_t bytes_buffered)
+{
+    // PC-to-device messages are only reads or writes.
+    msg_type_t type = msg_type_t(rx_ring_peek(0));
+    if (type != READ && type != WRITE)
+        return false;
+    if (bytes_buffered < sizeof(msg_header_t))
+        return true;
+    uint8_t raw_length = rx_ring_peek(1);
+    reg_type_t payload_type = reg_type_t(rx_ring_peek(4));
+    // Payload type must be a known element size with known flags.
+    uint8_t element_size = payload_type & 0x0F;
+    if ((payload_type & ~(IS_SIGNED | IS_FLOAT | HAS_TIMESTAMP | 0x0F))
+        || (element_size != 1 && element_size != 2 && element_size != 4
+            && element_size != 8))
+        return false;
+    // Payload must be a whole number of elements.
+    uint8_t overhead = (payload_type & HAS_TIMESTAMP)? 10: 4;
+    if (raw_length < overhead)
+        return false;
+    return ((raw_length - overhead) % element_size) == 0;
+}
+
+bool HarpCore::rx_ring_msg_checksum_ok(uint16_t msg_size)
+{
+    uint8_t checksum = 0;
+    for (uint16_t i = 0; i < msg_size - 1; ++i)
+        checksum += rx_ring_peek(i);
+    return checksum == rx_ring_peek(msg_size - 1);
 }
 
 msg_t HarpCore::get_buffered_msg()
 {
     // Reinterpret (i.e: type pun) contents of the uart rx buffer as a message.
     // Use references and ptrs to existing data so we don't make any copies.
-    msg_header_t& header = get_buffered_msg_header();
-    void* payload = rx_buffer_ + header.payload_base_index_offset();
-    uint8_t& checksum = *(rx_buffer_ + header.checksum_index_offset());
+    uint8_t* rx_msg = rx_msg_[get_core_num()];
+    msg_header_t& header = *((msg_header_t*)rx_msg);
+    void* payload = rx_msg + header.payload_base_index_offset();
+    uint8_t& checksum = *(rx_msg + header.checksum_index_offset());
     return msg_t{header, payload, checksum};
 }
 
 void HarpCore::handle_buffered_core_message()
 {
     msg_t msg = get_buffered_msg();
-    // TODO: check checksum.
+    // Note: checksum has already been validated in process_cdc_input().
     // Note: PC-to-Harp msgs don't have timestamps, so we don't check for them.
     // Ignore out-of-range messages. Expect them to be handled by derived class.
-    if (msg.header.address > CORE_REG_COUNT)
+    if (!Registers::is_core_address(msg.header.address))
         return;
+    const RegFnPair& fns = (msg.header.address < CORE_REG_COUNT)?
+        reg_func_table_[msg.header.address]:
+        (msg.header.address < SYNC_REG_START_ADDRESS)?
+        diag_reg_func_table_[msg.header.address - DIAG_REG_START_ADDRESS]:
+        sync_reg_func_table_[msg.header.address - SYNC_REG_START_ADDRESS];
     // Handle read-or-write behavior.
     switch (msg.header.type)
     {
         case READ:
-            reg_func_table_[msg.header.address].read_fn_ptr(msg.header.address);
+            fns.read_fn_ptr(msg.header.address);
             break;
         case WRITE:
-            reg_func_table_[msg.header.address].write_fn_ptr(msg);
+            fns.write_fn_ptr(msg);
             break;
     }
     clear_msg();
@@ -160,8 +614,7 @@ void HarpCore::update_state(bool force, op_mode_t forced_next_state)
 {
     // Update internal logic.
     // Use 32-bit time representation since we are updating short intervals.
-    uint64_t harp_time_us = harp_time_us_64();
-    uint32_t time_us = harp_to_system_us_32(harp_time_us);
+    uint32_t time_us = ::time_us_32();
     bool tud_cdc_is_connected = tud_cdc_connected(); // Compute this once.
     bool is_synced = self->is_synced(); // Compute this once
     // Preserve flag value when synced; clear flag if we unsync.
@@ -181,9 +634,12 @@ void HarpCore::update_state(bool force, op_mode_t forced_next_state)
     // Extra logic to handle behavior that happens upon synchronizing.
     if (is_synced && !self->sync_handled_)
     {
-        update_next_heartbeat_from_curr_harp_time_us(harp_time_us);
+        update_next_heartbeat_from_curr_harp_time_us(harp_time_us_64());
         self->sync_handled_ = true;
     }
+    // Heartbeats missed while the alarm pool was full are skipped.
+    if (self->heartbeat_rearm_pending_)
+        update_next_heartbeat_from_curr_harp_time_us(harp_time_us_64());
     // Update state machine "next-state" logic.
     const uint8_t& state = self->regs_.r_operation_ctrl_bits.OP_MODE;
     uint8_t next_state = force? forced_next_state: state;
@@ -195,6 +651,7 @@ void HarpCore::update_state(bool force, op_mode_t forced_next_state)
                 if (tud_cdc_is_connected && !self->connect_handled_)
                     next_state = ACTIVE;
             case ACTIVE:
+            case SPEED:
                 // Drop to STANDBY if we've lost the PC connection for too long.
                 if (!tud_cdc_is_connected && self->disconnect_handled_
                     && (time_us - self->disconnect_start_time_us_)
@@ -203,8 +660,6 @@ void HarpCore::update_state(bool force, op_mode_t forced_next_state)
                 break;
             case RESERVED:
                 break;
-            case SPEED:
-                break;
             default:
                 break;
         }
@@ -214,49 +669,72 @@ void HarpCore::update_state(bool force, op_mode_t forced_next_state)
     if ((state != ACTIVE) && (next_state == ACTIVE))
     {
         self->connect_handled_ = true;
-        self->heartbeat_interval_us_ = HEARTBEAT_ACTIVE_INTERVAL_US;
+        self->heartbeat_interval_s_ =
+            HEARTBEAT_ACTIVE_INTERVAL_US / 1'000'000UL;
     }
-    if (state == ACTIVE && next_state == STANDBY)
+    if ((state == ACTIVE || state == SPEED) && next_state == STANDBY)
     {
-        self->heartbeat_interval_us_ = HEARTBEAT_STANDBY_INTERVAL_US;
+        self->heartbeat_interval_s_ =
+            HEARTBEAT_STANDBY_INTERVAL_US / 1'000'000UL;
     }
-    // Handle OPERATION_CTRL behavior.
-    if (int32_t(time_us - self->next_heartbeat_time_us_) >= 0)
+    // Handle in-state dependent output logic.
+    if ((state != SPEED) && (next_state == SPEED))
     {
-        self->next_heartbeat_time_us_ += self->heartbeat_interval_us_;
-        // Dispatch heartbeat msg and Blink LED.
-        if (self->regs_.r_operation_ctrl_bits.ALIVE_EN)
-        {
-            //if (self->regs_.r_operation_ctrl_bits.VISUALEN)
-            //    set_led(!get_led);
-            if ((state == ACTIVE) & !is_muted()) // i.e: events enabled
-                send_harp_reply(EVENT, TIMESTAMP_SECOND);
-        }
+        // The PC chose the mode. Start streaming right away.
+        self->connect_handled_ = true;
+        self->next_speed_stream_us_ = ::time_us_64();
+        self->last_state_update_us_ = time_us;
     }
-    // Handle in-state dependent output logic.
     // Do the state transition.
     self->regs_.r_operation_ctrl_bits.OP_MODE = next_state;
 }
 
-const RegSpecs& HarpCore::reg_address_to_specs(uint8_t address)
-{
-    if (address < CORE_REG_COUNT)
-        return regs_.address_to_specs[address];
-    return address_to_app_reg_specs(address); // virtual. Implemented by app.
-}
-
 void HarpCore::send_harp_reply(msg_type_t reply_type, uint8_t reg_name,
                                const volatile uint8_t* data, uint8_t num_bytes,
                                reg_type_t payload_type, uint64_t harp_time_us)
 {
-    // FIXME: implementation as-is cannot send more than 64 bytes of data
-    //  because of underlying usb implementation.
-    // Dispatch timestamped Harp reply.
+    if (reply_type != EVENT)
+        record_reply_latency();
+    // In dual-core mode, core0 hands complete messages to core1 to send.
+    // Leave the timestamp registers to core1.
+    if (self->dual_core_enabled_ && (get_core_num() == 0))
+    {
+        msg_buffer_t* frame;
+        while ((frame = self->app_tx_queue_.back()) == nullptr)
+            tight_loop_contents(); // Wait for core1 to send or drop one.
+        uint32_t seconds;
+        uint16_t micros;
+        split_harp_time_us(harp_time_us, seconds, micros);
+        assemble_frame(frame->data, reply_type, reg_name, data, num_bytes,
+                       payload_type, seconds, micros);
+        self->app_tx_queue_.push();
+        return;
+    }
+    self->set_timestamp_regs(harp_time_us);
+    uint16_t frame_size = assemble_frame(tx_buffer_, reply_type, reg_name,
+                                         data, num_bytes, payload_type,
+                                         self->regs.R_TIMESTAMP_SECOND,
+                                         self->regs.R_TIMESTAMP_MICRO);
+    write_frame(tx_buffer_, frame_size, reply_type);
+}
+
+uint16_t HarpCore::assemble_frame(uint8_t* frame, msg_type_t reply_type,
+                                  uint8_t reg_name,
+                                  const volatile uint8_t* data,
+                                  uint8_t num_bytes, reg_type_t payload_type,
+                                  uint32_t seconds, uint16_t micros)
+{
     // Note: This fn implementation assumes little-endian architecture.
     uint8_t raw_length = num_bytes + 10;
-    uint8_t checksum = 0;
     msg_header_t header{reply_type, raw_length, reg_name, 255,
                         (reg_type_t)(HAS_TIMESTAMP | payload_type)};
+    return assemble_frame(frame, header, data, seconds, micros);
+}
+
+uint16_t HarpCore::assemble_frame(uint8_t* frame, msg_header_t header,
+                                  const volatile uint8_t* data,
+                                  uint32_t seconds, uint16_t micros)
+{
 #ifdef DEBUG_HARP_MSG_OUT
     printf("Sending msg: \r\n");
     printf("  type: %d\r\n", header.type);
@@ -274,40 +752,85 @@ void HarpCore::send_harp_reply(msg_type_t reply_type, uint8_t reg_name,
     }
     printf("\r\n\r\n");
 #endif
-    // Push data into usb packet and send it.
-    for (uint8_t i = 0; i < sizeof(header); ++i) // push the header.
+    // Zero the last word first so the word-wise checksum can include it.
+    uint16_t checksum_offset = header.checksum_index_offset();
+    uint8_t word_count = (checksum_offset + 3) / 4;
+    ((uint32_t*)frame)[word_count - 1] = 0;
+    memcpy(frame, &header, sizeof(header));
+    memcpy(&frame[sizeof(header)], &seconds, sizeof(seconds));
+    memcpy(&frame[sizeof(header) + sizeof(seconds)], &micros, sizeof(micros));
+    // TODO: should we lockout global interrupts to prevent reg data from
+    //  changing underneath us?
+    memcpy(&frame[header.payload_base_index_offset()], (const void*)data,
+           header.payload_length());
+    frame[checksum_offset] = checksum_words((uint32_t*)frame, word_count);
+    return header.msg_size();
+}
+
+void HarpCore::write_frame(const uint8_t* frame, uint16_t frame_size,
+                           msg_type_t reply_type)
+{
+    lock_usb();
+    // Write whole messages only. A partial one would corrupt the stream.
+    // Once a message has been dropped, drop the rest without waiting again
+    // until the PC makes room.
+    if ((tud_cdc_write_available() < frame_size)
+        && (self->tx_stalled_ || not wait_for_tx_space(frame_size)))
     {
-        uint8_t& byte = *(((uint8_t*)(&header))+i);
-        checksum += byte;
-        tud_cdc_write_char(byte);
+        self->tx_stalled_ = true;
+        self->tx_drop_count_ = self->tx_drop_count_ + 1;
+        count_tx_drop(frame[2]);
+        unlock_usb();
+        return;
     }
-    self->set_timestamp_regs(harp_time_us); // update and push timestamp.
-    for (uint8_t i = 0; i < sizeof(self->regs.R_TIMESTAMP_SECOND); ++i)
+    self->tx_stalled_ = false;
+    tud_cdc_write(frame, frame_size);
+    if (self->tx_flush_policy_ == FLUSH_PER_MSG)
     {
-        uint8_t& byte = *(((uint8_t*)(&self->regs.R_TIMESTAMP_SECOND)) + i);
-        checksum += byte;
-        tud_cdc_write_char(byte);
+        tud_cdc_write_flush();  // Send usb packet, even if not full.
+        // Call tud_task to handle case we issue multiple harp replies in a row.
+        // Note: the USB interrupt does this for us if enabled.
+        if (not usb_serviced_by_irq())
+            tud_task();
+        unlock_usb();
+        return;
     }
-    for (uint8_t i = 0; i < sizeof(self->regs.R_TIMESTAMP_MICRO); ++i)
+    // Defer flushing to update_tx_flush() at the end of run().
+    if (not self->tx_pending_)
     {
-        uint8_t& byte = *(((uint8_t*)(&self->regs.R_TIMESTAMP_MICRO)) + i);
-        checksum += byte;
-        tud_cdc_write_char(byte);
+        self->tx_pending_ = true;
+        self->tx_pending_start_time_us_ = ::time_us_32();
     }
-    // TODO: should we lockout global interrupts to prevent reg data from
-    //  changing underneath us?
-    for (uint8_t i = 0; i < num_bytes; ++i) // push the payload data.
+    self->tx_reply_pending_ |= (reply_type != EVENT);
+    // Let TinyUSB drain full packets before the FIFO runs out of room.
+    if ((not usb_serviced_by_irq())
+        && (tud_cdc_write_available() < CFG_TUD_CDC_EP_BUFSIZE))
+        tud_task();
+    unlock_usb();
+}
+
+bool HarpCore::wait_for_tx_space(uint16_t frame_size)
+{
+    self->tx_stall_count_ = self->tx_stall_count_ + 1;
+    uint32_t start_time_us = ::time_us_32();
+    while (tud_cdc_write_available() < frame_size)
     {
-        const volatile uint8_t& byte = *(data + i);
-        checksum += byte;
-        tud_cdc_write_char(byte);
+        // Nothing drains the FIFO while the port is closed.
+        if (not tud_cdc_connected()
+            || ((::time_us_32() - start_time_us) >= TX_STALL_TIMEOUT_US))
+            return false;
+        tud_cdc_write_flush(); // Send a partial packet too, if that is all.
+        if (usb_serviced_by_irq())
+        {
+            // Let the USB interrupt complete the transfer.
+            unlock_usb();
+            tight_loop_contents();
+            lock_usb();
+        }
+        else
+            tud_task();
     }
-    tud_cdc_write_char(checksum); // push the checksum.
-    tud_cdc_write_flush();  // Send usb packet, even if not full.
-    // Call tud_task to handle case we issue multiple harp replies in a row.
-    // FIXME: a better way might be to check tinyusb's internal buffer's
-    // remaining space.
-    tud_task();
+    return true;
 }
 
 void HarpCore::read_reg_generic(uint8_t reg_name)
@@ -337,22 +860,347 @@ void HarpCore::write_to_read_only_reg_error(msg_t& msg)
 
 void HarpCore::set_timestamp_regs(uint64_t harp_time_us)
 {
-    // RP2040 implementation:
-    // Harp Time is computed as an offset relative to the RP2040's main
-    // timer register, which ticks every 1[us].
-    // Note: R_TIMESTAMP_MICRO can only represent values up to 31249.
-    // Note: Update microseconds first.
-#if defined(PICO_RP2040)
-    uint64_t leftover_microseconds;
-    uint64_t curr_seconds = divmod_u64u64_rem(harp_time_us, 1'000'000UL,
-                                              &leftover_microseconds);
-    self->regs.R_TIMESTAMP_SECOND = uint32_t(curr_seconds); // will not overflow.
-    self->regs.R_TIMESTAMP_MICRO = uint16_t(leftover_microseconds >> 5);
-#else
-    uint64_t& curr_microseconds = harp_time_us;
-    self->regs.R_TIMESTAMP_SECOND = curr_microseconds / 1'000'000ULL;
-    self->regs.R_TIMESTAMP_MICRO = uint16_t((curr_microseconds % 1'000'000UL)>>5);
-#endif
+    uint32_t seconds;
+    uint16_t micros;
+    split_harp_time_us(harp_time_us, seconds, micros);
+    self->regs.R_TIMESTAMP_SECOND = seconds;
+    self->regs.R_TIMESTAMP_MICRO = micros;
+}
+
+uint32_t HarpCore::update_second_cache(uint64_t harp_time_us,
+                                       uint32_t& elapsed_us)
+{
+    uint32_t seconds = divide_harp_time_us(harp_time_us, elapsed_us);
+    second_cache_t& cache = self->second_cache_[get_core_num()];
+    cache.start_us = harp_time_us - elapsed_us;
+    cache.seconds = seconds;
+    return seconds;
+}
+
+uint32_t HarpCore::divide_harp_time_us(uint64_t harp_time_us,
+                                       uint32_t& elapsed_us)
+{
+    uint32_t seconds;
+    if (harp_time_us < 4'294'967'296'000'000ULL) // i.e: seconds fit 32 bits.
+    {
+        // Underestimate the quotient from the upper bits:
+        // t / 10^6 ~= (t >> 20) * 1.048576, where 0.048576 ~= 208632331/2^32.
+        // The estimate is at most 3 too low. Correct it with the remainder.
+        uint32_t upper_bits = uint32_t(harp_time_us >> 20);
+        seconds = upper_bits
+                  + uint32_t((uint64_t(upper_bits) * 208632331UL) >> 32);
+        elapsed_us = uint32_t(harp_time_us - uint64_t(seconds) * 1'000'000UL);
+        while (elapsed_us >= 1'000'000UL)
+        {
+            elapsed_us -= 1'000'000UL;
+            ++seconds;
+        }
+    }
+    else // Harp time is out of range. Truncate the seconds like the register.
+    {
+        seconds = uint32_t(harp_time_us / 1'000'000ULL);
+        elapsed_us = uint32_t(harp_time_us % 1'000'000ULL);
+    }
+    return seconds;
+}
+
+void HarpCore::update_sync_regs()
+{
+    SyncRegValues& sync_regs = self->sync_regs;
+    if (self->sync_ == nullptr)
+    {
+        sync_regs.R_SYNC_STATUS = HarpSynchronizer::UNSYNCED;
+        sync_regs.R_SYNC_ERROR_ESTIMATE = UINT32_MAX;
+        sync_regs.R_SYNC_TIME_SINCE_LOCK = UINT32_MAX;
+        return;
+    }
+    HarpSynchronizer::SyncStats stats = HarpSynchronizer::stats();
+    sync_regs.R_SYNC_STATUS = HarpSynchronizer::status();
+    sync_regs.R_SYNC_CORRECTION[0] = stats.last_error_us;
+    sync_regs.R_SYNC_CORRECTION[1] = stats.min_error_us;
+    sync_regs.R_SYNC_CORRECTION[2] = stats.max_error_us;
+    sync_regs.R_SYNC_CORRECTION[3] = stats.mean_error_us;
+    sync_regs.R_SYNC_JITTER = stats.jitter_us;
+    sync_regs.R_SYNC_FREQ = HarpSynchronizer::freq_ppb();
+    sync_regs.R_SYNC_ERROR_ESTIMATE = HarpSynchronizer::estimated_error_us();
+    sync_regs.R_SYNC_PACKETS[0] = stats.packet_count;
+    sync_regs.R_SYNC_PACKETS[1] = stats.missed_count;
+    sync_regs.R_SYNC_PACKETS[2] = stats.malformed_count;
+    uint64_t since_sync_us = HarpSynchronizer::time_since_sync_us();
+    // The ms count saturates after ~49.7 days.
+    sync_regs.R_SYNC_TIME_SINCE_LOCK =
+        (since_sync_us >= uint64_t(UINT32_MAX) * 1000)? UINT32_MAX:
+        ((since_sync_us >> 32) == 0)? uint32_t(since_sync_us) / 1000:
+        uint32_t(since_sync_us / 1000);
+}
+
+void HarpCore::read_sync_reg(uint8_t reg_name)
+{
+    update_sync_regs();
+    read_reg_generic(reg_name);
+}
+
+static_assert(sizeof(DiagRegValues::R_PROFILE)
+              == sizeof(HarpProfiler::PhaseStats),
+              "R_PROFILE must hold one HarpProfiler::PhaseStats.");
+
+void HarpCore::update_profile_reg()
+{
+    DiagRegValues& diag_regs = self->diag_regs;
+    uint8_t ctrl = diag_regs.R_PROFILE_CTRL;
+    HarpProfiler::PhaseStats stats;
+    HarpProfiler::stats((ctrl >> PROFILE_CORE_OFFSET) & 1u,
+                        HarpProfiler::Phase(ctrl & PROFILE_PHASE_MASK), stats);
+    diag_regs.R_PROFILE[0] = stats.count;
+    diag_regs.R_PROFILE[1] = stats.min_ticks;
+    diag_regs.R_PROFILE[2] = stats.max_ticks;
+    diag_regs.R_PROFILE[3] = stats.mean_ticks;
+    for (uint8_t i = 0; i < HARP_PROFILE_HIST_BINS; ++i)
+        diag_regs.R_PROFILE[4 + i] = stats.histogram[i];
+}
+
+void HarpCore::read_profile(uint8_t reg_name)
+{
+    update_profile_reg();
+    read_reg_generic(reg_name);
+}
+
+void HarpCore::write_profile_ctrl(msg_t& msg)
+{
+    const uint8_t& write_byte = *((uint8_t*)msg.payload);
+    if ((write_byte & PROFILE_PHASE_MASK) >= HarpProfiler::PHASE_COUNT)
+    {
+        if (!self->is_muted())
+            send_harp_reply(WRITE_ERROR, msg.header.address);
+        return;
+    }
+    if ((write_byte >> PROFILE_RESET_OFFSET) & 1u)
+        HarpProfiler::reset();
+    // Note: the reset bit always reads as zero.
+    self->diag_regs.R_PROFILE_CTRL = write_byte & ~(1u << PROFILE_RESET_OFFSET);
+    if (self->is_muted())
+        return;
+    send_harp_reply(WRITE, msg.header.address);
+}
+
+void HarpCore::record_reply_latency()
+{
+    uint8_t core_num = get_core_num();
+    if (not self->reply_latency_pending_[core_num])
+        return;
+    self->reply_latency_pending_[core_num] = false;
+    uint32_t latency_us = ::time_us_32() - self->rx_msg_time_us_[core_num];
+    volatile uint32_t& bin_count =
+        self->reply_latency_bins_[core_num][reply_latency_bin(latency_us)];
+    bin_count = bin_count + 1;
+}
+
+void HarpCore::update_reply_latency_reg()
+{
+    for (uint8_t i = 0; i < REPLY_LATENCY_BIN_COUNT; ++i)
+        self->diag_regs.R_REPLY_LATENCY[i] = self->reply_latency_bins_[0][i]
+                                             + self->reply_latency_bins_[1][i];
+}
+
+void HarpCore::read_reply_latency(uint8_t reg_name)
+{
+    update_reply_latency_reg();
+    read_reg_generic(reg_name);
+}
+
+void HarpCore::write_reply_latency(msg_t& msg)
+{
+    // Note: the other core may still add a sample from before the reset.
+    for (uint8_t core_num = 0; core_num < 2; ++core_num)
+        for (uint8_t i = 0; i < REPLY_LATENCY_BIN_COUNT; ++i)
+            self->reply_latency_bins_[core_num][i] = 0;
+    // Leave this request out of the fresh histogram.
+    self->reply_latency_pending_[get_core_num()] = false;
+    update_reply_latency_reg();
+    if (self->is_muted())
+        return;
+    send_harp_reply(WRITE, msg.header.address);
+}
+
+void HarpCore::update_tx_stats_reg()
+{
+    self->diag_regs.R_TX_STATS[0] = self->tx_stall_count_;
+    self->diag_regs.R_TX_STATS[1] = self->tx_drop_count_;
+}
+
+void HarpCore::read_tx_stats(uint8_t reg_name)
+{
+    update_tx_stats_reg();
+    read_reg_generic(reg_name);
+}
+
+void HarpCore::write_tx_stats(msg_t& msg)
+{
+    self->tx_stall_count_ = 0;
+    self->tx_drop_count_ = 0;
+    update_tx_stats_reg();
+    if (self->is_muted())
+        return;
+    send_harp_reply(WRITE, msg.header.address);
+}
+
+void HarpCore::update_tx_drops_reg()
+{
+    uint8_t address = self->diag_regs.R_TX_DROP_SELECT;
+    uint32_t irq_status = spin_lock_blocking(self->tx_drop_lock_);
+    self->diag_regs.R_TX_DROPS[0] = self->tx_drop_counts_[address];
+    self->diag_regs.R_TX_DROPS[1] = self->tx_drop_total_;
+    spin_unlock(self->tx_drop_lock_, irq_status);
+}
+
+void HarpCore::read_tx_drops(uint8_t reg_name)
+{
+    update_tx_drops_reg();
+    read_reg_generic(reg_name);
+}
+
+void HarpCore::write_tx_drops(msg_t& msg)
+{
+    uint32_t irq_status = spin_lock_blocking(self->tx_drop_lock_);
+    for (volatile uint32_t& drop_count: self->tx_drop_counts_)
+        drop_count = 0;
+    self->tx_drop_total_ = 0;
+    spin_unlock(self->tx_drop_lock_, irq_status);
+    update_tx_drops_reg();
+    if (self->is_muted())
+        return;
+    send_harp_reply(WRITE, msg.header.address);
+}
+
+void HarpCore::write_sync_event_period(msg_t& msg)
+{
+    // Restart the period from now.
+    self->sync_event_countdown_s_ = *((uint8_t*)msg.payload);
+    write_reg_generic(msg);
+}
+
+void HarpCore::queue_sync_events(uint64_t system_time_us)
+{
+    update_sync_regs();
+    for (uint8_t address = SYNC_REG_START_ADDRESS;
+         address < SYNC_EVENT_PERIOD; ++address)
+    {
+        const RegSpecs& specs = self->reg_address_to_specs(address);
+        queue_harp_event(address, specs.base_ptr, specs.num_bytes,
+                         specs.payload_type, system_time_us);
+    }
+}
+
+void HarpCore::update_next_heartbeat_from_curr_harp_time_us(
+    uint64_t curr_harp_time_us)
+{
+    // Round *down* to the current whole second, then add the interval.
+    // This may run on either core, so it must not disturb the per-core
+    // second cache.
+    uint32_t elapsed_us;
+    uint32_t seconds = divide_harp_time_us(curr_harp_time_us, elapsed_us);
+    uint32_t irq_status = spin_lock_blocking(self->heartbeat_lock_);
+    self->next_heartbeat_seconds_ = seconds + self->heartbeat_interval_s_;
+    spin_unlock(self->heartbeat_lock_, irq_status);
+    arm_heartbeat_alarm();
+}
+
+void HarpCore::arm_heartbeat_alarm()
+{
+    // Either core may re-arm the alarm while it fires on core0, so disabling
+    // interrupts is not enough.
+    uint32_t irq_status = spin_lock_blocking(self->heartbeat_lock_);
+    if (self->heartbeat_alarm_id_ != 0)
+        cancel_alarm(self->heartbeat_alarm_id_);
+    uint64_t heartbeat_system_us = harp_to_system_us_64(
+        uint64_t(self->next_heartbeat_seconds_) * 1'000'000ULL);
+    // The callback takes the lock too, so it must not run from in here. If
+    // the time already passed, let the alarm pool fire it right away.
+    alarm_id_t id;
+    do
+    {
+        uint64_t soonest_us = ::time_us_64() + HEARTBEAT_ALARM_MIN_DELAY_US;
+        uint64_t alarm_us = (heartbeat_system_us > soonest_us)?
+                                heartbeat_system_us: soonest_us;
+        id = add_alarm_at(from_us_since_boot(alarm_us),
+                          heartbeat_alarm_callback, nullptr, false);
+    } while (id == 0);
+    self->heartbeat_alarm_id_ = (id > 0)? id: 0;
+    // If the alarm pool is full, update_state() tries again.
+    self->heartbeat_rearm_pending_ = (id < 0);
+    spin_unlock(self->heartbeat_lock_, irq_status);
+}
+
+int64_t HarpCore::heartbeat_alarm_callback(alarm_id_t id, void* user_data)
+{
+    (void)user_data;
+    uint64_t harp_time_us = harp_time_us_64();
+    uint32_t irq_status = spin_lock_blocking(self->heartbeat_lock_);
+    // Skip an alarm that fired while the other core re-armed it.
+    if (id != self->heartbeat_alarm_id_)
+    {
+        spin_unlock(self->heartbeat_lock_, irq_status);
+        return 0;
+    }
+    uint32_t heartbeat_seconds = self->next_heartbeat_seconds_;
+    uint64_t heartbeat_harp_us = uint64_t(heartbeat_seconds) * 1'000'000ULL;
+    int64_t until_heartbeat_us = int64_t(heartbeat_harp_us - harp_time_us);
+    int64_t interval_us = int64_t(self->heartbeat_interval_s_) * 1'000'000LL;
+    bool stepped = (until_heartbeat_us > interval_us)
+                   || (until_heartbeat_us < -(interval_us / 2));
+    bool due = (not stepped) && (until_heartbeat_us <= 0);
+    // If the Harp time stepped since the alarm was armed, start over from
+    // the new time. If it slewed, so that the boundary is still ahead, wait
+    // out the rest.
+    if (stepped)
+    {
+        // As in update_next_heartbeat_from_curr_harp_time_us(), without
+        // re-arming the alarm or disturbing the per-core second cache.
+        uint32_t elapsed_us;
+        self->next_heartbeat_seconds_ =
+            divide_harp_time_us(harp_time_us, elapsed_us)
+            + self->heartbeat_interval_s_;
+    }
+    else if (due)
+        self->next_heartbeat_seconds_ = heartbeat_seconds
+                                        + self->heartbeat_interval_s_;
+    uint64_t next_harp_us = uint64_t(self->next_heartbeat_seconds_)
+                            * 1'000'000ULL;
+    spin_unlock(self->heartbeat_lock_, irq_status);
+    if (due)
+    {
+        // Timestamp at the boundary itself, which is at most 1[us] after its
+        // first-order conversion to system time.
+        uint64_t heartbeat_system_us = harp_to_system_us_64(heartbeat_harp_us);
+        while (system_to_harp_us_64(heartbeat_system_us) < heartbeat_harp_us)
+            ++heartbeat_system_us;
+        queue_core_events(heartbeat_seconds, heartbeat_system_us);
+    }
+    // The pool reschedules this alarm (keeping its id), and fires it again
+    // from its own loop if that time already passed.
+    int64_t until_next_us = int64_t(harp_to_system_us_64(next_harp_us)
+                                    - ::time_us_64());
+    return (until_next_us > 0)? until_next_us: 1;
+}
+
+void HarpCore::queue_core_events(uint32_t seconds, uint64_t system_time_us)
+{
+    if ((self->regs_.r_operation_ctrl_bits.OP_MODE != ACTIVE) | is_muted())
+        return; // i.e: events disabled
+    if (self->regs_.r_operation_ctrl_bits.ALIVE_EN)
+        queue_harp_event(TIMESTAMP_SECOND, (const uint8_t*)&seconds,
+                         sizeof(seconds), U32, system_time_us);
+    uint8_t sync_event_period_s = self->sync_regs.R_SYNC_EVENT_PERIOD;
+    if (sync_event_period_s == 0)
+        return;
+    // Heartbeats are one second apart while ACTIVE.
+    if (self->sync_event_countdown_s_ > 1)
+    {
+        self->sync_event_countdown_s_ = self->sync_event_countdown_s_ - 1;
+        return;
+    }
+    self->sync_event_countdown_s_ = sync_event_period_s;
+    queue_sync_events(system_time_us);
 }
 
 void HarpCore::read_timestamp_second(uint8_t reg_name)
@@ -369,13 +1217,8 @@ void HarpCore::write_timestamp_second(msg_t& msg)
     // Replace the current number of elapsed seconds (in harp time) without
     // altering the number of elapsed microseconds.
     uint64_t set_time_microseconds = uint64_t(seconds) * 1'000'000ULL;
-#if defined(PICO_RP2040)
-    uint64_t curr_microseconds;
-    uint64_t curr_seconds = divmod_u64u64_rem(harp_time_us_64(), 1'000'000ULL,
-                                              &curr_microseconds);
-#else
-    uint64_t curr_microseconds = harp_time_us_64() % 1'000'000ULL;
-#endif
+    uint32_t curr_microseconds;
+    harp_time_to_seconds(harp_time_us_64(), curr_microseconds);
     uint64_t new_harp_time_us = set_time_microseconds + curr_microseconds;
     set_harp_time_us_64(new_harp_time_us);
     // Update time-dependent behavior. Take harp time from this function such
@@ -398,12 +1241,10 @@ void HarpCore::write_timestamp_microsecond(msg_t& msg)
     const uint32_t msg_us = ((uint32_t)(*((uint16_t*)msg.payload))) << 5;
     // PICO implementation: replace the current number of elapsed microseconds
     // in harp time with the value received from the message.
-#if defined(PICO_RP2040)
-    uint64_t curr_total_s  = div_u64u64(harp_time_us_64(), 1'000'000ULL);
-#else
-    uint64_t curr_total_s  = harp_time_us_64() / 1'000'000ULL;
-#endif
-    uint64_t new_harp_time_us = curr_total_s + msg_us;
+    uint64_t harp_time_us = harp_time_us_64();
+    uint32_t curr_microseconds;
+    harp_time_to_seconds(harp_time_us, curr_microseconds);
+    uint64_t new_harp_time_us = harp_time_us - curr_microseconds + msg_us;
     set_harp_time_us_64(new_harp_time_us);
     // Update time-dependent behavior. Take harp time from this function such
     // that external synchronizer takes priority.
@@ -440,6 +1281,21 @@ void HarpCore::write_operation_ctrl(msg_t& msg)
         {
             send_harp_reply(READ, address);
         }
+        update_profile_reg();
+        update_reply_latency_reg();
+        update_tx_stats_reg();
+        update_tx_drops_reg();
+        // Count registers rather than addresses, since a bank may end at
+        // the top of the address space.
+        for (uint8_t index = 0; index < DIAG_REG_COUNT; ++index)
+        {
+            send_harp_reply(READ, DIAG_REG_START_ADDRESS + index);
+        }
+        update_sync_regs();
+        for (uint8_t index = 0; index < SYNC_REG_COUNT; ++index)
+        {
+            send_harp_reply(READ, SYNC_REG_START_ADDRESS + index);
+        }
         self->dump_app_registers();
     }
 }
@@ -465,7 +1321,11 @@ void HarpCore::write_reset_dev(msg_t& msg)
     {
         // Reset core state machine and app.
         self->regs_.r_operation_ctrl_bits.OP_MODE = STANDBY;
-        self->reset_app();
+        // In dual-core mode, the app must be reset from its own core.
+        if (self->dual_core_enabled_)
+            self->app_reset_pending_ = true;
+        else
+            self->reset_app();
     }
     else
         send_harp_reply(WRITE, msg.header.address);
@@ -489,8 +1349,47 @@ void HarpCore::write_serial_number(msg_t& msg)
 
 void HarpCore::write_clock_config(msg_t& msg)
 {
-    // TODO.
-    write_reg_generic(msg);
+    const uint8_t& write_byte = *((uint8_t*)msg.payload);
+    // REP_ABLE and GEN_ABLE are read-only.
+    const uint8_t able_bits = self->regs.R_CLOCK_CONFIG
+                              & ((1u << REP_ABLE_OFFSET)
+                                 | (1u << GEN_ABLE_OFFSET));
+    // Only a device with a clock output can repeat or generate the clock.
+    // Generating takes priority if both are requested.
+    HarpClockOutput::Mode mode = HarpClockOutput::OFF;
+    if (self->clock_output_ != nullptr)
+    {
+        if ((write_byte >> CLK_GEN_OFFSET) & 1u)
+            mode = HarpClockOutput::GENERATE;
+        else if ((write_byte >> CLK_REP_OFFSET) & 1u)
+            mode = HarpClockOutput::REPEAT;
+        HarpClockOutput::set_mode(mode);
+    }
+    self->regs.R_CLOCK_CONFIG =
+        (write_byte & ((1u << CLK_UNLOCK_OFFSET) | (1u << CLK_LOCK_OFFSET)))
+        | able_bits
+        | (uint8_t(mode == HarpClockOutput::GENERATE) << CLK_GEN_OFFSET)
+        | (uint8_t(mode == HarpClockOutput::REPEAT) << CLK_REP_OFFSET);
+    if (self->is_muted())
+        return;
+    send_harp_reply(WRITE, msg.header.address);
+}
+
+void HarpCore::set_clock_output(HarpClockOutput* clock_output)
+{
+    self->clock_output_ = clock_output;
+    if (clock_output == nullptr)
+    {
+        self->regs.R_CLOCK_CONFIG &= ~((1u << REP_ABLE_OFFSET)
+                                       | (1u << GEN_ABLE_OFFSET)
+                                       | (1u << CLK_REP_OFFSET)
+                                       | (1u << CLK_GEN_OFFSET));
+        return;
+    }
+    HarpClockOutput::set_time_source({harp_time_us_64, harp_to_system_us_64,
+                                      is_synced});
+    self->regs.R_CLOCK_CONFIG |= (1u << REP_ABLE_OFFSET)
+                                 | (1u << GEN_ABLE_OFFSET);
 }
 
 void HarpCore::write_timestamp_offset(msg_t& msg)
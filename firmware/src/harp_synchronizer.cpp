@@ -2,13 +2,22 @@
 
 
 HarpSynchronizer::HarpSynchronizer(uart_inst_t* uart_id, uint8_t uart_rx_pin)
-:uart_id_{uart_id}, packet_index_{0}, sync_data_{0, 0, 0, 0},
- state_{RECEIVE_HEADER_0}, new_timestamp_{false}, offset_us_64_{0},
- has_synced_{false}
+:uart_id_{uart_id}, uart_rx_pin_{uart_rx_pin}, rx_mode_{PER_BYTE},
+ rx_edge_handler_added_{false}, rx_edge_time_us_{0},
+ rx_edge_captured_{false},
+ models_{{0, 0, 0, 0, 0, 0, 0}, {0, 0, 0, 0, 0, 0, 0}}, model_index_{0},
+ clock_mode_{STEP}, freq_{0}, freq_acquired_{false}, freq_noise_{0},
+ last_error_us_{0}, phase_error_bound_us_{0}, last_sync_harp_us_{0},
+ has_synced_{false}, error_history_us_{0}, error_history_index_{0},
+ error_history_count_{0}, packet_count_{0}, missed_count_{0},
+ malformed_count_{0}
 {
     // Create a pointer to the first (and one-and-only) instance created.
     if (self == nullptr)
         self = this;
+    // The PIO backend sets up its own input.
+    if (uart_id_ == nullptr)
+        return;
     // Setup uart.
     uart_init(uart_id_, HARP_SYNC_BAUDRATE);
     // Disable hardware flow control.
@@ -40,61 +49,323 @@ HarpSynchronizer& HarpSynchronizer::init(uart_inst_t* uart_id,
 
 void HarpSynchronizer::uart_rx_callback()
 {
-    // Hush interrupts, since we make assumptions about how long this fn takes.
-    //uint32_t interrupt_status = save_and_disable_interrupts();
-    SyncState next_state_{self->state_}; // Init next state at curr state value.
-    uint8_t new_byte;
-    // This State machine "ticks" every time we receive at least one new byte.
-    // Handle next-state/output logic.
-    while (uart_is_readable(self->uart_id_) and not self->new_timestamp_)
+    // Decode every byte that has arrived.
+    while (uart_is_readable(self->uart_id_))
     {
-        new_byte = uart_getc(self->uart_id_);
+        uint8_t new_byte = uart_getc(self->uart_id_);
         #ifdef DEBUG
-        //printf("state: %d | byte: 0x%x\r\n", self->state_, new_byte);
+        //printf("state: %d | byte: 0x%x\r\n", self->decoder_.state(), new_byte);
         #endif
-        switch (self->state_)
+        HarpSyncDecoder::Result result = self->decoder_.push(new_byte,
+                                                             ::time_us_32());
+        if (result == HarpSyncDecoder::MALFORMED)
+            self->malformed_count_ = self->malformed_count_ + 1;
+        if (result != HarpSyncDecoder::PACKET)
+            continue;
+        uint32_t sec = self->decoder_.seconds();
+        if (self->rx_mode_ == PER_PACKET)
+        {
+            self->apply_packet(self->packet_end_time_us(::time_us_64()),
+                HarpSyncDecoder::harp_time_us(sec, HARP_SYNC_PACKET_END_US));
+        }
+        else
         {
-            case RECEIVE_HEADER_0:
-                if (new_byte == 0xAA)
-                    next_state_ = RECEIVE_HEADER_1;
-                break;
-            case RECEIVE_HEADER_1:
-                if (new_byte == 0xAF)
-                    next_state_ = RECEIVE_TIMESTAMP;
-                else
-                    next_state_ = RECEIVE_HEADER_0;
-                break;
-            case RECEIVE_TIMESTAMP:
-                self->sync_data_[self->packet_index_++] = new_byte;
-                if (self->packet_index_ == 4)
-                {
-                    next_state_ = RECEIVE_HEADER_0;
-                    self->packet_index_ = 0;
-                    self->new_timestamp_ = true;
-                }
-                else
-                    next_state_ = RECEIVE_TIMESTAMP;
-                break;
+            self->apply_packet(::time_us_64(),
+                HarpSyncDecoder::harp_time_us(sec, HARP_SYNC_OFFSET_US));
         }
-        self->state_ = next_state_;
+        #ifdef DEBUG
+        //printf("harp time: %lu [s] | error: %ld [us]\r\n", sec, self->last_error_us_);
+        #endif
     }
-    if (not self->new_timestamp_)
+    // Listen for the next packet's start edge if we are between packets.
+    if (self->rx_mode_ == PER_PACKET
+        && self->decoder_.state() == HarpSyncDecoder::RECEIVE_HEADER_0)
+        self->arm_rx_edge();
+}
+
+void HarpSynchronizer::apply_packet(uint64_t packet_system_us,
+                                    uint64_t packet_harp_us)
+{
+    // Carry the Harp time from the packet up to now, so that corrections
+    // start from now rather than retroactively.
+    uint64_t system_us = ::time_us_64();
+    int64_t elapsed_us = int64_t(system_us - packet_system_us);
+    discipline(system_us, packet_harp_us + elapsed_us
+                          + ((elapsed_us * freq_) >> 32));
+    has_synced_ = true;
+}
+
+void HarpSynchronizer::set_rx_mode(RxMode mode)
+{
+    if (self->uart_id_ == nullptr) // i.e: PIO backend.
+        return;
+    int uart_irq = (self->uart_id_ == uart0) ? UART0_IRQ : UART1_IRQ;
+    irq_set_enabled(uart_irq, false);
+    self->rx_mode_ = mode;
+    self->decoder_.reset();
+    uart_set_fifo_enabled(self->uart_id_, mode == PER_PACKET);
+    if (mode == PER_PACKET)
     {
-        //restore_interrupts(interrupt_status);
+#if defined(PICO_RP2040)
+        // Raise the RX FIFO level interrupt above the packet size (to 1/4
+        // full, i.e: 8 bytes) so that packets only raise the RX timeout
+        // interrupt. The level interrupt still drains a stream of noise.
+        hw_write_masked(&uart_get_hw(self->uart_id_)->ifls,
+                        1u << UART_UARTIFLS_RXIFLSEL_LSB,
+                        UART_UARTIFLS_RXIFLSEL_BITS);
+#endif
+        if (!self->rx_edge_handler_added_)
+        {
+            gpio_add_raw_irq_handler(self->uart_rx_pin_, rx_edge_callback);
+            self->rx_edge_handler_added_ = true;
+        }
+        irq_set_enabled(IO_IRQ_BANK0, true);
+        self->arm_rx_edge();
+    }
+    else
+        gpio_set_irq_enabled(self->uart_rx_pin_, GPIO_IRQ_EDGE_FALL, false);
+    irq_set_enabled(uart_irq, true);
+}
+
+void HarpSynchronizer::rx_edge_callback()
+{
+    if ((gpio_get_irq_event_mask(self->uart_rx_pin_) & GPIO_IRQ_EDGE_FALL) == 0)
         return;
+    uint64_t edge_time_us = ::time_us_64();
+    gpio_acknowledge_irq(self->uart_rx_pin_, GPIO_IRQ_EDGE_FALL);
+    // Only the packet's first start bit matters. The uart ISR re-arms this.
+    gpio_set_irq_enabled(self->uart_rx_pin_, GPIO_IRQ_EDGE_FALL, false);
+    self->rx_edge_time_us_ = edge_time_us;
+    self->rx_edge_captured_ = true;
+}
+
+void HarpSynchronizer::arm_rx_edge()
+{
+    rx_edge_captured_ = false;
+    // Discard edges latched while disarmed (i.e: from data bits).
+    gpio_acknowledge_irq(uart_rx_pin_, GPIO_IRQ_EDGE_FALL);
+    gpio_set_irq_enabled(uart_rx_pin_, GPIO_IRQ_EDGE_FALL, true);
+}
+
+uint64_t HarpSynchronizer::packet_end_time_us(uint64_t rx_timeout_us)
+{
+    uint64_t end_us = rx_timeout_us - HARP_SYNC_RX_TIMEOUT_US;
+    if (!rx_edge_captured_)
+        return end_us;
+    // Trust the start edge only if it plausibly began this packet.
+    // Otherwise, fall back on the RX timeout (and its interrupt latency).
+    uint64_t edge_end_us = rx_edge_time_us_ + HARP_SYNC_PACKET_US;
+    if (end_us - edge_end_us <= HARP_SYNC_MAX_RX_LATENCY_US)
+        return edge_end_us;
+    return end_us;
+}
+
+void HarpSynchronizer::set_harp_time_us_64(uint64_t harp_time_us)
+{
+    // Keep the learned frequency, but restart the phase from here.
+    uint32_t interrupt_status = save_and_disable_interrupts();
+    self->publish_clock_model(
+        self->step_model(::time_us_64(), harp_time_us,
+                         self->clock_model().sync_system_us));
+    restore_interrupts(interrupt_status);
+}
+
+uint32_t HarpSynchronizer::estimated_error_us()
+{
+    if (!self->has_synced_)
+        return UINT32_MAX;
+    return self->estimated_error_us(::time_us_64()
+                                    - self->clock_model().sync_system_us);
+}
+
+HarpSynchronizer::SyncStats HarpSynchronizer::stats()
+{
+    SyncStats stats{self->last_error_us_, 0, 0, 0, 0, self->packet_count_,
+                    self->missed_count_, self->malformed_count_};
+    uint8_t count = self->error_history_count_;
+    if (count == 0)
+        return stats;
+    // Walk the history from the oldest entry.
+    const uint8_t mask = HARP_SYNC_STATS_WINDOW - 1;
+    uint8_t start = (self->error_history_index_ - count) & mask;
+    int32_t prev_error_us = self->error_history_us_[start];
+    stats.min_error_us = prev_error_us;
+    stats.max_error_us = prev_error_us;
+    int64_t sum_us = 0;
+    uint64_t jitter_sum_us = 0;
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        int32_t error_us = self->error_history_us_[(start + i) & mask];
+        if (error_us < stats.min_error_us)
+            stats.min_error_us = error_us;
+        if (error_us > stats.max_error_us)
+            stats.max_error_us = error_us;
+        sum_us += error_us;
+        int64_t change_us = int64_t(error_us) - prev_error_us;
+        jitter_sum_us += uint64_t((change_us < 0)? -change_us: change_us);
+        prev_error_us = error_us;
     }
-    // Apply new timestamp data.
-    // Interpret 4-byte sequence as a little-endian uint32_t.
-    // Add 1[s] per protocol spec since 4-byte sequence encodes previous second.
-    uint32_t sec = *((uint32_t*)(self->sync_data_)) + 1;
-    uint64_t curr_harp_us = uint64_t(sec) * 1'000'000 - HARP_SYNC_OFFSET_US;
-    self->offset_us_64_ = ::time_us_64() - curr_harp_us;
-    self->has_synced_ = true;
-    self->new_timestamp_ = false;
-    #ifdef DEBUG
-    //printf("harp time: %llu [us] | offset: %lld\r\n", curr_harp_us, self->offset_us_64_);
-    #endif
-    // Cleanup.
-    //restore_interrupts(interrupt_status);
+    stats.mean_error_us = int32_t(sum_us / count);
+    if (count > 1)
+        stats.jitter_us = uint32_t(jitter_sum_us / (count - 1));
+    return stats;
 }
 
+uint32_t HarpSynchronizer::estimated_error_us(uint64_t since_sync_us)
+{
+    uint64_t error_us = phase_error_bound_us_;
+    if (since_sync_us > HARP_SYNC_HOLDOVER_TIMEOUT_US)
+    {
+        const int32_t min_drift = ppm_to_rate(HARP_SYNC_HOLDOVER_DRIFT_PPM);
+        uint64_t drift = uint32_t((freq_noise_ > min_drift)? freq_noise_:
+                                                             min_drift);
+        error_us += (since_sync_us >> 32) * drift
+                    + ((uint64_t(uint32_t(since_sync_us)) * drift) >> 32);
+    }
+    return (error_us > UINT32_MAX)? UINT32_MAX: uint32_t(error_us);
+}
+
+HarpSynchronizer::clock_model_t HarpSynchronizer::step_model(
+    uint64_t system_us, uint64_t harp_us, uint64_t sync_system_us)
+{
+    // STEP mode runs at the system rate between packets (as if the offset
+    // were constant) and only falls back to the learned rate in holdover.
+    int32_t slew = (clock_mode_ == STEP)? -freq_: 0;
+    return {system_us, harp_us, 0, freq_, slew, HARP_SYNC_PERIOD_US,
+            sync_system_us};
+}
+
+HarpSynchronizer::clock_model_t HarpSynchronizer::reanchor(
+    const clock_model_t& model, uint64_t system_us)
+{
+    uint64_t elapsed_us = system_us - model.system_us;
+    // Carry the fractional microseconds so the new model starts exactly where
+    // the old one leaves off.
+    uint32_t frac;
+    int64_t gained = gained_us(model, elapsed_us, frac);
+    uint32_t slew_us = (elapsed_us < model.slew_us)?
+                          model.slew_us - uint32_t(elapsed_us): 0;
+    return {system_us, model.harp_us + elapsed_us + gained, frac, model.freq,
+            model.slew, slew_us, model.sync_system_us};
+}
+
+void HarpSynchronizer::update_freq(int64_t correction)
+{
+    // Track the size of corrections after acquisition, since they reflect
+    // how much the frequency wanders.
+    if (freq_acquired_)
+    {
+        int64_t abs_correction = (correction < 0)? -correction: correction;
+        freq_noise_ += int32_t((abs_correction - freq_noise_)
+                               >> HARP_SYNC_KI_SHIFT);
+    }
+    const int64_t max_freq = ppm_to_rate(HARP_SYNC_MAX_FREQ_PPM);
+    int64_t freq = freq_ + correction;
+    freq_ = int32_t((freq > max_freq)? max_freq:
+                    (freq < -max_freq)? -max_freq: freq);
+    freq_acquired_ = true;
+}
+
+void HarpSynchronizer::update_stats(int32_t error_us, uint64_t interval_us)
+{
+    packet_count_ = packet_count_ + 1;
+    // The first packet's error is the whole Harp time.
+    if (!has_synced_)
+        return;
+    // Count the periods that elapsed without a packet, rounding off jitter.
+    if (interval_us > (HARP_SYNC_PERIOD_US * 3) / 2)
+    {
+        uint64_t missed = (interval_us + HARP_SYNC_PERIOD_US / 2)
+                          / HARP_SYNC_PERIOD_US - 1;
+        missed_count_ = missed_count_ + uint32_t(missed);
+    }
+    uint8_t index = error_history_index_;
+    error_history_us_[index] = error_us;
+    error_history_index_ = (index + 1) & (HARP_SYNC_STATS_WINDOW - 1);
+    if (error_history_count_ < HARP_SYNC_STATS_WINDOW)
+        error_history_count_ = error_history_count_ + 1;
+}
+
+void HarpSynchronizer::discipline(uint64_t system_us, uint64_t harp_us)
+{
+    const int64_t max_rate = ppm_to_rate(HARP_SYNC_MAX_SLEW_PPM);
+    const clock_model_t& curr = clock_model();
+    uint64_t interval_us = system_us - curr.sync_system_us;
+    // Continue the current model up to now and compare.
+    clock_model_t next = reanchor(curr, system_us);
+    next.sync_system_us = system_us;
+    int64_t error_us = int64_t(harp_us - next.harp_us);
+    int64_t abs_error_us = (error_us < 0)? -error_us: error_us;
+    // Returning from holdover, errors within the estimate are slewed out too.
+    int64_t max_slew_error_us = HARP_SYNC_STEP_THRESHOLD_US;
+    if (interval_us > HARP_SYNC_HOLDOVER_TIMEOUT_US)
+    {
+        int64_t holdover_error_us = 2 * int64_t(
+            estimated_error_us(interval_us));
+        if (holdover_error_us > max_slew_error_us)
+            max_slew_error_us = holdover_error_us;
+        if (max_slew_error_us > HARP_SYNC_MAX_RELOCK_SLEW_US)
+            max_slew_error_us = HARP_SYNC_MAX_RELOCK_SLEW_US;
+    }
+    // Phase error to account for in the error estimate. In STEP mode, it
+    // builds up between packets. Jumps in the Harp time do not count.
+    uint32_t phase_error_us = 0;
+    if (clock_mode_ == STEP)
+    {
+        // The difference in elapsed time on each clock since the last packet
+        // measures the frequency error directly.
+        int64_t drift_us = int64_t(harp_us - last_sync_harp_us_)
+                           - int64_t(interval_us);
+        if (has_synced_ && interval_us != 0 && (interval_us >> 32) == 0
+            && drift_us < HARP_SYNC_MAX_RELOCK_SLEW_US
+            && drift_us > -HARP_SYNC_MAX_RELOCK_SLEW_US)
+        {
+            int64_t freq = (drift_us * (1LL << 32)) / int64_t(interval_us);
+            update_freq(freq_acquired_? ((freq - freq_) >> HARP_SYNC_KI_SHIFT)
+                                      : (freq - freq_));
+            phase_error_us = uint32_t(abs_error_us);
+        }
+        else // The Harp time jumped. Measure the frequency from scratch.
+            freq_acquired_ = false;
+        next = step_model(system_us, harp_us, system_us);
+    }
+    else if (!has_synced_ || interval_us == 0
+             || abs_error_us > max_slew_error_us)
+    {
+        next = step_model(system_us, harp_us, system_us);
+        freq_acquired_ = false;
+    }
+    else
+    {
+        // Phase error accumulated per [us] since the last packet, in rate
+        // units. The division only happens once per packet.
+        int64_t error_rate = (error_us * (1LL << 32)) / int64_t(interval_us);
+        // Slew out a fraction of the phase error over the next period.
+        int64_t slew = ((error_us * (1LL << 32)) / HARP_SYNC_PERIOD_US)
+                       >> HARP_SYNC_KP_SHIFT;
+        bool saturated = (freq_ + slew > max_rate)
+                         || (freq_ + slew < -max_rate);
+        // The first interval after a step measures the frequency error
+        // directly. Afterwards, only a fraction of it is attributed to
+        // frequency error. Skip this while the slew is saturated (i.e: after
+        // holdover) so that the frequency does not wind up.
+        if (!saturated || !freq_acquired_)
+            update_freq(freq_acquired_? (error_rate >> HARP_SYNC_KI_SHIFT)
+                                      : error_rate);
+        slew = (freq_ + slew > max_rate)? max_rate - freq_:
+               (freq_ + slew < -max_rate)? -max_rate - freq_: slew;
+        next.freq = freq_;
+        next.slew = int32_t(slew);
+        next.slew_us = HARP_SYNC_PERIOD_US;
+        phase_error_us = uint32_t(abs_error_us);
+    }
+    last_error_us_ = int32_t((error_us > INT32_MAX)? INT32_MAX:
+                             (error_us < -INT32_MAX)? -INT32_MAX: error_us);
+    update_stats(last_error_us_, interval_us);
+    // Hold the peak phase error, decaying slowly.
+    phase_error_bound_us_ -= phase_error_bound_us_ >> HARP_SYNC_KI_SHIFT;
+    if (phase_error_us > phase_error_bound_us_)
+        phase_error_bound_us_ = phase_error_us;
+    last_sync_harp_us_ = harp_us;
+    publish_clock_model(next);
+}
@@ -0,0 +1,69 @@
+#include <harp_synchronizer.h>
+#include <hardware/dma.h>
+#include <harp_sync_rx.pio.h>
+
+// PIO backend of the HarpSynchronizer. RP2040 only.
+
+HarpSynchronizer& HarpSynchronizer::init(PIO pio, uint8_t rx_pin)
+{
+    static HarpSynchronizer synchronizer(nullptr, rx_pin);
+    if (synchronizer.pio_ == nullptr)
+        synchronizer.setup_pio(pio);
+    return synchronizer;
+}
+
+void HarpSynchronizer::setup_pio(PIO pio)
+{
+    pio_ = pio;
+    pio_sm_ = pio_claim_unused_sm(pio_, true);
+    uint offset = pio_add_program(pio_, &harp_sync_rx_program);
+    harp_sync_rx_program_init(pio_, pio_sm_, offset, uart_rx_pin_,
+                              HARP_SYNC_BAUDRATE);
+    // Keep the state machine's TX FIFO full of timer reads. At one read per
+    // FIFO slot, the transfer count lasts for years. pio_rx_callback()
+    // restarts it if it runs out.
+    pio_dma_chan_ = dma_claim_unused_channel(true);
+    dma_channel_config config = dma_channel_get_default_config(pio_dma_chan_);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, pio_get_dreq(pio_, pio_sm_, true));
+    dma_channel_configure(pio_dma_chan_, &config, &pio_->txf[pio_sm_],
+                          &timer_hw->timerawl, UINT32_MAX, true);
+    // Interrupt when a byte and its timestamp arrive.
+    uint pio_irq = (pio_ == pio0)? PIO0_IRQ_0: PIO1_IRQ_0;
+    pio_set_irq0_source_enabled(pio_,
+        pio_interrupt_source(pis_sm0_rx_fifo_not_empty + pio_sm_), true);
+    irq_add_shared_handler(pio_irq, pio_rx_callback,
+                           PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(pio_irq, true);
+    pio_sm_set_enabled(pio_, pio_sm_, true);
+}
+
+void HarpSynchronizer::pio_rx_callback()
+{
+    PIO pio = self->pio_;
+    uint sm = self->pio_sm_;
+    // Each byte arrives as two words: the byte, then its start bit's time,
+    // pushed 3 PIO cycles (~2[us]) later. Wait for the time here, since the
+    // FIFO interrupt is level-triggered and would re-enter until it lands.
+    while (!pio_sm_is_rx_fifo_empty(pio, sm))
+    {
+        uint8_t new_byte = uint8_t(pio_sm_get(pio, sm) >> 24);
+        uint32_t start_time_us = pio_sm_get_blocking(pio, sm);
+        HarpSyncDecoder::Result result = self->decoder_.push(new_byte,
+                                                             start_time_us);
+        if (result == HarpSyncDecoder::MALFORMED)
+            self->malformed_count_ = self->malformed_count_ + 1;
+        if (result != HarpSyncDecoder::PACKET)
+            continue;
+        uint64_t packet_system_us = HarpSyncDecoder::widen_time_us(
+            self->decoder_.final_byte_time_us(), ::time_us_64());
+        self->apply_packet(packet_system_us,
+                           HarpSyncDecoder::harp_time_us(
+                                self->decoder_.seconds(),
+                                HARP_SYNC_FINAL_BYTE_US));
+    }
+    if (!dma_channel_is_busy(self->pio_dma_chan_))
+        dma_channel_set_trans_count(self->pio_dma_chan_, UINT32_MAX, true);
+}
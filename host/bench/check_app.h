@@ -0,0 +1,39 @@
+#ifndef CHECK_APP_H
+#define CHECK_APP_H
+#include <stdint.h>
+#include <stddef.h>
+#include <harp_c_app.h>
+
+// The HarpCApp that the host checks run. Only the name and the app
+// registers differ from one check to another.
+
+inline void no_app_update(){}
+inline void no_app_reset(){}
+
+/**
+ * \brief create the app with the registers in \p app_regs, described by
+ *  \p reg_layouts and handled by \p reg_fns.
+ */
+template <typename RegStruct, size_t N>
+HarpCApp& init_check_app(const char* name, RegStruct& app_regs,
+                         const RegLayout (&reg_layouts)[N],
+                         RegFnPair (&reg_fns)[N],
+                         void (*update_fn)(void) = no_app_update)
+{
+    return HarpCApp::init(1234, 1, 0, 2, 2, 0, 3, 0, 0xCAFE, name,
+                          (const uint8_t*)"host", &app_regs, reg_layouts,
+                          reg_fns, N, update_fn, no_app_reset);
+}
+
+/**
+ * \brief create the app without app registers.
+ */
+inline HarpCApp& init_check_app(const char* name)
+{
+    return HarpCApp::init(1234, 1, 0, 2, 2, 0, 3, 0, 0xCAFE, name,
+                          (const uint8_t*)"host", nullptr,
+                          (const RegLayout*)nullptr, nullptr, 0,
+                          no_app_update, no_app_reset);
+}
+
+#endif // CHECK_APP_H
@@ -0,0 +1,281 @@
+#include <check_app.h>
+#include <harp_clock_output.h>
+#include <harp_synchronizer.h>
+#include <harp_sync_decoder.h>
+#include <harp_sync_encoder.h>
+#include <host_gpio.h>
+#include <host_time.h>
+#include <host_uart.h>
+#include <harp_frames.h>
+#include <harp_checks.h>
+#include <cstdio>
+#include <cstdlib>
+
+// Checks the clock output against the synchronizer's own decoder: encoded
+// packets round-trip, the R_CLOCK_CONFIG register selects the mode, and a
+// downstream synchronizer fed the output over a (host) wire tracks the
+// upstream Harp time within a few [us], including across steps to the
+// upstream Harp time. Every packet sent is decoded and its timing checked.
+// Exits with a nonzero status if any check fails.
+
+HarpCApp& app = init_check_app("Host Clock Output");
+
+const uint8_t tx_pin = 0;
+const uint8_t rx_pin = 5;
+const uint64_t system_start_us = 1'000'000'000ULL;
+const uint64_t step_us = 1000;
+
+// Upstream Harp time, which runs fast relative to the system clock.
+uint64_t upstream_harp_start_us = 3'900'000'000'000'000ULL;
+const int64_t upstream_drift_ppm = 70;
+bool upstream_synced = true;
+
+uint64_t upstream_harp_us_at(uint64_t system_us)
+{
+    int64_t elapsed_us = int64_t(system_us - system_start_us);
+    return upstream_harp_start_us + elapsed_us
+           + elapsed_us * upstream_drift_ppm / 1'000'000;
+}
+
+uint64_t upstream_time_us_64()
+{return upstream_harp_us_at(time_us_64());}
+
+uint64_t upstream_to_system_us_64(uint64_t harp_time_us)
+{
+    int64_t elapsed_us = int64_t(harp_time_us - upstream_harp_start_us);
+    return system_start_us
+           + elapsed_us * 1'000'000 / (1'000'000 + upstream_drift_ppm);
+}
+
+bool upstream_is_synced()
+{return upstream_synced;}
+
+void check_encoder()
+{
+    const uint32_t seconds[] {1, 2, 255, 256, 65'536, 3'900'000'000U,
+                              UINT32_MAX};
+    for (uint32_t sec: seconds)
+    {
+        uint8_t packet[HARP_SYNC_PACKET_SIZE];
+        HarpSyncEncoder::encode(sec, packet);
+        HarpSyncDecoder decoder;
+        uint32_t packet_count = 0;
+        for (size_t i = 0; i < sizeof(packet); ++i)
+        {
+            HarpSyncDecoder::Result result = decoder.push(packet[i], i);
+            packet_count += (result == HarpSyncDecoder::PACKET);
+            expect(result != HarpSyncDecoder::MALFORMED,
+                   "encoded packets are well-formed");
+        }
+        expect(packet_count == 1 && decoder.seconds() == sec,
+               "encoded packets decode to the same second");
+        uint64_t start_us = HarpSyncEncoder::packet_start_harp_us(
+            sec, HARP_CLOCK_OUTPUT_START_OFFSET_US);
+        expect(start_us + HARP_SYNC_PACKET_US + HARP_SYNC_PACKET_END_US
+               == uint64_t(sec) * 1'000'000, "packets start on time");
+        expect(HarpSyncEncoder::next_seconds(
+                   start_us, HARP_CLOCK_OUTPUT_START_OFFSET_US) == sec
+               && HarpSyncEncoder::next_seconds(
+                   start_us - 999'999, HARP_CLOCK_OUTPUT_START_OFFSET_US)
+                   == sec
+               && HarpSyncEncoder::next_seconds(
+                   start_us + 1, HARP_CLOCK_OUTPUT_START_OFFSET_US)
+                   == sec + 1,
+               "the next packet is the first to start at or after a time");
+    }
+}
+
+/**
+ * \brief send a request and call run() until its reply arrives.
+ * \returns the reply's payload, or an empty vector if none arrived.
+ */
+std::vector<uint8_t> round_trip(const std::vector<uint8_t>& request,
+                                msg_type_t reply_type)
+{
+    std::vector<uint8_t> reply;
+    host_cdc_write(request.data(), request.size());
+    for (size_t tries = 0; tries < 64; ++tries)
+    {
+        app.run();
+        if (!read_reply(reply))
+            continue;
+        if (!checksum_ok(reply) || reply[0] != reply_type
+            || reply[2] != request[2])
+            break;
+        // Payload follows the header and the 6-byte timestamp.
+        return std::vector<uint8_t>(reply.begin() + 11, reply.end() - 1);
+    }
+    return {};
+}
+
+uint8_t write_clock_config(uint8_t value)
+{
+    std::vector<uint8_t> payload = round_trip(
+        make_request(WRITE, CLOCK_CONFIG, U8, &value, 1), WRITE);
+    expect(payload.size() == 1, "write reply carries the register");
+    return payload.empty()? 0: payload[0];
+}
+
+// Packets the clock output sent, decoded.
+HarpSyncDecoder tx_decoder;
+uint32_t tx_packet_count = 0;
+uint32_t last_tx_seconds = 0;
+uint64_t last_upstream_start_us = 0; // to tell steps back from repeats.
+// Largest downstream error since the last reset, and the time to start
+// tracking it.
+int64_t max_downstream_error_us = 0;
+uint64_t settle_time_us = UINT64_MAX;
+
+/**
+ * \brief advance the system time by \p duration_us, delivering each sync
+ *  packet that the clock output sends to the downstream synchronizer as it
+ *  would arrive over a wire, and tracking the downstream error.
+ */
+void run_for(uint64_t duration_us)
+{
+    uint64_t end_us = time_us_64() + duration_us;
+    while (time_us_64() < end_us)
+    {
+        host_time_advance_us(step_us);
+        uint8_t bytes[HARP_SYNC_PACKET_SIZE];
+        uint64_t start_times_us[HARP_SYNC_PACKET_SIZE];
+        size_t byte_count;
+        while ((byte_count = host_uart_take_tx(uart0, bytes, start_times_us,
+                                               sizeof(bytes))) > 0)
+        {
+            uint64_t now_us = time_us_64();
+            for (size_t i = 0; i < byte_count; ++i)
+            {
+                if (tx_decoder.push(bytes[i], uint32_t(start_times_us[i]))
+                    != HarpSyncDecoder::PACKET)
+                    continue;
+                // The packet's final byte starts a fixed offset before the
+                // second that it marks in the upstream Harp time.
+                int64_t error_us = int64_t(
+                    upstream_harp_us_at(start_times_us[i])
+                    - HarpSyncDecoder::harp_time_us(tx_decoder.seconds(),
+                                                    HARP_SYNC_FINAL_BYTE_US));
+                expect(error_us >= -1 && error_us <= 1,
+                       "packets are sent on time");
+                expect(tx_decoder.seconds() > last_tx_seconds
+                       || upstream_harp_start_us < last_upstream_start_us,
+                       "packets mark increasing seconds");
+                last_tx_seconds = tx_decoder.seconds();
+                last_upstream_start_us = upstream_harp_start_us;
+                ++tx_packet_count;
+            }
+            // Over the wire: the first start bit raises a falling edge, and
+            // the RX timeout interrupt follows the packet.
+            host_time_set_us(start_times_us[0]);
+            host_gpio_edge(rx_pin, GPIO_IRQ_EDGE_FALL);
+            host_time_set_us(start_times_us[0] + HARP_SYNC_PACKET_US
+                             + HARP_SYNC_RX_TIMEOUT_US);
+            host_uart_inject(uart1, bytes, byte_count);
+            if (time_us_64() < now_us)
+                host_time_set_us(now_us);
+        }
+        if (time_us_64() < settle_time_us)
+            continue;
+        int64_t error_us = int64_t(HarpSynchronizer::time_us_64()
+                                   - upstream_time_us_64());
+        error_us = (error_us < 0)? -error_us: error_us;
+        if (error_us > max_downstream_error_us)
+            max_downstream_error_us = error_us;
+    }
+}
+
+int main()
+{
+    check_encoder();
+
+    host_time_set_manual(true);
+    host_time_set_us(system_start_us);
+    for (size_t i = 0; i < 8; ++i)
+        app.run();
+    std::vector<uint8_t> drain;
+    while (read_reply(drain)){}
+
+    // Without a clock output, the clock can be neither repeated nor
+    // generated.
+    uint8_t config = write_clock_config((1u << CLK_GEN_OFFSET)
+                                        | (1u << CLK_LOCK_OFFSET));
+    expect(config == (1u << CLK_LOCK_OFFSET),
+           "no clock output without a clock output attached");
+
+    HarpClockOutput& clock_output = HarpClockOutput::init(uart0, tx_pin);
+    HarpCore::set_clock_output(&clock_output);
+    config = write_clock_config(0);
+    expect(config == ((1u << REP_ABLE_OFFSET) | (1u << GEN_ABLE_OFFSET)),
+           "REP_ABLE and GEN_ABLE set with a clock output attached");
+    config = write_clock_config((1u << CLK_REP_OFFSET)
+                                | (1u << CLK_GEN_OFFSET));
+    expect(config == ((1u << CLK_GEN_OFFSET) | (1u << REP_ABLE_OFFSET)
+                      | (1u << GEN_ABLE_OFFSET))
+           && HarpClockOutput::mode() == HarpClockOutput::GENERATE,
+           "CLK_GEN takes priority over CLK_REP");
+    config = write_clock_config(1u << CLK_REP_OFFSET);
+    expect((config & ((1u << CLK_REP_OFFSET) | (1u << CLK_GEN_OFFSET)))
+           == (1u << CLK_REP_OFFSET)
+           && HarpClockOutput::mode() == HarpClockOutput::REPEAT,
+           "CLK_REP repeats the clock");
+    // HarpCore has no synchronizer, so there is nothing to repeat.
+    run_for(3'000'000);
+    expect(tx_packet_count == 0, "nothing repeated while unsynchronized");
+
+    // Daisy-chain to a downstream synchronizer from the upstream Harp time.
+    HarpSynchronizer::init(uart1, rx_pin);
+    HarpSynchronizer::set_clock_mode(HarpSynchronizer::SLEW);
+    HarpSynchronizer::set_rx_mode(HarpSynchronizer::PER_PACKET);
+    HarpClockOutput::set_time_source({upstream_time_us_64,
+                                      upstream_to_system_us_64,
+                                      upstream_is_synced});
+    HarpClockOutput::set_mode(HarpClockOutput::GENERATE);
+    settle_time_us = time_us_64() + 30'000'000;
+    run_for(120'000'000);
+    printf("case=generate packets=%u skipped=%u max_error_us=%lld\n",
+           tx_packet_count, HarpClockOutput::skipped_count(),
+           (long long)max_downstream_error_us);
+    expect(tx_packet_count >= 119 && tx_packet_count <= 120
+           && HarpClockOutput::sent_count() == tx_packet_count,
+           "one packet per second");
+    expect(HarpClockOutput::skipped_count() == 0, "no packets skipped");
+    expect(HarpSynchronizer::status() == HarpSynchronizer::LOCKED,
+           "downstream locks");
+    expect(max_downstream_error_us <= 3, "downstream tracks upstream");
+
+    // Steps to the upstream Harp time, forward and back.
+    uint32_t count_before = tx_packet_count;
+    run_for(400'000);
+    upstream_harp_start_us += 300'000;
+    run_for(10'000'000);
+    upstream_harp_start_us -= 5'000'000;
+    max_downstream_error_us = 0;
+    settle_time_us = time_us_64() + 30'000'000;
+    run_for(60'000'000);
+    printf("case=steps packets=%u skipped=%u max_error_us=%lld\n",
+           tx_packet_count - count_before, HarpClockOutput::skipped_count(),
+           (long long)max_downstream_error_us);
+    expect(tx_packet_count - count_before >= 69,
+           "packets continue across steps");
+    expect(max_downstream_error_us <= 3, "downstream follows the steps");
+
+    // Repeat only while upstream is synchronized.
+    HarpClockOutput::set_mode(HarpClockOutput::REPEAT);
+    upstream_synced = false;
+    count_before = tx_packet_count;
+    run_for(3'000'000);
+    expect(tx_packet_count == count_before,
+           "nothing repeated while unsynchronized");
+    upstream_synced = true;
+    run_for(3'000'000);
+    expect(tx_packet_count - count_before >= 2,
+           "repeated while synchronized");
+
+    HarpClockOutput::set_mode(HarpClockOutput::OFF);
+    count_before = tx_packet_count;
+    run_for(3'000'000);
+    expect(tx_packet_count == count_before, "nothing sent when OFF");
+
+    host_time_set_manual(false);
+    return report_checks("Clock output packets decode on time downstream.");
+}
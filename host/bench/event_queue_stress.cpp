@@ -0,0 +1,96 @@
+#include <mpsc_queue.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Multi-threaded stress test of the queue behind HarpCore::queue_harp_event().
+// Several producers (standing in for interrupts on either core) each queue a
+// numbered sequence of items, retrying whenever the queue is full. The
+// consumer checks that every item arrives exactly once, intact, and in order
+// per producer. Exits with a nonzero status on the first mismatch.
+
+const uint32_t producer_count = 3;
+
+struct slot_t
+{
+    uint32_t producer;
+    uint32_t sequence;
+    uint8_t pattern[24];
+};
+
+MpscQueue<slot_t, 32> queue;
+
+void produce(uint32_t producer, uint32_t item_count)
+{
+    for (uint32_t sequence = 0; sequence < item_count; ++sequence)
+    {
+        slot_t* slot;
+        while ((slot = queue.reserve()) == nullptr)
+            std::this_thread::yield();
+        slot->producer = producer;
+        slot->sequence = sequence;
+        memset(slot->pattern, uint8_t(sequence + producer),
+               sizeof(slot->pattern));
+        queue.commit(slot);
+    }
+}
+
+bool consume(uint32_t item_count)
+{
+    std::vector<uint32_t> next_sequence(producer_count, 0);
+    for (uint32_t i = 0; i < item_count * producer_count; ++i)
+    {
+        slot_t* slot;
+        while ((slot = queue.front()) == nullptr)
+            std::this_thread::yield();
+        if (slot->producer >= producer_count
+            || slot->sequence != next_sequence[slot->producer])
+        {
+            fprintf(stderr, "unexpected item %u from producer %u.\n",
+                    slot->sequence, slot->producer);
+            return false;
+        }
+        for (uint8_t byte: slot->pattern)
+        {
+            if (byte != uint8_t(slot->sequence + slot->producer))
+            {
+                fprintf(stderr, "item %u from producer %u is corrupted.\n",
+                        slot->sequence, slot->producer);
+                return false;
+            }
+        }
+        ++next_sequence[slot->producer];
+        queue.pop();
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t item_count = 1'000'000;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--items") == 0 && (i + 1) < argc)
+            item_count = strtoul(argv[++i], nullptr, 10);
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (uint32_t producer = 0; producer < producer_count; ++producer)
+        producers.emplace_back(produce, producer, item_count);
+    bool ok = consume(item_count);
+    for (std::thread& producer: producers)
+        producer.join();
+    auto stop = std::chrono::steady_clock::now();
+    if (!ok)
+        return EXIT_FAILURE;
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        stop - start).count();
+    printf("case=event_queue_stress producers=%u items=%u ns_per_item=%.1f "
+           "full_retries=%u\n", producer_count, item_count * producer_count,
+           double(ns) / double(item_count * producer_count),
+           queue.drop_count());
+    return EXIT_SUCCESS;
+}
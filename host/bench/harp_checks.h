@@ -0,0 +1,54 @@
+#ifndef HARP_CHECKS_H
+#define HARP_CHECKS_H
+#include <stdint.h>
+#include <cstdio>
+#include <cstdlib>
+#include <host_uart.h>
+#include <harp_sync_encoder.h>
+
+// Helpers shared by the host checks: counting and reporting failed checks,
+// and feeding sync packets to a synchronizer.
+
+/**
+ * \brief number of checks that have failed so far.
+ */
+inline uint32_t failure_count = 0;
+
+/**
+ * \brief count a failed check, and describe it, if \p condition is false.
+ */
+inline void expect(bool condition, const char* description)
+{
+    if (condition)
+        return;
+    ++failure_count;
+    fprintf(stderr, "Failed: %s.\n", description);
+}
+
+/**
+ * \brief print how many checks failed, or \p success_message if none did.
+ * \returns the exit status of the check.
+ */
+inline int report_checks(const char* success_message)
+{
+    if (failure_count)
+    {
+        fprintf(stderr, "%u checks failed.\n", failure_count);
+        return EXIT_FAILURE;
+    }
+    printf("%s\n", success_message);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * \brief push the sync packet that marks the Harp second \p seconds into the
+ *  RX path of \p uart.
+ */
+inline void inject_sync_packet(uint32_t seconds, uart_inst_t* uart = uart1)
+{
+    uint8_t packet[HARP_SYNC_PACKET_SIZE];
+    HarpSyncEncoder::encode(seconds, packet);
+    host_uart_inject(uart, packet, sizeof(packet));
+}
+
+#endif // HARP_CHECKS_H
@@ -0,0 +1,536 @@
+#include <harp_c_app.h>
+#include <harp_app.h>
+#include <host_cdc.h>
+#include <host_time.h>
+#include <harp_frames.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAS_CYCLE_COUNTER
+#endif
+
+// Host-side latency benchmark for HarpCore::run(). Prints one line of
+// key=value pairs per benchmark case. Exits with a nonzero status if any
+// reply is missing or malformed.
+// Built once per app flavor: HarpCApp by default, or the templated HarpApp
+// if HARP_BENCH_TEMPLATED_APP is defined.
+
+// Example app with one register of each common size.
+#pragma pack(push, 1)
+struct app_regs_t
+{
+    volatile uint8_t test_byte;  // app register 0
+    volatile uint32_t test_uint; // app register 1
+} app_regs;
+#pragma pack(pop)
+
+const size_t reg_count = 2;
+
+constexpr RegLayout app_reg_layouts[reg_count]
+{
+    REG_LAYOUT(app_regs_t, test_byte),
+    REG_LAYOUT(app_regs_t, test_uint)
+};
+static_assert(reg_layouts_cover<app_regs_t>(app_reg_layouts),
+              "App register layouts must cover app_regs_t in order.");
+
+constexpr RegFnPair reg_handler_fns[reg_count]
+{
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic}
+};
+
+// Time that each app update spends busy, to model heavy app work.
+std::atomic<uint32_t> app_busy_us{0};
+
+void update_app_state()
+{
+    uint32_t busy_us = app_busy_us;
+    if (busy_us == 0)
+        return;
+    auto stop = std::chrono::steady_clock::now()
+                + std::chrono::microseconds(busy_us);
+    while (std::chrono::steady_clock::now() < stop){}
+}
+
+void reset_app(){}
+
+#if defined(HARP_BENCH_TEMPLATED_APP)
+struct app_handlers_t
+{
+    static constexpr auto& reg_layouts = app_reg_layouts;
+    static constexpr auto& reg_fns = reg_handler_fns;
+    static void update(){update_app_state();}
+    static void reset(){reset_app();}
+};
+
+using BenchApp = HarpApp<app_regs_t, app_handlers_t>;
+BenchApp& app = BenchApp::init(1234, 1, 0, 2, 2, 0, 3, 0, 0xCAFE,
+                               "Host Bench", (const uint8_t*)"host", app_regs);
+#else
+HarpCApp& app = HarpCApp::init(1234, 1, 0, 2, 2, 0, 3, 0, 0xCAFE,
+                               "Host Bench", (const uint8_t*)"host",
+                               &app_regs, app_reg_layouts,
+                               (RegFnPair*)reg_handler_fns, reg_count,
+                               update_app_state, reset_app);
+#endif
+
+struct Sample
+{
+    uint64_t ns;
+    uint64_t cycles;
+};
+
+static inline Sample now()
+{
+    Sample s;
+    s.ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#ifdef HAS_CYCLE_COUNTER
+    s.cycles = __rdtsc();
+#else
+    s.cycles = 0;
+#endif
+    return s;
+}
+
+static bool failed = false;
+
+void report(const char* name, std::vector<Sample>& deltas)
+{
+    if (deltas.empty())
+        return;
+    std::sort(deltas.begin(), deltas.end(),
+              [](const Sample& a, const Sample& b){return a.ns < b.ns;});
+    uint64_t total_ns = 0, total_cycles = 0;
+    for (const Sample& d: deltas)
+    {
+        total_ns += d.ns;
+        total_cycles += d.cycles;
+    }
+    size_t n = deltas.size();
+    printf("case=%s n=%zu mean_ns=%llu p50_ns=%llu p99_ns=%llu max_ns=%llu",
+           name, n, (unsigned long long)(total_ns / n),
+           (unsigned long long)deltas[n / 2].ns,
+           (unsigned long long)deltas[(n * 99) / 100].ns,
+           (unsigned long long)deltas[n - 1].ns);
+#ifdef HAS_CYCLE_COUNTER
+    printf(" mean_cycles=%llu", (unsigned long long)(total_cycles / n));
+#endif
+    printf("\n");
+}
+
+/**
+ * \brief time \p fn over \p iterations runs.
+ */
+void bench(const char* name, size_t iterations, std::function<bool()> fn)
+{
+    std::vector<Sample> deltas;
+    deltas.reserve(iterations);
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        Sample start = now();
+        bool ok = fn();
+        Sample stop = now();
+        if (!ok)
+        {
+            fprintf(stderr, "%s: iteration %zu failed.\n", name, i);
+            failed = true;
+            return;
+        }
+        deltas.push_back({stop.ns - start.ns, stop.cycles - start.cycles});
+    }
+    report(name, deltas);
+}
+
+/**
+ * \brief send a request and call run() until its reply arrives.
+ */
+bool round_trip(const std::vector<uint8_t>& request, msg_type_t reply_type)
+{
+    std::vector<uint8_t> reply;
+    host_cdc_write(request.data(), request.size());
+    for (size_t tries = 0; tries < 64; ++tries)
+    {
+        app.run();
+        if (read_reply(reply))
+            return checksum_ok(reply) && reply[0] == reply_type
+                   && reply[2] == request[2];
+    }
+    return false;
+}
+
+/**
+ * \brief send a request and wait for its reply while the device runs on
+ *  other threads.
+ */
+bool pc_round_trip(const std::vector<uint8_t>& request, msg_type_t reply_type)
+{
+    std::vector<uint8_t> reply;
+    host_cdc_write(request.data(), request.size());
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        if (read_reply(reply))
+            return checksum_ok(reply) && reply[0] == reply_type
+                   && reply[2] == request[2];
+        std::this_thread::yield();
+    }
+    return false;
+}
+
+/**
+ * \brief send an event from a register and collect it on the "PC" side.
+ */
+bool send_event(uint8_t address, reg_type_t payload_type, uint8_t num_bytes)
+{
+    static uint8_t payload[MAX_PACKET_SIZE] = {0};
+    std::vector<uint8_t> reply;
+    HarpCore::send_harp_reply(EVENT, address, payload, num_bytes, payload_type);
+    for (size_t tries = 0; tries < 8; ++tries)
+    {
+        if (read_reply(reply))
+            return checksum_ok(reply) && reply.size() == size_t(num_bytes) + 12;
+        tud_task();
+    }
+    return false;
+}
+
+/**
+ * \brief issue bursts of events between run() calls under a flush policy and
+ *  report how many USB packets each event costs.
+ */
+void bench_burst(const char* name, tx_flush_policy_t policy, size_t iterations,
+                 size_t events_per_run)
+{
+    HarpCore::set_tx_flush_policy(policy, 0);
+    uint8_t payload[4] = {0};
+    std::vector<uint8_t> reply;
+    std::vector<Sample> deltas;
+    deltas.reserve(iterations);
+    size_t events_received = 0;
+    uint32_t start_packets = host_cdc_tx_packet_count();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        Sample start = now();
+        for (size_t e = 0; e < events_per_run; ++e)
+            HarpCore::send_harp_reply(EVENT, APP_REG_START_ADDRESS + 1,
+                                      payload, sizeof(payload), U32);
+        app.run();
+        Sample stop = now();
+        deltas.push_back({stop.ns - start.ns, stop.cycles - start.cycles});
+        while (read_reply(reply))
+            events_received += checksum_ok(reply)? 1: 0;
+    }
+    // Drain anything still waiting on a full packet.
+    HarpCore::set_tx_flush_policy(FLUSH_PER_MSG);
+    for (size_t tries = 0; tries < 8; ++tries)
+    {
+        tud_cdc_write_flush();
+        tud_task();
+    }
+    while (read_reply(reply))
+        events_received += checksum_ok(reply)? 1: 0;
+    if (events_received != iterations * events_per_run)
+    {
+        fprintf(stderr, "%s: received %zu of %zu events.\n", name,
+                events_received, iterations * events_per_run);
+        failed = true;
+        return;
+    }
+    uint32_t packets = host_cdc_tx_packet_count() - start_packets;
+    report(name, deltas);
+    printf("case=%s packets_per_event=%.3f\n", name,
+           double(packets) / double(events_received));
+}
+
+/**
+ * \brief queue timestamped events as an interrupt would, with device time
+ *  advancing between them, and check that run() sends each one with the
+ *  Harp time at which it was queued.
+ */
+void bench_queued_events(const char* name, size_t iterations,
+                         size_t events_per_run)
+{
+    host_time_set_manual(true);
+    uint32_t payload = 0;
+    std::vector<uint8_t> reply;
+    std::deque<uint64_t> queued_times_us;
+    std::vector<Sample> deltas;
+    deltas.reserve(iterations);
+    size_t events_received = 0;
+    size_t timestamp_errors = 0;
+    auto check_replies = [&]()
+    {
+        while (read_reply(reply))
+        {
+            uint64_t harp_time_us =
+                HarpCore::system_to_harp_us_64(queued_times_us.front());
+            queued_times_us.pop_front();
+            uint32_t seconds;
+            uint16_t micros;
+            memcpy(&seconds, &reply[5], sizeof(seconds));
+            memcpy(&micros, &reply[9], sizeof(micros));
+            if (!checksum_ok(reply) || reply[0] != EVENT
+                || seconds != harp_time_us / 1'000'000
+                || micros != (harp_time_us % 1'000'000) >> 5)
+                ++timestamp_errors;
+            ++events_received;
+        }
+    };
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        for (size_t e = 0; e < events_per_run; ++e)
+        {
+            queued_times_us.push_back(time_us_64());
+            ++payload;
+            HarpCore::queue_harp_event(APP_REG_START_ADDRESS + 1,
+                                       (uint8_t*)&payload, sizeof(payload),
+                                       U32);
+            host_time_advance_us(37);
+        }
+        Sample start = now();
+        app.run();
+        Sample stop = now();
+        deltas.push_back({stop.ns - start.ns, stop.cycles - start.cycles});
+        check_replies();
+    }
+    // Collect anything still in flight.
+    for (size_t tries = 0; tries < 8; ++tries)
+        tud_task();
+    check_replies();
+    host_time_set_manual(false);
+    if (events_received != iterations * events_per_run || timestamp_errors)
+    {
+        fprintf(stderr, "%s: received %zu of %zu events. %zu were wrong.\n",
+                name, events_received, iterations * events_per_run,
+                timestamp_errors);
+        failed = true;
+        return;
+    }
+    report(name, deltas);
+}
+
+/**
+ * \brief send \p depth requests at once and call run() until every reply
+ *  arrives. Report how many run() calls each request costs.
+ */
+void bench_pipelined(const char* name, const std::vector<uint8_t>& request,
+                     msg_type_t reply_type, size_t iterations, size_t depth)
+{
+    std::vector<uint8_t> requests;
+    for (size_t i = 0; i < depth; ++i)
+        requests.insert(requests.end(), request.begin(), request.end());
+    std::vector<uint8_t> reply;
+    std::vector<Sample> deltas;
+    deltas.reserve(iterations);
+    size_t total_runs = 0;
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        size_t replies = 0;
+        Sample start = now();
+        host_cdc_write(requests.data(), requests.size());
+        for (size_t runs = 0; replies < depth && runs < depth * 8; ++runs)
+        {
+            app.run();
+            ++total_runs;
+            while (read_reply(reply))
+            {
+                if (!checksum_ok(reply) || reply[0] != reply_type)
+                    break;
+                ++replies;
+            }
+        }
+        Sample stop = now();
+        if (replies != depth)
+        {
+            fprintf(stderr, "%s: iteration %zu received %zu of %zu replies.\n",
+                    name, i, replies, depth);
+            failed = true;
+            return;
+        }
+        deltas.push_back({stop.ns - start.ns, stop.cycles - start.cycles});
+    }
+    report(name, deltas);
+    printf("case=%s runs_per_request=%.3f\n", name,
+           double(total_runs) / double(iterations * depth));
+}
+
+/**
+ * \brief send a corrupted byte sequence followed by a valid request and
+ *  report how much device time elapses before the valid request's reply
+ *  arrives. Device time advances by \p run_period_us per run() call.
+ */
+void bench_recovery(const char* name, size_t iterations,
+                    std::function<std::vector<uint8_t>(size_t)> corruption,
+                    const std::vector<uint8_t>& request, msg_type_t reply_type,
+                    uint32_t run_period_us = 100)
+{
+    host_time_set_manual(true);
+    std::vector<uint8_t> reply;
+    std::vector<uint64_t> recovery_us;
+    recovery_us.reserve(iterations);
+    uint32_t start_discards = HarpCore::rx_discarded_byte_count();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        std::vector<uint8_t> bytes = corruption(i);
+        host_cdc_write(bytes.data(), bytes.size());
+        host_cdc_write(request.data(), request.size());
+        bool recovered = false;
+        uint64_t elapsed_us = 0;
+        while (!recovered && elapsed_us < 1'000'000)
+        {
+            app.run();
+            while (read_reply(reply))
+                recovered |= checksum_ok(reply) && reply[0] == reply_type
+                             && reply[2] == request[2];
+            host_time_advance_us(run_period_us);
+            elapsed_us += run_period_us;
+        }
+        if (!recovered)
+        {
+            fprintf(stderr, "%s: iteration %zu never recovered.\n", name, i);
+            failed = true;
+            break;
+        }
+        recovery_us.push_back(elapsed_us);
+    }
+    host_time_set_manual(false);
+    if (failed)
+        return;
+    std::sort(recovery_us.begin(), recovery_us.end());
+    uint64_t total_us = 0;
+    for (uint64_t us: recovery_us)
+        total_us += us;
+    size_t n = recovery_us.size();
+    printf("case=%s n=%zu mean_us=%llu p50_us=%llu p99_us=%llu max_us=%llu "
+           "discarded_bytes_per_iteration=%.2f\n", name, n,
+           (unsigned long long)(total_us / n),
+           (unsigned long long)recovery_us[n / 2],
+           (unsigned long long)recovery_us[(n * 99) / 100],
+           (unsigned long long)recovery_us[n - 1],
+           double(HarpCore::rx_discarded_byte_count() - start_discards) / n);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t iterations = 100'000;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--iterations") == 0 && (i + 1) < argc)
+            iterations = strtoul(argv[++i], nullptr, 10);
+    }
+    // Settle into ACTIVE mode with heartbeats disabled so that background
+    // events do not interleave with replies.
+    for (size_t i = 0; i < 8; ++i)
+        app.run();
+    uint8_t op_ctrl = ACTIVE;
+    round_trip(make_request(WRITE, OPERATION_CTRL, U8, &op_ctrl, 1), WRITE);
+    std::vector<uint8_t> drain;
+    while (read_reply(drain)){}
+
+    auto read_core_u8 = make_request(READ, OPERATION_CTRL, U8);
+    auto read_core_u32 = make_request(READ, TIMESTAMP_SECOND, U32);
+    auto read_app_u32 = make_request(READ, APP_REG_START_ADDRESS + 1, U32);
+    uint32_t value = 0xDEADBEEF;
+    auto write_app_u32 = make_request(WRITE, APP_REG_START_ADDRESS + 1, U32,
+                                      &value, sizeof(value));
+
+    bench("idle_run", iterations, []{app.run(); return true;});
+    bench("send_event_u32", iterations,
+          []{return send_event(APP_REG_START_ADDRESS + 1, U32, 4);});
+    bench("send_event_u8x32", iterations,
+          []{return send_event(APP_REG_START_ADDRESS, U8, 32);});
+    bench_burst("burst8_flush_per_msg", FLUSH_PER_MSG, iterations / 8, 8);
+    bench_burst("burst8_flush_per_run", FLUSH_PER_RUN, iterations / 8, 8);
+    bench_burst("burst8_flush_on_full_packet", FLUSH_ON_FULL_PACKET,
+                iterations / 8, 8);
+    bench_burst("burst8_flush_on_deadline", FLUSH_ON_DEADLINE,
+                iterations / 8, 8);
+    HarpCore::set_tx_flush_policy(FLUSH_PER_MSG);
+    bench_queued_events("queued_events8_flush_per_msg", iterations / 8, 8);
+    HarpCore::set_tx_flush_policy(FLUSH_PER_RUN);
+    bench_queued_events("queued_events8_flush_per_run", iterations / 8, 8);
+    HarpCore::set_tx_flush_policy(FLUSH_PER_MSG);
+    bench("read_core_u8", iterations,
+          [&]{return round_trip(read_core_u8, READ);});
+    bench("read_core_timestamp_u32", iterations,
+          [&]{return round_trip(read_core_u32, READ);});
+    bench("read_app_u32", iterations,
+          [&]{return round_trip(read_app_u32, READ);});
+    bench("write_app_u32", iterations,
+          [&]{return round_trip(write_app_u32, WRITE);});
+    bench_pipelined("pipelined8_read_core_u8", read_core_u8, READ,
+                    iterations / 8, 8);
+    HarpCore::set_max_msgs_per_run(1);
+    bench_pipelined("pipelined8_read_core_u8_budget1", read_core_u8, READ,
+                    iterations / 8, 8);
+    HarpCore::set_max_msgs_per_run(MAX_MSGS_PER_RUN);
+    HarpCore::set_cdc_rx_irq_enabled(true);
+    bench("read_core_u8_rx_irq", iterations,
+          [&]{return round_trip(read_core_u8, READ);});
+    bench_pipelined("pipelined8_read_core_u8_rx_irq", read_core_u8, READ,
+                    iterations / 8, 8);
+    HarpCore::set_cdc_rx_irq_enabled(false);
+
+    // Corruption recovery. Device time is simulated, so keep these short.
+    size_t recovery_iterations = std::min<size_t>(iterations, 2000);
+    srand(1);
+    bench_recovery("recover_garbage_byte", recovery_iterations,
+                   [](size_t){return std::vector<uint8_t>{uint8_t(rand())};},
+                   read_core_u8, READ);
+    bench_recovery("recover_truncated_msg", recovery_iterations,
+                   [&](size_t i)
+                   {
+                       return std::vector<uint8_t>(
+                           write_app_u32.begin(),
+                           write_app_u32.begin() + 1
+                           + (i % (write_app_u32.size() - 1)));
+                   },
+                   read_core_u8, READ);
+    bench_recovery("recover_corrupted_msg", recovery_iterations,
+                   [&](size_t i)
+                   {
+                       std::vector<uint8_t> bytes = write_app_u32;
+                       bytes[i % bytes.size()] ^= uint8_t(1 + rand() % 255);
+                       return bytes;
+                   },
+                   read_core_u8, READ);
+
+    // Heavy app work. Single-core first, then dual-core, where the "PC" (this
+    // thread) talks to core1 while another thread loops core0's run().
+    size_t busy_iterations = std::min<size_t>(iterations, 2000);
+    app_busy_us = 200;
+    bench("read_core_u8_busy_app", busy_iterations,
+          [&]{return round_trip(read_core_u8, READ);});
+    HarpCore::launch_core1();
+    std::thread([]
+                {
+                    while (true)
+                    {
+                        app.run();
+                        std::this_thread::yield();
+                    }
+                }).detach();
+    bench("read_core_u8_busy_app_dual_core", busy_iterations,
+          [&]{return pc_round_trip(read_core_u8, READ);});
+    bench("read_app_u32_busy_app_dual_core", busy_iterations,
+          [&]{return pc_round_trip(read_app_u32, READ);});
+    app_busy_us = 0;
+    bench("read_core_u8_dual_core", iterations,
+          [&]{return pc_round_trip(read_core_u8, READ);});
+    bench("write_app_u32_dual_core", iterations,
+          [&]{return pc_round_trip(write_app_u32, WRITE);});
+    // Core1 never returns, so skip static destructors that it still uses.
+    fflush(stdout);
+    _Exit(failed? EXIT_FAILURE: EXIT_SUCCESS);
+}
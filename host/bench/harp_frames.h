@@ -0,0 +1,60 @@
+#ifndef HARP_FRAMES_H
+#define HARP_FRAMES_H
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <host_cdc.h>
+#include <harp_message.h>
+
+// "PC-side" helpers for building requests and collecting device replies.
+
+/**
+ * \brief build a Harp request (no timestamp) from the PC to the device.
+ */
+inline std::vector<uint8_t> make_request(msg_type_t type, uint8_t address,
+                                         reg_type_t payload_type,
+                                         const void* payload = nullptr,
+                                         uint8_t num_bytes = 0)
+{
+    std::vector<uint8_t> frame{uint8_t(type), uint8_t(4 + num_bytes), address,
+                               255, uint8_t(payload_type)};
+    for (uint8_t i = 0; i < num_bytes; ++i)
+        frame.push_back(((const uint8_t*)payload)[i]);
+    uint8_t checksum = 0;
+    for (uint8_t byte: frame)
+        checksum += byte;
+    frame.push_back(checksum);
+    return frame;
+}
+
+/**
+ * \brief pop one complete reply from the device if it has fully arrived.
+ * \returns true if a reply was popped into \p frame.
+ */
+inline bool read_reply(std::vector<uint8_t>& frame)
+{
+    static std::vector<uint8_t> pending;
+    uint8_t buffer[256];
+    size_t bytes_read;
+    while ((bytes_read = host_cdc_read(buffer, sizeof(buffer))) > 0)
+        pending.insert(pending.end(), buffer, buffer + bytes_read);
+    if (pending.size() < 2 || pending.size() < size_t(pending[1]) + 2)
+        return false;
+    size_t frame_size = size_t(pending[1]) + 2;
+    frame.assign(pending.begin(), pending.begin() + frame_size);
+    pending.erase(pending.begin(), pending.begin() + frame_size);
+    return true;
+}
+
+/**
+ * \brief true if the frame's checksum matches its contents.
+ */
+inline bool checksum_ok(const std::vector<uint8_t>& frame)
+{
+    uint8_t checksum = 0;
+    for (size_t i = 0; i + 1 < frame.size(); ++i)
+        checksum += frame[i];
+    return !frame.empty() && checksum == frame.back();
+}
+
+#endif // HARP_FRAMES_H
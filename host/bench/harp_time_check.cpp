@@ -0,0 +1,115 @@
+#include <check_app.h>
+#include <harp_synchronizer.h>
+#include <host_time.h>
+#include <host_uart.h>
+#include <harp_checks.h>
+#include <cstdio>
+#include <cstdlib>
+
+// Checks the truncated 32-bit Harp time functions against their 64-bit
+// counterparts across 32-bit timer wraparound, for offsets in either
+// direction, with and without an attached synchronizer.
+// Exits with a nonzero status on the first mismatch.
+
+const uint64_t wrap = 1ULL << 32;
+
+// System times just before, at, and after 32-bit wraparound points.
+const uint64_t system_times_us[] {0, 1, 1'000'000, wrap - 2, wrap - 1, wrap,
+                                  wrap + 1, 2 * wrap - 1, 5 * wrap + 12345,
+                                  (1ULL << 40) + wrap - 7};
+
+// Harp times both behind and ahead of the system time.
+const uint64_t harp_times_us[] {0, 1, 12345, wrap - 1, wrap, wrap + 7,
+                                3'900'000'000'000'000ULL};
+
+// Elapsed intervals (< 2^31) over which signed differences must hold.
+const uint32_t intervals_us[] {0, 1, 1'000'000, 0x7FFF'FFFF};
+
+HarpCApp& app = init_check_app("Host Time Check");
+
+void expect_eq(const char* label, uint64_t system_time_us, uint32_t actual,
+               uint32_t expected)
+{
+    if (actual == expected)
+        return;
+    ++failure_count;
+    fprintf(stderr, "%s at system time %llu: got %u, expected %u.\n", label,
+            (unsigned long long)system_time_us, actual, expected);
+}
+
+// Check the 32-bit time functions at the current (manual) time.
+void check_now()
+{
+    uint64_t system_time_us = time_us_64();
+    uint64_t harp_time_us = HarpCore::harp_time_us_64();
+    expect_eq("harp_time_us_32", system_time_us,
+              HarpCore::harp_time_us_32(), uint32_t(harp_time_us));
+    expect_eq("system_to_harp_us_32", system_time_us,
+              HarpCore::system_to_harp_us_32(uint32_t(system_time_us)),
+              uint32_t(harp_time_us));
+    expect_eq("harp_to_system_us_32", system_time_us,
+              HarpCore::harp_to_system_us_32(harp_time_us),
+              uint32_t(system_time_us));
+}
+
+// Check the 32-bit time functions at and after each system time, given a
+// function that re-synchronizes the clock.
+template <typename SetTimeFn>
+void check_all(SetTimeFn set_time)
+{
+    for (uint64_t system_time_us: system_times_us)
+    {
+        for (uint64_t harp_time_us: harp_times_us)
+        {
+            host_time_set_us(system_time_us);
+            set_time(harp_time_us);
+            check_now();
+            for (uint32_t interval_us: intervals_us)
+            {
+                host_time_set_us(system_time_us);
+                uint32_t start_us = HarpCore::harp_time_us_32();
+                host_time_advance_us(interval_us);
+                check_now();
+                expect_eq("interval", system_time_us,
+                          uint32_t(int32_t(HarpCore::harp_time_us_32()
+                                           - start_us)),
+                          interval_us);
+            }
+        }
+    }
+}
+
+// Re-synchronize the clock with the sync packet of the second at
+// \p harp_time_us.
+void inject_sync_packet_at(uint64_t harp_time_us)
+{inject_sync_packet(uint32_t(harp_time_us / 1'000'000));}
+
+int main()
+{
+    host_time_set_manual(true);
+    check_all([](uint64_t harp_time_us)
+              {HarpCore::set_harp_time_us_64(harp_time_us);});
+    HarpSynchronizer& sync = HarpSynchronizer::init(uart1, 5);
+    HarpCore::set_synchronizer(&sync);
+    check_all([](uint64_t harp_time_us)
+              {HarpCore::set_harp_time_us_64(harp_time_us);});
+    check_all(inject_sync_packet_at);
+    // Check the synchronizer's own 32-bit time against its 64-bit time.
+    host_time_set_us(wrap - 3);
+    inject_sync_packet_at(3'900'000'000'000'000ULL);
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        expect_eq("HarpSynchronizer::time_us_32", time_us_64(),
+                  HarpSynchronizer::time_us_32(),
+                  uint32_t(HarpSynchronizer::time_us_64()));
+        host_time_advance_us(1);
+    }
+    host_time_set_manual(false);
+    if (failure_count)
+    {
+        fprintf(stderr, "%u mismatches.\n", failure_count);
+        return EXIT_FAILURE;
+    }
+    printf("32-bit Harp time matches 64-bit Harp time.\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+#include <check_app.h>
+#include <host_cdc.h>
+#include <host_time.h>
+#include <harp_frames.h>
+#include <harp_checks.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Checks that heartbeats are timestamped exactly at whole Harp seconds even
+// when the app loop only calls run() a few times per second, and that they
+// follow writes to the timestamp registers. The alarm pool starts out full,
+// so the heartbeat alarm also has to be armed again once a slot frees up.
+// Exits with a nonzero status if any check fails.
+
+int64_t unused_alarm_callback(alarm_id_t, void*)
+{return 0;}
+
+/**
+ * \brief take every free slot in the alarm pool.
+ * \returns the ids of the alarms taking them, which never fire.
+ */
+std::vector<alarm_id_t> fill_alarm_pool()
+{
+    std::vector<alarm_id_t> ids;
+    while (true)
+    {
+        alarm_id_t id = add_alarm_at(from_us_since_boot(UINT64_MAX),
+                                     unused_alarm_callback, nullptr, false);
+        if (id <= 0)
+            return ids;
+        ids.push_back(id);
+    }
+}
+
+// Created before the app so that its heartbeat alarm finds no free slot.
+std::vector<alarm_id_t> filler_alarm_ids = fill_alarm_pool();
+HarpCApp& app = init_check_app("Host Heartbeat Check");
+
+const uint64_t system_start_us = 1'000'000'000ULL;
+const uint64_t loop_period_us = 333'333; // a slow app loop.
+
+/**
+ * \brief run the app loop for \p duration_us and check the heartbeats sent.
+ * \returns the number of heartbeats.
+ */
+uint32_t run_for(uint64_t duration_us)
+{
+    uint32_t heartbeat_count = 0;
+    uint32_t prev_seconds = 0;
+    uint64_t end_us = time_us_64() + duration_us;
+    std::vector<uint8_t> frame;
+    while (time_us_64() < end_us)
+    {
+        host_time_advance_us(loop_period_us);
+        app.run();
+        while (read_reply(frame))
+        {
+            if (frame[0] != EVENT || frame[2] != TIMESTAMP_SECOND)
+                continue;
+            uint32_t seconds;
+            uint16_t micros;
+            uint32_t payload;
+            memcpy(&seconds, &frame[5], sizeof(seconds));
+            memcpy(&micros, &frame[9], sizeof(micros));
+            memcpy(&payload, &frame[11], sizeof(payload));
+            expect(checksum_ok(frame), "heartbeat checksum");
+            expect(micros == 0 && payload == seconds,
+                   "heartbeats are timestamped at whole seconds");
+            expect(heartbeat_count == 0 || seconds == prev_seconds + 1,
+                   "heartbeats are one second apart");
+            prev_seconds = seconds;
+            ++heartbeat_count;
+        }
+    }
+    return heartbeat_count;
+}
+
+int main()
+{
+    host_time_set_manual(true);
+    host_time_set_us(system_start_us);
+    HarpCore::set_harp_time_us_64(3'900'000'000'123'456ULL);
+    for (size_t i = 0; i < 8; ++i)
+        app.run();
+    uint8_t op_ctrl = ACTIVE | (1u << ALIVE_EN_OFFSET);
+    std::vector<uint8_t> request = make_request(WRITE, OPERATION_CTRL, U8,
+                                                &op_ctrl, 1);
+    host_cdc_write(request.data(), request.size());
+    app.run();
+    std::vector<uint8_t> drain;
+    while (read_reply(drain)){}
+
+    uint32_t heartbeat_count = run_for(3 * loop_period_us);
+    printf("case=full_alarm_pool heartbeats=%u\n", heartbeat_count);
+    expect(heartbeat_count == 0, "no heartbeats without a free alarm slot");
+    for (alarm_id_t id: filler_alarm_ids)
+        cancel_alarm(id);
+
+    heartbeat_count = run_for(20'000'000);
+    printf("case=slow_loop heartbeats=%u\n", heartbeat_count);
+    // The first ACTIVE heartbeat may wait out the last STANDBY interval.
+    expect(heartbeat_count >= 17 && heartbeat_count <= 20,
+           "one heartbeat per second");
+
+    // Step the Harp time to the middle of a second.
+    uint32_t seconds = 3'950'000'000U;
+    request = make_request(WRITE, TIMESTAMP_SECOND, U32, &seconds,
+                           sizeof(seconds));
+    host_cdc_write(request.data(), request.size());
+    app.run();
+    while (read_reply(drain)){}
+    heartbeat_count = run_for(10'000'000);
+    printf("case=after_step heartbeats=%u\n", heartbeat_count);
+    expect(heartbeat_count >= 9 && heartbeat_count <= 10,
+           "heartbeats follow the new Harp time");
+
+    host_time_set_manual(false);
+    return report_checks("Heartbeats land on whole Harp seconds.");
+}
@@ -0,0 +1,146 @@
+#include <check_app.h>
+#include <harp_profiler.h>
+#include <host_cdc.h>
+#include <host_time.h>
+#include <harp_frames.h>
+#include <harp_checks.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Checks the run() phase statistics read through R_PROFILE_CTRL and
+// R_PROFILE. Built twice: with HARP_CORE_PROFILE, the stats must count
+// every run() and dispatched message; without it, they must read zeros.
+// Exits with a nonzero status if any check fails.
+
+HarpCApp& app = init_check_app("Host Profile Check");
+
+const size_t profile_words = 4 + HARP_PROFILE_HIST_BINS;
+
+/**
+ * \brief send a request and call run() until its reply arrives.
+ * \returns the reply's payload, or an empty vector if none arrived.
+ */
+std::vector<uint8_t> round_trip(const std::vector<uint8_t>& request,
+                                msg_type_t reply_type)
+{
+    std::vector<uint8_t> reply;
+    host_cdc_write(request.data(), request.size());
+    for (size_t tries = 0; tries < 64; ++tries)
+    {
+        app.run();
+        if (!read_reply(reply))
+            continue;
+        if (!checksum_ok(reply) || reply[0] != reply_type
+            || reply[2] != request[2])
+            break;
+        // Payload follows the header and the 6-byte timestamp.
+        return std::vector<uint8_t>(reply.begin() + 11, reply.end() - 1);
+    }
+    return {};
+}
+
+/**
+ * \brief select \p phase on \p core (and optionally reset all phases), then
+ *  read back its stats.
+ */
+HarpProfiler::PhaseStats read_phase(HarpProfiler::Phase phase,
+                                    uint8_t core = 0, bool reset = false)
+{
+    uint8_t ctrl = phase | (core << PROFILE_CORE_OFFSET)
+                   | (uint8_t(reset) << PROFILE_RESET_OFFSET);
+    expect(!round_trip(make_request(WRITE, PROFILE_CTRL, U8, &ctrl, 1),
+                       WRITE).empty(), "R_PROFILE_CTRL accepts a phase");
+    std::vector<uint8_t> payload = round_trip(make_request(READ, PROFILE, U32),
+                                              READ);
+    HarpProfiler::PhaseStats stats{};
+    if (payload.size() == profile_words * sizeof(uint32_t))
+        memcpy(&stats, payload.data(), payload.size());
+    else
+        expect(false, "R_PROFILE carries count, min, max, mean, and bins");
+    return stats;
+}
+
+/**
+ * \brief check that \p stats are self-consistent.
+ */
+void expect_consistent(const HarpProfiler::PhaseStats& stats)
+{
+    uint64_t binned = 0;
+    for (uint32_t bin_count: stats.histogram)
+        binned += bin_count;
+    expect(binned == stats.count, "histogram bins add up to the count");
+    expect(stats.count == 0 || (stats.min_ticks <= stats.mean_ticks
+                                && stats.mean_ticks <= stats.max_ticks),
+           "min <= mean <= max");
+}
+
+int main()
+{
+    host_time_set_manual(true);
+    host_time_set_us(1'000'000'000ULL);
+    // Settle into ACTIVE mode with heartbeats disabled so that background
+    // events do not interleave with replies.
+    for (size_t i = 0; i < 8; ++i)
+        app.run();
+    uint8_t op_ctrl = ACTIVE;
+    round_trip(make_request(WRITE, OPERATION_CTRL, U8, &op_ctrl, 1), WRITE);
+    std::vector<uint8_t> drain;
+    while (read_reply(drain)){}
+
+    uint8_t bad_phase = HarpProfiler::PHASE_COUNT;
+    expect(!round_trip(make_request(WRITE, PROFILE_CTRL, U8, &bad_phase, 1),
+                       WRITE_ERROR).empty(),
+           "selecting a phase that does not exist is an error");
+    uint32_t zeros[profile_words] = {};
+    expect(!round_trip(make_request(WRITE, PROFILE, U32, zeros,
+                                    sizeof(zeros)), WRITE_ERROR).empty(),
+           "R_PROFILE is read-only");
+
+    // Reset, then run idle loops and dispatch a few requests.
+    read_phase(HarpProfiler::RUN, 0, true);
+    const uint32_t idle_runs = 200;
+    for (uint32_t i = 0; i < idle_runs; ++i)
+        app.run();
+    const uint32_t request_count = 10;
+    for (uint32_t i = 0; i < request_count; ++i)
+        round_trip(make_request(READ, WHO_AM_I, U16), READ);
+
+    HarpProfiler::PhaseStats run = read_phase(HarpProfiler::RUN);
+    HarpProfiler::PhaseStats dispatch = read_phase(HarpProfiler::DISPATCH);
+    HarpProfiler::PhaseStats app_update = read_phase(HarpProfiler::APP_UPDATE);
+    HarpProfiler::PhaseStats core1_run = read_phase(HarpProfiler::RUN, 1);
+    printf("profiled=%d run: count=%u min=%u max=%u mean=%u\n",
+           HarpProfiler::enabled(), run.count, run.min_ticks, run.max_ticks,
+           run.mean_ticks);
+    printf("profiled=%d dispatch: count=%u min=%u max=%u mean=%u\n",
+           HarpProfiler::enabled(), dispatch.count, dispatch.min_ticks,
+           dispatch.max_ticks, dispatch.mean_ticks);
+    expect_consistent(run);
+    expect_consistent(dispatch);
+    expect_consistent(app_update);
+    expect(core1_run.count == 0, "core1 records nothing without launch_core1");
+    if (HarpProfiler::enabled())
+    {
+        expect(run.count >= idle_runs + request_count,
+               "every run() is counted");
+        expect(app_update.count >= run.count,
+               "every run() updates the app");
+        expect(dispatch.count >= request_count,
+               "every dispatched request is counted");
+        expect(run.max_ticks > 0, "run() takes some time");
+        // Resetting clears the counts.
+        HarpProfiler::PhaseStats after_reset =
+            read_phase(HarpProfiler::RUN, 0, true);
+        expect(after_reset.count < 4, "reset clears the stats");
+    }
+    else
+    {
+        expect(run.count == 0 && dispatch.count == 0 && app_update.count == 0
+               && run.max_ticks == 0,
+               "stats read zeros without HARP_CORE_PROFILE");
+    }
+
+    host_time_set_manual(false);
+    return report_checks("Profile registers are consistent.");
+}
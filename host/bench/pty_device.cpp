@@ -0,0 +1,253 @@
+#include <harp_c_app.h>
+#include <host_cdc.h>
+#include <host_time.h>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Host-built Harp device behind a pseudo-terminal, so that PC-side tools
+// (i.e: tests/benchmark.py) can talk to the core without a device attached.
+// Prints "pty=<path>" once the port is open, then serves it until SIGINT or
+// SIGTERM. With --link <path>, also creates a symlink to the port there.
+// The system time follows the host's monotonic clock, and alarms fire as
+// it passes them.
+
+#define BENCH_DEVICE_NAME "Harp Bench Device" // lets tools detect the app
+                                              // registers below.
+
+// App registers: one of each payload type, a few arrays, and a paced event
+// source.
+#pragma pack(push, 1)
+struct app_regs_t
+{
+    volatile uint8_t test_u8;           // app register 0
+    volatile int8_t test_s8;            // app register 1
+    volatile uint16_t test_u16;         // app register 2
+    volatile int16_t test_s16;          // app register 3
+    volatile uint32_t test_u32;         // app register 4
+    volatile int32_t test_s32;          // app register 5
+    volatile uint64_t test_u64;         // app register 6
+    volatile int64_t test_s64;          // app register 7
+    volatile float test_float;          // app register 8
+    volatile uint8_t test_u8_array[16]; // app register 9
+    volatile uint32_t test_u32_array[12]; // app register 10
+    volatile uint32_t event_rate_hz;    // app register 11. Events sent from
+                                        // event_seq while ACTIVE. 0 is off.
+    volatile uint32_t event_seq;        // app register 12. Increments per
+                                        // event.
+    volatile uint32_t event_drops;      // app register 13. Events that did
+                                        // not fit in the event queue.
+} app_regs;
+#pragma pack(pop)
+
+const size_t reg_count = 14;
+
+constexpr RegLayout app_reg_layouts[reg_count]
+{
+    REG_LAYOUT(app_regs_t, test_u8),
+    REG_LAYOUT(app_regs_t, test_s8),
+    REG_LAYOUT(app_regs_t, test_u16),
+    REG_LAYOUT(app_regs_t, test_s16),
+    REG_LAYOUT(app_regs_t, test_u32),
+    REG_LAYOUT(app_regs_t, test_s32),
+    REG_LAYOUT(app_regs_t, test_u64),
+    REG_LAYOUT(app_regs_t, test_s64),
+    REG_LAYOUT(app_regs_t, test_float),
+    REG_LAYOUT(app_regs_t, test_u8_array),
+    REG_LAYOUT(app_regs_t, test_u32_array),
+    REG_LAYOUT(app_regs_t, event_rate_hz),
+    REG_LAYOUT(app_regs_t, event_seq),
+    REG_LAYOUT(app_regs_t, event_drops),
+};
+static_assert(reg_layouts_cover<app_regs_t>(app_reg_layouts),
+              "App register layouts must cover app_regs_t in order.");
+
+RegFnPair reg_handler_fns[reg_count]
+{
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_to_read_only_reg_error},
+    {&HarpCore::read_reg_generic, &HarpCore::write_to_read_only_reg_error},
+};
+
+uint64_t next_event_us = 0;
+
+void update_app_state()
+{
+    uint32_t rate_hz = app_regs.event_rate_hz;
+    uint64_t now_us = time_us_64();
+    if (rate_hz == 0 || !HarpCore::events_enabled())
+    {
+        next_event_us = now_us;
+        return;
+    }
+    // Catch up on every event that is due, so the rate holds even if run()
+    // is called less often.
+    uint64_t period_us = 1'000'000 / rate_hz;
+    for (; next_event_us <= now_us; next_event_us += (period_us? period_us: 1))
+    {
+        app_regs.event_seq = app_regs.event_seq + 1;
+        if (!HarpCore::queue_harp_event(APP_REG_START_ADDRESS + 12,
+                                        (volatile uint8_t*)&app_regs.event_seq,
+                                        sizeof(app_regs.event_seq), U32))
+            app_regs.event_drops = app_regs.event_drops + 1;
+        if (period_us == 0)
+            break;
+    }
+}
+
+void reset_app()
+{
+    memset((void*)&app_regs, 0, sizeof(app_regs));
+}
+
+HarpCApp& app = HarpCApp::init(1234, 1, 0, 2, 2, 0, 3, 0, 0xCAFE,
+                               BENCH_DEVICE_NAME, (const uint8_t*)"host",
+                               &app_regs, app_reg_layouts,
+                               reg_handler_fns, reg_count,
+                               update_app_state, reset_app);
+
+volatile sig_atomic_t stop_requested = 0;
+
+void request_stop(int signal_number)
+{
+    (void)signal_number;
+    stop_requested = 1;
+}
+
+/**
+ * \brief advance the (manual) system time to follow the host's clock.
+ */
+void follow_host_clock()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    static const uint64_t start_us = time_us_64();
+    uint64_t now_us = start_us
+        + std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - start).count();
+    if (now_us > time_us_64())
+        host_time_set_us(now_us);
+}
+
+/**
+ * \brief open a pseudo-terminal in raw mode.
+ * \returns the master's file descriptor, or -1 on failure. \p slave_fd stays
+ *  open so that the master keeps working while no client has the port open.
+ */
+int open_pty(int& slave_fd, std::string& slave_path)
+{
+    int master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_fd < 0 || grantpt(master_fd) || unlockpt(master_fd))
+        return -1;
+    slave_path = ptsname(master_fd);
+    slave_fd = open(slave_path.c_str(), O_RDWR | O_NOCTTY);
+    if (slave_fd < 0)
+        return -1;
+    termios settings;
+    tcgetattr(slave_fd, &settings);
+    cfmakeraw(&settings);
+    tcsetattr(slave_fd, TCSANOW, &settings);
+    fcntl(master_fd, F_SETFL, fcntl(master_fd, F_GETFL) | O_NONBLOCK);
+    return master_fd;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* link_path = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--link") && (i + 1 < argc))
+            link_path = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [--link <path>]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    int slave_fd;
+    std::string slave_path;
+    int master_fd = open_pty(slave_fd, slave_path);
+    if (master_fd < 0)
+    {
+        perror("Could not open a pseudo-terminal");
+        return EXIT_FAILURE;
+    }
+    if (link_path != nullptr)
+    {
+        unlink(link_path);
+        if (symlink(slave_path.c_str(), link_path))
+        {
+            perror("Could not link the pseudo-terminal");
+            return EXIT_FAILURE;
+        }
+    }
+    signal(SIGINT, request_stop);
+    signal(SIGTERM, request_stop);
+    follow_host_clock();
+    host_time_set_manual(true);
+    printf("pty=%s\n", slave_path.c_str());
+    fflush(stdout);
+
+    std::vector<uint8_t> tx_pending; // device output the PC has not taken.
+    uint8_t buffer[512];
+    while (!stop_requested)
+    {
+        follow_host_clock();
+        bool busy = false;
+        ssize_t bytes_read = read(master_fd, buffer, sizeof(buffer));
+        if (bytes_read > 0)
+        {
+            host_cdc_write(buffer, bytes_read);
+            busy = true;
+        }
+        app.run();
+        // Leave output in the device's TX FIFO while the PC is not reading.
+        size_t bytes_available;
+        while (tx_pending.size() < sizeof(buffer)
+               && (bytes_available = host_cdc_read(buffer, sizeof(buffer))))
+            tx_pending.insert(tx_pending.end(), buffer,
+                              buffer + bytes_available);
+        if (!tx_pending.empty())
+        {
+            ssize_t bytes_written = write(master_fd, tx_pending.data(),
+                                          tx_pending.size());
+            if (bytes_written > 0)
+            {
+                tx_pending.erase(tx_pending.begin(),
+                                 tx_pending.begin() + bytes_written);
+                busy = true;
+            }
+        }
+        // Sleep until the PC writes or the next poll when idle. Paced events
+        // need run() to be called often, so only yield while they are on.
+        if (!busy)
+        {
+            pollfd input{master_fd, POLLIN, 0};
+            poll(&input, 1, (app_regs.event_rate_hz && tx_pending.empty())?
+                                0: 1);
+        }
+    }
+    if (link_path != nullptr)
+        unlink(link_path);
+    close(slave_fd);
+    close(master_fd);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+#include <check_app.h>
+#include <host_cdc.h>
+#include <host_time.h>
+#include <harp_frames.h>
+#include <harp_checks.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Checks the on-device request-to-reply latency histogram in
+// R_REPLY_LATENCY: requests are timed from when their first byte is read
+// from the serial port, so a request split across reads or left waiting
+// behind others lands in a later bin.
+// Exits with a nonzero status if any check fails.
+
+HarpCApp& app = init_check_app("Host Latency Check");
+
+typedef std::vector<uint32_t> bins_t;
+
+/**
+ * \brief send a request and call run() until its reply arrives.
+ * \returns the reply's payload, or an empty vector if none arrived.
+ */
+std::vector<uint8_t> round_trip(const std::vector<uint8_t>& request,
+                                msg_type_t reply_type)
+{
+    std::vector<uint8_t> reply;
+    host_cdc_write(request.data(), request.size());
+    for (size_t tries = 0; tries < 64; ++tries)
+    {
+        app.run();
+        if (!read_reply(reply))
+            continue;
+        if (!checksum_ok(reply) || reply[0] != reply_type
+            || reply[2] != request[2])
+            break;
+        // Payload follows the header and the 6-byte timestamp.
+        return std::vector<uint8_t>(reply.begin() + 11, reply.end() - 1);
+    }
+    return {};
+}
+
+bins_t read_bins()
+{
+    std::vector<uint8_t> payload = round_trip(
+        make_request(READ, REPLY_LATENCY, U32), READ);
+    bins_t bins(REPLY_LATENCY_BIN_COUNT);
+    if (payload.size() == bins.size() * sizeof(uint32_t))
+        memcpy(bins.data(), payload.data(), payload.size());
+    else
+        expect(false, "R_REPLY_LATENCY carries every bin");
+    return bins;
+}
+
+void reset_bins()
+{
+    uint32_t zeros[REPLY_LATENCY_BIN_COUNT] = {};
+    expect(!round_trip(make_request(WRITE, REPLY_LATENCY, U32, zeros,
+                                    sizeof(zeros)), WRITE).empty(),
+           "writing R_REPLY_LATENCY resets it");
+}
+
+void print_bins(const char* name, const bins_t& bins)
+{
+    printf("case=%s bins=", name);
+    for (uint32_t count: bins)
+        printf("%u,", count);
+    printf("\n");
+}
+
+int main()
+{
+    host_time_set_manual(true);
+    host_time_set_us(1'000'000'000ULL);
+    // Settle into ACTIVE mode with heartbeats disabled so that background
+    // events do not interleave with replies.
+    for (size_t i = 0; i < 8; ++i)
+        app.run();
+    uint8_t op_ctrl = ACTIVE;
+    round_trip(make_request(WRITE, OPERATION_CTRL, U8, &op_ctrl, 1), WRITE);
+    std::vector<uint8_t> drain;
+    while (read_reply(drain)){}
+
+    reset_bins();
+    bins_t bins = read_bins();
+    expect(bins == bins_t(REPLY_LATENCY_BIN_COUNT, 0),
+           "the histogram is empty after a reset");
+
+    // Requests that arrive whole are answered within the same run().
+    for (size_t i = 0; i < 5; ++i)
+        round_trip(make_request(READ, WHO_AM_I, U16), READ);
+    bins = read_bins();
+    print_bins("immediate", bins);
+    // The first read_bins() after the reset counts too.
+    expect(bins[0] == 5 + 1, "immediate replies land in bin 0");
+
+    // A request split across two reads is timed from its first byte.
+    reset_bins();
+    std::vector<uint8_t> request = make_request(READ, WHO_AM_I, U16);
+    host_cdc_write(request.data(), 3);
+    app.run();
+    host_time_advance_us(700);
+    host_cdc_write(request.data() + 3, request.size() - 3);
+    app.run();
+    while (read_reply(drain)){}
+    bins = read_bins();
+    print_bins("split", bins);
+    expect(bins[9] == 1, "a 700[us] wait lands in [512, 1024)[us]");
+
+    // Requests that arrive together but wait behind each other.
+    reset_bins();
+    HarpCore::set_max_msgs_per_run(1);
+    std::vector<uint8_t> burst;
+    for (size_t i = 0; i < 3; ++i)
+        burst.insert(burst.end(), request.begin(), request.end());
+    host_cdc_write(burst.data(), burst.size());
+    for (size_t i = 0; i < 3; ++i)
+    {
+        app.run();
+        host_time_advance_us(100);
+    }
+    while (read_reply(drain)){}
+    HarpCore::set_max_msgs_per_run(MAX_MSGS_PER_RUN);
+    bins = read_bins();
+    print_bins("burst", bins);
+    expect(bins[0] == 1 && bins[6] == 1 && bins[7] == 1,
+           "queued requests are timed from their arrival");
+
+    host_time_set_manual(false);
+    return report_checks("Reply latencies are binned from the first byte "
+                         "read.");
+}
@@ -0,0 +1,226 @@
+#include <check_app.h>
+#include <host_cdc.h>
+#include <host_time.h>
+#include <harp_frames.h>
+#include <harp_checks.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Checks the SPEED op mode: the selected registers are sent as events at the
+// configured rate with one timestamp per batch, heartbeats stop, missed
+// periods are skipped, a PC that stops reading costs dropped (and counted)
+// samples rather than time, and losing the PC drops back to STANDBY.
+// Exits with a nonzero status if any check fails.
+
+#pragma pack(push, 1)
+struct app_regs_t
+{
+    volatile uint16_t sensor;   // app register 0
+    volatile uint32_t counter;  // app register 1. Increments every run().
+    volatile uint8_t trace[246]; // app register 2. Too large to stream.
+} app_regs;
+#pragma pack(pop)
+
+const size_t reg_count = 3;
+
+constexpr RegLayout app_reg_layouts[reg_count]
+{
+    REG_LAYOUT(app_regs_t, sensor),
+    REG_LAYOUT(app_regs_t, counter),
+    REG_LAYOUT(app_regs_t, trace),
+};
+
+RegFnPair reg_handler_fns[reg_count]
+{
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_to_read_only_reg_error},
+    {&HarpCore::read_reg_generic, &HarpCore::write_to_read_only_reg_error},
+};
+
+void update_app_state()
+{app_regs.counter = app_regs.counter + 1;}
+
+HarpCApp& app = init_check_app("Host Speed Check", app_regs, app_reg_layouts,
+                               reg_handler_fns, update_app_state);
+
+const uint8_t sensor_address = APP_REG_START_ADDRESS;
+const uint8_t counter_address = APP_REG_START_ADDRESS + 1;
+const uint8_t trace_address = APP_REG_START_ADDRESS + 2;
+const uint32_t rate_hz = 1000;
+const uint64_t period_us = 1'000'000 / rate_hz;
+
+struct received_t
+{
+    std::vector<uint64_t> sensor_times_us; ///< Harp timestamps.
+    std::vector<uint64_t> counter_times_us;
+    uint32_t last_counter = 0;
+    uint32_t heartbeats = 0;
+    uint32_t other = 0;
+    uint32_t bad = 0;
+};
+
+/**
+ * \brief sort everything the device has sent into \p received.
+ */
+void collect(received_t& received)
+{
+    std::vector<uint8_t> frame;
+    while (read_reply(frame))
+    {
+        if (!checksum_ok(frame))
+        {
+            ++received.bad;
+            continue;
+        }
+        uint32_t seconds;
+        uint16_t micros;
+        memcpy(&seconds, &frame[5], sizeof(seconds));
+        memcpy(&micros, &frame[9], sizeof(micros));
+        uint64_t time_us = uint64_t(seconds) * 1'000'000
+                           + uint64_t(micros) * 32;
+        if (frame[0] == EVENT && frame[2] == sensor_address)
+            received.sensor_times_us.push_back(time_us);
+        else if (frame[0] == EVENT && frame[2] == counter_address)
+        {
+            received.counter_times_us.push_back(time_us);
+            memcpy(&received.last_counter, &frame[11],
+                   sizeof(received.last_counter));
+        }
+        else if (frame[0] == EVENT && frame[2] == TIMESTAMP_SECOND)
+            ++received.heartbeats;
+        else
+            ++received.other;
+    }
+}
+
+/**
+ * \brief advance the time by \p step_us and call run() \p count times.
+ */
+void run_for(uint32_t count, uint64_t step_us, received_t& received)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        host_time_advance_us(step_us);
+        app.run();
+        collect(received);
+    }
+}
+
+/**
+ * \brief call run() without advancing the time until what the device has
+ *  already sent arrives, and discard it.
+ */
+void settle()
+{
+    received_t discarded;
+    run_for(8, 0, discarded);
+}
+
+void write_op_mode(uint8_t op_ctrl)
+{
+    std::vector<uint8_t> request = make_request(WRITE, OPERATION_CTRL, U8,
+                                                &op_ctrl, 1);
+    host_cdc_write(request.data(), request.size());
+    app.run();
+}
+
+int main()
+{
+    host_time_set_manual(true);
+    host_time_set_us(1'000'000'000ULL);
+    for (size_t i = 0; i < 8; ++i)
+        app.run();
+    const uint8_t streamed[] = {sensor_address, counter_address};
+    uint8_t too_many[SPEED_STREAM_MAX_REGS + 1] = {};
+    expect(!HarpCore::set_speed_stream(too_many, sizeof(too_many), rate_hz),
+           "too many streamed registers are refused");
+    const uint8_t too_large[] = {sensor_address, trace_address};
+    expect(!HarpCore::set_speed_stream(too_large, sizeof(too_large), rate_hz),
+           "registers too large for one message are refused");
+    expect(HarpCore::set_speed_stream(streamed, sizeof(streamed), rate_hz),
+           "registers can be streamed");
+    app_regs.sensor = 0xBEEF;
+
+    // Heartbeats enabled, but SPEED sends none.
+    write_op_mode(SPEED | (1u << ALIVE_EN_OFFSET));
+    received_t received;
+    collect(received);
+    expect(HarpCore::get_op_mode() == SPEED, "the PC can enter SPEED");
+    expect(HarpCore::events_enabled(), "events are enabled in SPEED");
+    const uint32_t batches = 2500; // crosses two whole Harp seconds.
+    run_for(batches, period_us, received);
+    printf("case=stream sensor=%zu counter=%zu heartbeats=%u bad=%u\n",
+           received.sensor_times_us.size(), received.counter_times_us.size(),
+           received.heartbeats, received.bad);
+    expect(received.bad == 0, "every streamed message is whole");
+    expect(received.sensor_times_us.size() == batches
+           && received.counter_times_us.size() == batches,
+           "every register is sent once per period");
+    expect(received.heartbeats == 0, "SPEED sends no heartbeats");
+    expect(received.sensor_times_us == received.counter_times_us,
+           "each batch shares one timestamp");
+    bool periodic = true;
+    for (size_t i = 1; i < received.sensor_times_us.size(); ++i)
+    {
+        int64_t delta_us = int64_t(received.sensor_times_us[i]
+                                   - received.sensor_times_us[i - 1]);
+        periodic &= (delta_us >= int64_t(period_us) - 32)
+                    && (delta_us <= int64_t(period_us) + 32);
+    }
+    expect(periodic, "batches are one period apart");
+    // Only the last batch or two may still be on their way.
+    expect(app_regs.counter - received.last_counter <= 2,
+           "batches carry the current values");
+
+    // Periods missed while run() was busy are skipped, not caught up on.
+    settle();
+    received = received_t{};
+    run_for(1, 20 * period_us, received);
+    run_for(1, period_us / 2, received);
+    printf("case=late sensor=%zu\n", received.sensor_times_us.size());
+    expect(received.sensor_times_us.size() == 1,
+           "a late run() sends one batch");
+
+    // A PC that stops reading: samples are dropped and counted without
+    // blocking run().
+    host_cdc_set_tx_stalled(true);
+    uint32_t drops_before = HarpCore::tx_drop_count(sensor_address);
+    auto start = std::chrono::steady_clock::now();
+    run_for(200, period_us, received);
+    uint64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    host_cdc_set_tx_stalled(false);
+    uint32_t drops = HarpCore::tx_drop_count(sensor_address) - drops_before;
+    printf("case=stalled drops=%u elapsed_us=%llu\n", drops,
+           (unsigned long long)elapsed_us);
+    expect(drops > 100, "samples that do not fit are dropped and counted");
+    expect(elapsed_us < TX_STALL_TIMEOUT_US,
+           "streaming never waits on the TX FIFO");
+    settle();
+    received = received_t{};
+    run_for(16, period_us, received);
+    expect(received.bad == 0 && !received.sensor_times_us.empty(),
+           "streaming resumes whole after a stall");
+
+    // Losing the PC drops back to STANDBY after the usual timeout.
+    host_cdc_set_connected(false);
+    run_for(NO_PC_INTERVAL_US / (10 * period_us) + 10, 10 * period_us,
+            received);
+    expect(HarpCore::get_op_mode() == STANDBY,
+           "SPEED drops to STANDBY without a PC");
+    host_cdc_set_connected(true);
+    app.run();
+
+    // Leaving SPEED stops the stream.
+    write_op_mode(SPEED);
+    write_op_mode(ACTIVE);
+    settle();
+    received = received_t{};
+    run_for(100, period_us, received);
+    expect(received.sensor_times_us.empty(), "ACTIVE does not stream");
+
+    host_time_set_manual(false);
+    return report_checks("SPEED mode streams the selected registers.");
+}
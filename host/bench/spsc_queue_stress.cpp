@@ -0,0 +1,81 @@
+#include <spsc_queue.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+// Two-thread stress test of the lock-free queue that links the cores in
+// dual-core mode. The producer fills each slot with a sequence number and a
+// pattern derived from it. The consumer checks that every slot arrives
+// exactly once, in order, and intact. Exits with a nonzero status on the
+// first mismatch.
+
+struct slot_t
+{
+    uint32_t sequence;
+    uint8_t pattern[60];
+};
+
+SpscQueue<slot_t, 8> queue;
+
+void produce(uint32_t item_count)
+{
+    for (uint32_t sequence = 0; sequence < item_count; ++sequence)
+    {
+        slot_t* slot;
+        while ((slot = queue.back()) == nullptr)
+            std::this_thread::yield();
+        slot->sequence = sequence;
+        memset(slot->pattern, uint8_t(sequence * 7), sizeof(slot->pattern));
+        queue.push();
+    }
+}
+
+bool consume(uint32_t item_count)
+{
+    for (uint32_t sequence = 0; sequence < item_count; ++sequence)
+    {
+        slot_t* slot;
+        while ((slot = queue.front()) == nullptr)
+            std::this_thread::yield();
+        if (slot->sequence != sequence)
+        {
+            fprintf(stderr, "expected item %u but got %u.\n", sequence,
+                    slot->sequence);
+            return false;
+        }
+        for (uint8_t byte: slot->pattern)
+        {
+            if (byte != uint8_t(sequence * 7))
+            {
+                fprintf(stderr, "item %u is corrupted.\n", sequence);
+                return false;
+            }
+        }
+        queue.pop();
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t item_count = 10'000'000;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--items") == 0 && (i + 1) < argc)
+            item_count = strtoul(argv[++i], nullptr, 10);
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer(produce, item_count);
+    bool ok = consume(item_count);
+    producer.join();
+    auto stop = std::chrono::steady_clock::now();
+    if (!ok)
+        return EXIT_FAILURE;
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        stop - start).count();
+    printf("case=spsc_queue_stress items=%u ns_per_item=%.1f\n", item_count,
+           double(ns) / double(item_count));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+#include <harp_sync_decoder.h>
+#include <harp_synchronizer.h>
+#include <harp_checks.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Checks the sync stream decoder shared by the synchronizer's uart and PIO
+// backends: clean packets, noise and broken headers before them, header
+// bytes within the timestamp, and the timestamp of the final byte.
+// Exits with a nonzero status if any check fails.
+
+/**
+ * \brief the sync packet that marks the Harp second \p sec.
+ */
+std::vector<uint8_t> packet(uint32_t sec)
+{
+    sec -= 1; // The packet encodes the previous second.
+    return {0xAA, 0xAF, uint8_t(sec), uint8_t(sec >> 8), uint8_t(sec >> 16),
+            uint8_t(sec >> 24)};
+}
+
+struct Decoded
+{
+    uint32_t packet_count = 0;
+    uint32_t malformed_count = 0;
+    uint32_t seconds = 0;
+    uint32_t final_byte_time_us = 0;
+};
+
+/**
+ * \brief push \p bytes sent back-to-back, with the first start bit at
+ *  \p start_us, and timestamp each byte at its start bit (like the PIO
+ *  backend).
+ */
+Decoded push_all(HarpSyncDecoder& decoder, const std::vector<uint8_t>& bytes,
+                 uint32_t start_us)
+{
+    Decoded decoded;
+    for (size_t i = 0; i < bytes.size(); ++i)
+    {
+        uint32_t byte_start_us = start_us + uint32_t(i) * 10 * HARP_SYNC_BIT_US;
+        switch (decoder.push(bytes[i], byte_start_us))
+        {
+            case HarpSyncDecoder::PACKET:
+                ++decoded.packet_count;
+                decoded.seconds = decoder.seconds();
+                decoded.final_byte_time_us = decoder.final_byte_time_us();
+                break;
+            case HarpSyncDecoder::MALFORMED:
+                ++decoded.malformed_count;
+                break;
+            default:
+                break;
+        }
+    }
+    return decoded;
+}
+
+std::vector<uint8_t> operator+(std::vector<uint8_t> a,
+                               const std::vector<uint8_t>& b)
+{
+    a.insert(a.end(), b.begin(), b.end());
+    return a;
+}
+
+int main()
+{
+    const uint32_t sec = 3'900'000'000UL;
+    // A clean packet, timestamped at its final byte's start bit.
+    HarpSyncDecoder decoder;
+    Decoded decoded = push_all(decoder, packet(sec), 1000);
+    expect(decoded.packet_count == 1 && decoded.malformed_count == 0,
+           "a clean packet decodes");
+    expect(decoded.seconds == sec, "the packet marks the next second");
+    expect(decoded.final_byte_time_us == 1000 + 5 * 10 * HARP_SYNC_BIT_US,
+           "the final byte's start bit is the packet's timestamp");
+    expect(decoder.state() == HarpSyncDecoder::RECEIVE_HEADER_0,
+           "the decoder is idle after a packet");
+    // The final byte's start bit and the packet's end give the same time.
+    expect(HarpSyncDecoder::harp_time_us(sec, HARP_SYNC_FINAL_BYTE_US)
+           + 10 * HARP_SYNC_BIT_US
+           == HarpSyncDecoder::harp_time_us(sec, HARP_SYNC_PACKET_END_US),
+           "final byte and packet end offsets agree");
+
+    // Noise, broken headers, and a repeated 0xAA before a packet.
+    decoded = push_all(decoder, std::vector<uint8_t>{0x00, 0xAF, 0xAA, 0x12,
+                                                     0xAA, 0xAA}
+                                + packet(sec + 1), 0);
+    expect(decoded.packet_count == 1 && decoded.seconds == sec + 1,
+           "a packet decodes after noise");
+    expect(decoded.malformed_count == 3, "broken headers count as malformed");
+
+    // Header bytes within the timestamp belong to the timestamp.
+    uint32_t tricky_sec = 0xAFAAAFAAUL + 1;
+    decoded = push_all(decoder, packet(tricky_sec) + packet(tricky_sec + 1),
+                       0);
+    expect(decoded.packet_count == 2 && decoded.seconds == tricky_sec + 1,
+           "header bytes within timestamps decode");
+
+    // A partial packet is dropped by reset().
+    push_all(decoder, {0xAA, 0xAF, 0x01}, 0);
+    decoder.reset();
+    decoded = push_all(decoder, packet(sec + 2), 0);
+    expect(decoded.packet_count == 1 && decoded.seconds == sec + 2,
+           "reset drops a partial packet");
+
+    // 32-bit timestamps widen across timer wraparound.
+    const uint64_t wrap = 1ULL << 32;
+    expect(HarpSyncDecoder::widen_time_us(0xFFFFFF00UL, 5 * wrap + 0x10)
+           == 4 * wrap + 0xFFFFFF00ULL, "timestamps widen across wraparound");
+    expect(HarpSyncDecoder::widen_time_us(0x10, 5 * wrap + 0x10)
+           == 5 * wrap + 0x10, "timestamps widen at the current time");
+
+    return report_checks("Sync decoder checks passed.");
+}
@@ -0,0 +1,227 @@
+#include <harp_synchronizer.h>
+#include <host_time.h>
+#include <host_uart.h>
+#include <host_gpio.h>
+#include <harp_checks.h>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// Feeds the synchronizer synthetic sync packets from a Harp clock while the
+// system clock runs fast or slow by a fixed drift, with random interrupt
+// latency (jitter) on each packet. Samples the Harp time throughout each
+// second and checks that, in SLEW mode, it never runs backwards and stays
+// within a few [us] of the true Harp time once settled. In STEP mode, which
+// also learns the frequency, it stays within a second's drift.
+// Some cases also stop the packets for a while and check that the
+// synchronizer reports holdover, that its error estimate bounds the actual
+// error, and that it locks again (without running backwards in SLEW mode).
+// Events timestamped shortly before a packet are converted after it, as
+// queued events are, and must land just as close to the true Harp time.
+// In PER_PACKET receive mode, the packet's first start bit is timestamped
+// exactly, so the interrupt latency (jitter) should not add error.
+// Exits with a nonzero status if any case fails.
+
+struct Scenario
+{
+    const char* name;
+    HarpSynchronizer::ClockMode mode;
+    int32_t drift_ppm; // system clock error relative to the Harp clock.
+    uint32_t jitter_us; // max interrupt latency on each sync packet.
+    uint32_t drop_every; // drop every nth packet (0 to drop none).
+    uint32_t max_error_us; // allowed error once settled (0 to not check).
+    uint32_t holdover_from; // second when packets stop (0 for never).
+    uint32_t holdover_seconds; // number of seconds without packets.
+    HarpSynchronizer::RxMode rx_mode = HarpSynchronizer::PER_BYTE;
+};
+
+const Scenario scenarios[]
+{
+    {"step_drift30", HarpSynchronizer::STEP, 30, 0, 0, 31, 0, 0},
+    {"slew_drift0", HarpSynchronizer::SLEW, 0, 0, 0, 1, 0, 0},
+    {"slew_drift30", HarpSynchronizer::SLEW, 30, 0, 0, 2, 0, 0},
+    {"slew_drift-50_jitter4", HarpSynchronizer::SLEW, -50, 4, 0, 5, 0, 0},
+    {"slew_drift100_jitter8", HarpSynchronizer::SLEW, 100, 8, 0, 9, 0, 0},
+    {"slew_drift-200_jitter8_drops", HarpSynchronizer::SLEW, -200, 8, 7, 9,
+     0, 0},
+    {"step_drift-80_holdover60", HarpSynchronizer::STEP, -80, 0, 0, 81, 40, 60},
+    {"slew_drift30_jitter4_holdover60", HarpSynchronizer::SLEW, 30, 4, 0, 5,
+     40, 60},
+    {"slew_drift-150_jitter8_holdover300", HarpSynchronizer::SLEW, -150, 8, 0,
+     9, 40, 300},
+    {"slew_drift100_jitter200_per_packet", HarpSynchronizer::SLEW, 100, 200, 0,
+     4, 0, 0, HarpSynchronizer::PER_PACKET},
+    {"slew_drift80_jitter200_drops_per_packet", HarpSynchronizer::SLEW, 80,
+     200, 7, 3, 0, 0, HarpSynchronizer::PER_PACKET},
+};
+
+const uint32_t run_seconds = 120;
+const uint32_t settle_seconds = 30;
+const uint32_t sample_period_us = 997;
+const uint32_t early_event_us = 100; // event time before each packet.
+const uint8_t rx_pin = 5;
+
+// The Harp clock starts at a realistic time; each case starts far enough
+// from the last so that its first packet steps the clock.
+uint64_t harp_start_us = 3'900'000'000'000'000ULL;
+
+std::mt19937 rng(1234);
+
+bool run(const Scenario& scenario)
+{
+    HarpSynchronizer::set_clock_mode(scenario.mode);
+    HarpSynchronizer::set_rx_mode(scenario.rx_mode);
+    harp_start_us += 1'000'000'000;
+    // System time as a function of true Harp time.
+    auto system_us = [&](uint64_t harp_us)
+    {
+        int64_t elapsed_us = int64_t(harp_us - harp_start_us);
+        return uint64_t(1'000'000'000'000LL + elapsed_us
+                        + elapsed_us * scenario.drift_ppm / 1'000'000);
+    };
+    std::uniform_int_distribution<uint32_t> jitter(0, scenario.jitter_us);
+    uint64_t prev_read_us = 0;
+    uint32_t backward_count = 0;
+    int64_t max_error_us = 0;
+    int64_t max_holdover_error_us = 0;
+    uint32_t max_estimated_error_us = 0;
+    uint64_t last_packet_harp_us = 0;
+    bool passed = true;
+    uint32_t holdover_to = scenario.holdover_from + scenario.holdover_seconds;
+    for (uint32_t i = 1; i <= run_seconds + scenario.holdover_seconds; ++i)
+    {
+        uint32_t sec = uint32_t(harp_start_us / 1'000'000) + i;
+        uint64_t packet_harp_us = uint64_t(sec) * 1'000'000
+                                  - HARP_SYNC_OFFSET_US;
+        bool in_holdover = (i >= scenario.holdover_from && i < holdover_to);
+        bool settled = (i > settle_seconds)
+                       && (scenario.holdover_from == 0
+                           || i < scenario.holdover_from
+                           || i >= holdover_to + settle_seconds);
+        if (!in_holdover
+            && (scenario.drop_every == 0 || (i % scenario.drop_every) != 0))
+        {
+            if (scenario.rx_mode == HarpSynchronizer::PER_PACKET)
+            {
+                // The packet starts with a falling edge and raises the RX
+                // timeout interrupt after it ends.
+                uint64_t end_harp_us = uint64_t(sec) * 1'000'000
+                                       - HARP_SYNC_PACKET_END_US;
+                host_time_set_us(system_us(end_harp_us)
+                                 - HARP_SYNC_PACKET_US);
+                host_gpio_edge(rx_pin, GPIO_IRQ_EDGE_FALL);
+                host_time_set_us(system_us(end_harp_us
+                                           + HARP_SYNC_RX_TIMEOUT_US
+                                           + jitter(rng)));
+            }
+            else
+                host_time_set_us(system_us(packet_harp_us + jitter(rng)));
+            // Also sample right before and after the correction.
+            uint64_t read_us = HarpSynchronizer::time_us_64();
+            if (i > 1 && read_us <= prev_read_us)
+                ++backward_count;
+            inject_sync_packet(sec);
+            last_packet_harp_us = packet_harp_us;
+            prev_read_us = read_us;
+            read_us = HarpSynchronizer::time_us_64();
+            if (i > 1 && read_us < prev_read_us)
+                ++backward_count;
+            prev_read_us = read_us;
+            // Convert an event from before the packet's anchor point.
+            uint64_t event_harp_us = packet_harp_us - early_event_us;
+            uint64_t event_us = HarpSynchronizer::system_to_harp_us_64(
+                system_us(event_harp_us));
+            if (HarpSynchronizer::system_to_harp_us_32(
+                    uint32_t(system_us(event_harp_us))) != uint32_t(event_us))
+            {
+                fprintf(stderr, "%s: 32-bit event time mismatch at second "
+                        "%u.\n", scenario.name, i);
+                passed = false;
+            }
+            int64_t event_error_us = int64_t(event_us - event_harp_us);
+            event_error_us = (event_error_us < 0)? -event_error_us:
+                                                   event_error_us;
+            if (settled && event_error_us > max_error_us)
+                max_error_us = event_error_us;
+            if (HarpSynchronizer::status() != HarpSynchronizer::LOCKED)
+            {
+                fprintf(stderr, "%s: not locked after packet %u.\n",
+                        scenario.name, i);
+                passed = false;
+            }
+        }
+        // Sample until the next packet.
+        for (uint64_t harp_us = packet_harp_us + sample_period_us;
+             harp_us < packet_harp_us + 1'000'000;
+             harp_us += sample_period_us)
+        {
+            host_time_set_us(system_us(harp_us));
+            uint64_t read_us = HarpSynchronizer::time_us_64();
+            if (HarpSynchronizer::time_us_32() != uint32_t(read_us))
+            {
+                fprintf(stderr, "%s: 32-bit time mismatch at second %u.\n",
+                        scenario.name, i);
+                passed = false;
+            }
+            if (i > 1 && read_us <= prev_read_us)
+                ++backward_count;
+            prev_read_us = read_us;
+            int64_t error_us = int64_t(read_us - harp_us);
+            error_us = (error_us < 0)? -error_us: error_us;
+            if (settled && error_us > max_error_us)
+                max_error_us = error_us;
+            // Allow some margin for drift and jitter.
+            if (!in_holdover || (harp_us - last_packet_harp_us)
+                                <= HARP_SYNC_HOLDOVER_TIMEOUT_US + 1000)
+                continue;
+            // Holdover checks.
+            uint32_t estimated_error_us =
+                HarpSynchronizer::estimated_error_us();
+            if (HarpSynchronizer::status() != HarpSynchronizer::HOLDOVER
+                || error_us > estimated_error_us)
+            {
+                fprintf(stderr, "%s: in second %u of holdover, status is %d "
+                        "and the error of %lld[us] exceeds the estimate of "
+                        "%u[us].\n", scenario.name, i - scenario.holdover_from,
+                        HarpSynchronizer::status(), (long long)error_us,
+                        estimated_error_us);
+                passed = false;
+            }
+            if (error_us > max_holdover_error_us)
+                max_holdover_error_us = error_us;
+            if (estimated_error_us > max_estimated_error_us)
+                max_estimated_error_us = estimated_error_us;
+        }
+    }
+    printf("case=%s max_error_us=%lld backward_count=%u", scenario.name,
+           (long long)max_error_us, backward_count);
+    if (scenario.holdover_from)
+        printf(" max_holdover_error_us=%lld max_estimated_error_us=%u",
+               (long long)max_holdover_error_us, max_estimated_error_us);
+    printf("\n");
+    if (scenario.mode == HarpSynchronizer::SLEW && backward_count != 0)
+    {
+        fprintf(stderr, "%s: Harp time ran backwards %u times.\n",
+                scenario.name, backward_count);
+        passed = false;
+    }
+    if (scenario.max_error_us && max_error_us > scenario.max_error_us)
+    {
+        fprintf(stderr, "%s: max error of %lld[us] exceeds %u[us].\n",
+                scenario.name, (long long)max_error_us,
+                scenario.max_error_us);
+        passed = false;
+    }
+    return passed;
+}
+
+int main()
+{
+    host_time_set_manual(true);
+    HarpSynchronizer::init(uart1, rx_pin);
+    bool passed = true;
+    for (const Scenario& scenario: scenarios)
+        passed &= run(scenario);
+    host_time_set_manual(false);
+    return passed? EXIT_SUCCESS: EXIT_FAILURE;
+}
@@ -0,0 +1,168 @@
+#include <check_app.h>
+#include <harp_synchronizer.h>
+#include <host_cdc.h>
+#include <host_time.h>
+#include <host_uart.h>
+#include <harp_frames.h>
+#include <harp_checks.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Checks the sync telemetry registers over the (host) serial link: their
+// values without a synchronizer, after a run of clean sync packets, with
+// dropped and malformed packets, during holdover, and as periodic events.
+// Exits with a nonzero status if any check fails.
+
+HarpCApp& app = init_check_app("Host Sync Telemetry");
+
+const uint64_t harp_start_us = 3'900'000'000'000'000ULL;
+const uint64_t system_start_us = 1'000'000'000ULL;
+
+/**
+ * \brief deliver the ith sync packet after the start, \p late_us late.
+ */
+void deliver_packet(uint32_t i, uint32_t late_us = 0)
+{
+    uint32_t sec = uint32_t(harp_start_us / 1'000'000) + i;
+    uint64_t packet_harp_us = uint64_t(sec) * 1'000'000 - HARP_SYNC_OFFSET_US;
+    host_time_set_us(system_start_us + (packet_harp_us - harp_start_us)
+                     + late_us);
+    inject_sync_packet(sec);
+}
+
+/**
+ * \brief send a request and call run() until its reply arrives.
+ * \returns the reply's payload, or an empty vector if none arrived.
+ */
+std::vector<uint8_t> round_trip(const std::vector<uint8_t>& request,
+                                msg_type_t reply_type)
+{
+    std::vector<uint8_t> reply;
+    host_cdc_write(request.data(), request.size());
+    for (size_t tries = 0; tries < 64; ++tries)
+    {
+        app.run();
+        if (!read_reply(reply))
+            continue;
+        if (!checksum_ok(reply) || reply[0] != reply_type
+            || reply[2] != request[2])
+            break;
+        // Payload follows the header and the 6-byte timestamp.
+        return std::vector<uint8_t>(reply.begin() + 11, reply.end() - 1);
+    }
+    return {};
+}
+
+template <typename T>
+T read_sync_reg(uint8_t address, reg_type_t payload_type, size_t index = 0)
+{
+    std::vector<uint8_t> payload = round_trip(
+        make_request(READ, address, payload_type), READ);
+    T value{};
+    if (payload.size() >= (index + 1) * sizeof(T))
+        memcpy(&value, payload.data() + index * sizeof(T), sizeof(T));
+    else
+        expect(false, "read reply carries the register payload");
+    return value;
+}
+
+int main()
+{
+    host_time_set_manual(true);
+    host_time_set_us(system_start_us);
+    // Settle into ACTIVE mode with heartbeats disabled so that background
+    // events do not interleave with replies.
+    for (size_t i = 0; i < 8; ++i)
+        app.run();
+    uint8_t op_ctrl = ACTIVE;
+    round_trip(make_request(WRITE, OPERATION_CTRL, U8, &op_ctrl, 1), WRITE);
+    std::vector<uint8_t> drain;
+    while (read_reply(drain)){}
+
+    // Without a synchronizer.
+    expect(read_sync_reg<uint8_t>(SYNC_STATUS, U8)
+           == HarpSynchronizer::UNSYNCED, "UNSYNCED without a synchronizer");
+    expect(read_sync_reg<uint32_t>(SYNC_ERROR_ESTIMATE, U32) == UINT32_MAX,
+           "no error estimate without a synchronizer");
+    uint8_t status = HarpSynchronizer::LOCKED;
+    expect(!round_trip(make_request(WRITE, SYNC_STATUS, U8, &status, 1),
+                       WRITE_ERROR).empty(),
+           "writing a read-only sync register is an error");
+
+    // Clean packets with a few [us] of alternating latency.
+    HarpSynchronizer& sync = HarpSynchronizer::init(uart1, 5);
+    HarpCore::set_synchronizer(&sync);
+    HarpSynchronizer::set_clock_mode(HarpSynchronizer::SLEW);
+    uint32_t i = 1;
+    for (; i <= 40; ++i)
+        deliver_packet(i, (i & 1)? 4: 0);
+    HarpSynchronizer::SyncStats stats = HarpSynchronizer::stats();
+    expect(read_sync_reg<uint8_t>(SYNC_STATUS, U8)
+           == HarpSynchronizer::LOCKED, "LOCKED after sync packets");
+    expect(read_sync_reg<uint32_t>(SYNC_PACKETS, U32, 0) == 40,
+           "all packets counted");
+    expect(read_sync_reg<uint32_t>(SYNC_PACKETS, U32, 1) == 0,
+           "no packets missed");
+    int32_t last_us = read_sync_reg<int32_t>(SYNC_CORRECTION, S32, 0);
+    int32_t min_us = read_sync_reg<int32_t>(SYNC_CORRECTION, S32, 1);
+    int32_t max_us = read_sync_reg<int32_t>(SYNC_CORRECTION, S32, 2);
+    int32_t mean_us = read_sync_reg<int32_t>(SYNC_CORRECTION, S32, 3);
+    uint32_t jitter_us = read_sync_reg<uint32_t>(SYNC_JITTER, U32);
+    expect(last_us == stats.last_error_us && min_us == stats.min_error_us
+           && max_us == stats.max_error_us && mean_us == stats.mean_error_us
+           && jitter_us == stats.jitter_us,
+           "correction registers match the synchronizer's statistics");
+    expect(min_us <= mean_us && mean_us <= max_us && min_us <= last_us
+           && last_us <= max_us, "min <= mean, last <= max");
+    expect(min_us < 0 && max_us > 0 && max_us - min_us <= 8,
+           "corrections span the latency");
+    expect(jitter_us > 0 && jitter_us <= 8, "jitter reflects the latency");
+    expect(read_sync_reg<uint32_t>(SYNC_TIME_SINCE_LOCK, U32) == 0,
+           "time since lock is current");
+
+    // Drop two packets and corrupt four header bytes.
+    i += 2;
+    uint8_t bad_headers[] {0xAA, 0x00, 0xAA, 0xAA, 0xAA, 0x55};
+    host_uart_inject(uart1, bad_headers, sizeof(bad_headers));
+    deliver_packet(i++);
+    expect(read_sync_reg<uint32_t>(SYNC_PACKETS, U32, 0) == 41,
+           "received packets counted");
+    expect(read_sync_reg<uint32_t>(SYNC_PACKETS, U32, 1) == 2,
+           "missed packets counted");
+    expect(read_sync_reg<uint32_t>(SYNC_PACKETS, U32, 2) == 4,
+           "malformed packets counted");
+
+    // Holdover.
+    host_time_advance_us(2'500'000);
+    expect(read_sync_reg<uint8_t>(SYNC_STATUS, U8)
+           == HarpSynchronizer::HOLDOVER, "HOLDOVER without sync packets");
+    expect(read_sync_reg<uint32_t>(SYNC_TIME_SINCE_LOCK, U32) == 2500,
+           "time since lock counts up in holdover");
+
+    // Periodic events.
+    uint8_t period_s = 2;
+    round_trip(make_request(WRITE, SYNC_EVENT_PERIOD, U8, &period_s, 1),
+               WRITE);
+    uint32_t event_count = 0;
+    uint8_t next_address = SYNC_STATUS;
+    for (uint32_t second = 0; second < 4; ++second)
+    {
+        host_time_advance_us(1'000'000);
+        app.run();
+        std::vector<uint8_t> event;
+        while (read_reply(event))
+        {
+            expect(event[0] == EVENT && event[2] == next_address,
+                   "sync events arrive in register order");
+            next_address = (event[2] == SYNC_TIME_SINCE_LOCK)?
+                               SYNC_STATUS: event[2] + 1;
+            ++event_count;
+        }
+    }
+    expect(event_count == 2 * (SYNC_REG_COUNT - 1),
+           "one set of sync events per period");
+
+    host_time_set_manual(false);
+    return report_checks("Sync telemetry registers match the synchronizer.");
+}
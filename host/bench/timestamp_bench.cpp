@@ -0,0 +1,97 @@
+#include <harp_c_app.h>
+#include <host_time.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Microbenchmark of the timestamp registers computation. Each case advances
+// the (manual) system time by a fixed step and then updates the timestamp
+// registers, so the step selects the path taken:
+//  - same_second: compare and subtract against the cached second.
+//  - next_second: step the cached second forward by one.
+//  - reciprocal: recompute the second with a reciprocal multiply.
+//  - division_reference: the same work with a 64-bit division instead.
+// Every result is checked against a 64-bit division. Exits with a nonzero
+// status on the first mismatch.
+
+HarpCApp& app = HarpCApp::init(1234, 1, 0, 2, 2, 0, 3, 0, 0xCAFE,
+                               "Host Timestamp Bench", (const uint8_t*)"host",
+                               nullptr, (const RegLayout*)nullptr, nullptr, 0,
+                               nullptr, nullptr);
+
+volatile uint32_t sink_seconds;
+volatile uint16_t sink_micros;
+
+bool check(const char* name, size_t i)
+{
+    uint64_t harp_time_us = HarpCore::harp_time_us_64();
+    uint32_t seconds = uint32_t(harp_time_us / 1'000'000ULL);
+    uint16_t micros = uint16_t((harp_time_us % 1'000'000ULL) >> 5);
+    if (app.regs.R_TIMESTAMP_SECOND == seconds
+        && app.regs.R_TIMESTAMP_MICRO == micros)
+        return true;
+    fprintf(stderr, "%s: iteration %zu got %u.%u, expected %u.%u.\n", name, i,
+            app.regs.R_TIMESTAMP_SECOND, app.regs.R_TIMESTAMP_MICRO, seconds,
+            micros);
+    return false;
+}
+
+template <typename Fn>
+bool bench(const char* name, size_t iterations, uint64_t step_us, Fn fn)
+{
+    // Start just below a whole second at a realistic Harp time.
+    host_time_set_us(0);
+    HarpCore::set_harp_time_us_64(3'900'000'000'999'990ULL);
+    // Check a pass first so that timing excludes the reference division.
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        host_time_advance_us(step_us);
+        fn();
+        if (!check(name, i))
+            return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        host_time_advance_us(step_us);
+        fn();
+    }
+    auto stop = std::chrono::steady_clock::now();
+    uint64_t total_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        stop - start).count();
+    printf("case=%s n=%zu mean_ns=%.2f\n", name, iterations,
+           double(total_ns) / iterations);
+    return true;
+}
+
+void update_timestamp_regs()
+{HarpCore::harp_time_s();} // updates both timestamp registers.
+
+void update_timestamp_regs_by_division()
+{
+    uint64_t harp_time_us = HarpCore::harp_time_us_64();
+    sink_seconds = uint32_t(harp_time_us / 1'000'000ULL);
+    sink_micros = uint16_t((harp_time_us % 1'000'000ULL) >> 5);
+    // Keep the registers current for the check.
+    app.regs.R_TIMESTAMP_SECOND = sink_seconds;
+    app.regs.R_TIMESTAMP_MICRO = sink_micros;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t iterations = 10'000'000;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--iterations") == 0 && (i + 1) < argc)
+            iterations = strtoul(argv[++i], nullptr, 10);
+    }
+    host_time_set_manual(true);
+    bool passed = bench("same_second", iterations, 1, update_timestamp_regs)
+        && bench("next_second", iterations, 1'000'003, update_timestamp_regs)
+        && bench("reciprocal", iterations, 3'000'037, update_timestamp_regs)
+        && bench("division_reference", iterations, 3'000'037,
+                 update_timestamp_regs_by_division);
+    host_time_set_manual(false);
+    return passed? EXIT_SUCCESS: EXIT_FAILURE;
+}
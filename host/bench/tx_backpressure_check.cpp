@@ -0,0 +1,244 @@
+#include <check_app.h>
+#include <host_cdc.h>
+#include <harp_frames.h>
+#include <harp_checks.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+// Checks that replies larger than one USB packet are sent whole: bursts
+// that overrun the TX FIFO wait for room, and a PC that stops reading gets
+// whole messages dropped after a bounded wait, never partial ones. The
+// stall and drop counts are read back through R_TX_STATS. In dual-core
+// mode, core0 keeps running while core1 drops what it cannot send.
+// Runs on the host's clock so that the stall timeout can elapse.
+// Exits with a nonzero status if any check fails.
+
+#pragma pack(push, 1)
+struct app_regs_t
+{
+    volatile uint8_t blob[MAX_PACKET_SIZE - 10]; // app register 0. Largest
+                                                 // payload that fits.
+} app_regs;
+#pragma pack(pop)
+
+const size_t reg_count = 1;
+
+constexpr RegLayout app_reg_layouts[reg_count]
+{
+    REG_LAYOUT(app_regs_t, blob),
+};
+
+RegFnPair reg_handler_fns[reg_count]
+{
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+};
+
+HarpCApp& app = init_check_app("Host TX Check", app_regs, app_reg_layouts,
+                               reg_handler_fns);
+
+const uint16_t blob_frame_size = sizeof(app_regs.blob) + 12;
+
+bool dual_core = false; // Once set, another thread calls run() as core0.
+std::atomic<uint32_t> core0_run_count{0};
+
+/**
+ * \brief call run() (or wait, in dual-core mode) until \p count replies
+ *  arrive or too many calls pass.
+ * \returns the replies.
+ */
+std::vector<std::vector<uint8_t>> collect(size_t count)
+{
+    std::vector<std::vector<uint8_t>> replies;
+    std::vector<uint8_t> reply;
+    for (size_t tries = 0; tries < 64 * (count + 1); ++tries)
+    {
+        if (dual_core)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        else
+            app.run();
+        while (read_reply(reply))
+            replies.push_back(reply);
+        if (replies.size() >= count)
+            break;
+    }
+    return replies;
+}
+
+/**
+ * \brief true if \p reply is an intact READ reply of the blob register.
+ */
+bool is_blob_reply(const std::vector<uint8_t>& reply)
+{
+    return checksum_ok(reply) && reply.size() == blob_frame_size
+           && reply[0] == READ && reply[2] == APP_REG_START_ADDRESS
+           && !memcmp(&reply[11], (const void*)app_regs.blob,
+                      sizeof(app_regs.blob));
+}
+
+/**
+ * \brief read R_TX_STATS.
+ * \returns the stall count in \p stalls and the drop count in \p drops.
+ */
+void read_tx_stats(uint32_t& stalls, uint32_t& drops)
+{
+    std::vector<uint8_t> request = make_request(READ, TX_STATS, U32);
+    host_cdc_write(request.data(), request.size());
+    std::vector<std::vector<uint8_t>> replies = collect(1);
+    stalls = drops = UINT32_MAX;
+    if (replies.size() == 1 && checksum_ok(replies[0])
+        && replies[0][2] == TX_STATS && replies[0].size() == 12 + 8)
+    {
+        memcpy(&stalls, &replies[0][11], sizeof(stalls));
+        memcpy(&drops, &replies[0][15], sizeof(drops));
+    }
+    else
+        expect(false, "R_TX_STATS carries the stall and drop counts");
+}
+
+void reset_tx_stats()
+{
+    uint32_t zeros[2] = {};
+    std::vector<uint8_t> request = make_request(WRITE, TX_STATS, U32, zeros,
+                                                sizeof(zeros));
+    host_cdc_write(request.data(), request.size());
+    std::vector<std::vector<uint8_t>> replies = collect(1);
+    expect(replies.size() == 1 && replies[0][0] == WRITE,
+           "writing R_TX_STATS resets it");
+}
+
+/**
+ * \brief send \p count back-to-back reads of the blob register.
+ */
+void request_blobs(size_t count)
+{
+    std::vector<uint8_t> request = make_request(READ, APP_REG_START_ADDRESS,
+                                                U8);
+    std::vector<uint8_t> burst;
+    for (size_t i = 0; i < count; ++i)
+        burst.insert(burst.end(), request.begin(), request.end());
+    host_cdc_write(burst.data(), burst.size());
+}
+
+int main()
+{
+    for (size_t i = 0; i < sizeof(app_regs.blob); ++i)
+        app_regs.blob[i] = uint8_t(i * 7 + 1);
+    // Settle into ACTIVE mode.
+    for (size_t i = 0; i < 8; ++i)
+        app.run();
+    uint8_t op_ctrl = ACTIVE;
+    std::vector<uint8_t> request = make_request(WRITE, OPERATION_CTRL, U8,
+                                                &op_ctrl, 1);
+    host_cdc_write(request.data(), request.size());
+    collect(1);
+    reset_tx_stats();
+
+    // One max-size reply spans several USB packets.
+    uint32_t stalls, drops;
+    request_blobs(1);
+    std::vector<std::vector<uint8_t>> replies = collect(1);
+    expect(replies.size() == 1 && is_blob_reply(replies[0]),
+           "a max-size reply arrives whole");
+    read_tx_stats(stalls, drops);
+    printf("case=single stalls=%u drops=%u\n", stalls, drops);
+    expect(stalls == 0 && drops == 0, "one max-size reply fits the TX FIFO");
+
+    // A burst that overruns the TX FIFO waits for room instead of being cut.
+    const size_t burst_count = 8;
+    request_blobs(burst_count);
+    replies = collect(burst_count);
+    size_t intact = 0;
+    for (const std::vector<uint8_t>& reply: replies)
+        intact += is_blob_reply(reply);
+    read_tx_stats(stalls, drops);
+    printf("case=burst replies=%zu intact=%zu stalls=%u drops=%u\n",
+           replies.size(), intact, stalls, drops);
+    expect(replies.size() == burst_count && intact == burst_count,
+           "every reply of a burst arrives whole");
+    expect(stalls > 0 && drops == 0, "a burst stalls without dropping");
+
+    // A PC that stops reading: the FIFO fills, then messages are dropped
+    // after one bounded wait.
+    reset_tx_stats();
+    host_cdc_set_tx_stalled(true);
+    request_blobs(burst_count);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < 16; ++i)
+        app.run();
+    uint64_t elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    host_cdc_set_tx_stalled(false);
+    replies = collect(burst_count);
+    intact = 0;
+    for (const std::vector<uint8_t>& reply: replies)
+        intact += is_blob_reply(reply);
+    read_tx_stats(stalls, drops);
+    printf("case=stalled elapsed_us=%llu replies=%zu intact=%zu stalls=%u "
+           "drops=%u\n", (unsigned long long)elapsed_us, replies.size(),
+           intact, stalls, drops);
+    expect(elapsed_us >= TX_STALL_TIMEOUT_US,
+           "a stalled PC is waited on for the timeout");
+    expect(elapsed_us < 10 * TX_STALL_TIMEOUT_US,
+           "later messages are dropped without waiting again");
+    expect(intact == replies.size() && !replies.empty(),
+           "only whole messages are sent");
+    expect(drops > 0 && replies.size() + drops == burst_count,
+           "every message is either sent whole or counted as dropped");
+
+    // Once the PC reads again, messages flow again.
+    request_blobs(1);
+    replies = collect(1);
+    expect(replies.size() == 1 && is_blob_reply(replies[0]),
+           "replies resume after a stall");
+
+    // Dual-core: core1 sends what core0 replies. A PC that stops reading must
+    // not leave core0 waiting on a full queue for good.
+    HarpCore::launch_core1();
+    dual_core = true;
+    std::thread([]
+                {
+                    while (true)
+                    {
+                        app.run();
+                        ++core0_run_count;
+                        std::this_thread::yield();
+                    }
+                }).detach();
+    collect(0);
+    reset_tx_stats();
+    host_cdc_set_tx_stalled(true);
+    const size_t dual_burst_count = 4 * APP_TX_QUEUE_DEPTH;
+    request_blobs(dual_burst_count);
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(20 * TX_STALL_TIMEOUT_US));
+    uint32_t runs_before = core0_run_count;
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(2 * TX_STALL_TIMEOUT_US));
+    uint32_t core0_runs = core0_run_count - runs_before;
+    host_cdc_set_tx_stalled(false);
+    replies = collect(dual_burst_count);
+    intact = 0;
+    for (const std::vector<uint8_t>& reply: replies)
+        intact += is_blob_reply(reply);
+    read_tx_stats(stalls, drops);
+    printf("case=dual_core_stalled core0_runs=%u replies=%zu intact=%zu "
+           "stalls=%u drops=%u\n", core0_runs, replies.size(), intact, stalls,
+           drops);
+    expect(core0_runs > 0, "core0 keeps running while the PC is stalled");
+    expect(intact == replies.size() && !replies.empty(),
+           "only whole messages are sent (dual-core)");
+    expect(drops > 0 && replies.size() + drops == dual_burst_count,
+           "every message is either sent whole or counted as dropped "
+           "(dual-core)");
+
+    // Core1 never returns, so skip static destructors that it still uses.
+    int status = report_checks("Large replies are sent whole or dropped "
+                               "whole.");
+    fflush(stdout);
+    fflush(stderr);
+    _Exit(status);
+}
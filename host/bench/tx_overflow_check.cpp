@@ -0,0 +1,230 @@
+#include <check_app.h>
+#include <host_cdc.h>
+#include <host_time.h>
+#include <harp_frames.h>
+#include <harp_checks.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+// Checks the TX overflow policies: while the PC is not reading, events wait
+// in the TX queue without blocking run(), and once it is full, each policy
+// loses the events it should. Every event is either received or counted
+// against its register in R_TX_DROPS, including drops counted from several
+// threads (standing in for interrupts on either core) at once.
+// Exits with a nonzero status if any check fails.
+
+#pragma pack(push, 1)
+struct app_regs_t
+{
+    volatile uint32_t seq_a; // app register 0
+    volatile uint32_t seq_b; // app register 1
+} app_regs;
+#pragma pack(pop)
+
+const size_t reg_count = 2;
+
+constexpr RegLayout app_reg_layouts[reg_count]
+{
+    REG_LAYOUT(app_regs_t, seq_a),
+    REG_LAYOUT(app_regs_t, seq_b),
+};
+
+RegFnPair reg_handler_fns[reg_count]
+{
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+    {&HarpCore::read_reg_generic, &HarpCore::write_reg_generic},
+};
+
+HarpCApp& app = init_check_app("Host Overflow Check", app_regs,
+                               app_reg_layouts, reg_handler_fns);
+
+const uint8_t reg_a = APP_REG_START_ADDRESS;
+const uint8_t reg_b = APP_REG_START_ADDRESS + 1;
+
+typedef std::vector<uint32_t> seqs_t;
+
+/**
+ * \brief call run() until output stops arriving.
+ * \returns the payloads of the received events, per register, and the other
+ *  replies in \p replies.
+ */
+void drain(seqs_t& a, seqs_t& b, std::vector<std::vector<uint8_t>>& replies)
+{
+    std::vector<uint8_t> frame;
+    for (size_t idle_runs = 0; idle_runs < 16; ++idle_runs)
+    {
+        app.run();
+        while (read_reply(frame))
+        {
+            idle_runs = 0;
+            expect(checksum_ok(frame), "every message is whole");
+            uint32_t seq;
+            memcpy(&seq, &frame[11], sizeof(seq));
+            if (frame[0] == EVENT && frame[2] == reg_a)
+                a.push_back(seq);
+            else if (frame[0] == EVENT && frame[2] == reg_b)
+                b.push_back(seq);
+            else
+                replies.push_back(frame);
+        }
+    }
+}
+
+/**
+ * \brief send \p request and return its reply.
+ */
+std::vector<uint8_t> round_trip(const std::vector<uint8_t>& request)
+{
+    host_cdc_write(request.data(), request.size());
+    seqs_t a, b;
+    std::vector<std::vector<uint8_t>> replies;
+    drain(a, b, replies);
+    return replies.empty()? std::vector<uint8_t>(): replies.back();
+}
+
+/**
+ * \brief read the drop count of \p address and the total from R_TX_DROPS.
+ */
+void read_drops(uint8_t address, uint32_t& drops, uint32_t& total)
+{
+    round_trip(make_request(WRITE, TX_DROP_SELECT, U8, &address, 1));
+    std::vector<uint8_t> reply = round_trip(make_request(READ, TX_DROPS, U32));
+    drops = total = UINT32_MAX;
+    if (reply.size() == 12 + 8 && reply[2] == TX_DROPS)
+    {
+        memcpy(&drops, &reply[11], sizeof(drops));
+        memcpy(&total, &reply[15], sizeof(total));
+    }
+    else
+        expect(false, "R_TX_DROPS carries the selected and total counts");
+}
+
+/**
+ * \brief true if \p seqs count up by one from \p first to \p last.
+ */
+bool contiguous(const seqs_t& seqs, size_t first, size_t last)
+{
+    for (size_t i = first; i < last; ++i)
+        if (seqs[i + 1] != seqs[i] + 1)
+            return false;
+    return true;
+}
+
+/**
+ * \brief with the PC stalled, queue \p count events, alternating between
+ *  registers A and B if \p both, then let the PC read again.
+ */
+void stream(tx_overflow_policy_t policy, uint32_t count, bool both,
+            seqs_t& a, seqs_t& b)
+{
+    uint32_t zeros[2] = {};
+    round_trip(make_request(WRITE, TX_DROPS, U32, zeros, sizeof(zeros)));
+    HarpCore::set_tx_overflow_policy(policy);
+    host_cdc_set_tx_stalled(true);
+    for (uint32_t seq = 0; seq < count; ++seq)
+    {
+        uint8_t address = (both && (seq & 1))? reg_b: reg_a;
+        HarpCore::queue_harp_event(address, (const uint8_t*)&seq, sizeof(seq),
+                                   U32);
+        // Stay within the event queue, so only the TX queue overflows.
+        if ((seq % 8) == 7)
+            app.run();
+    }
+    host_cdc_set_tx_stalled(false);
+    std::vector<std::vector<uint8_t>> replies;
+    drain(a, b, replies);
+    HarpCore::set_tx_overflow_policy(DROP_NEWEST);
+}
+
+int main()
+{
+    host_time_set_manual(true);
+    host_time_set_us(1'000'000'000ULL);
+    for (size_t i = 0; i < 8; ++i)
+        app.run();
+    const uint32_t count = 200;
+    uint32_t drops, total, drops_b;
+
+    // Keep the oldest: the PC sees an unbroken run from the start.
+    seqs_t a, b;
+    stream(DROP_NEWEST, count, false, a, b);
+    read_drops(reg_a, drops, total);
+    printf("policy=drop_newest received=%zu drops=%u total=%u\n", a.size(),
+           drops, total);
+    expect(a.size() + drops == count && total == drops,
+           "every event is received or counted (drop newest)");
+    expect(drops > 0 && !a.empty() && a.front() == 0
+           && contiguous(a, 0, a.size() - 1),
+           "dropping the newest keeps the oldest in order");
+
+    // Keep the newest: the stream ends with the latest event.
+    a.clear();
+    stream(DROP_OLDEST, count, false, a, b);
+    read_drops(reg_a, drops, total);
+    printf("policy=drop_oldest received=%zu drops=%u total=%u\n", a.size(),
+           drops, total);
+    expect(a.size() + drops == count && total == drops,
+           "every event is received or counted (drop oldest)");
+    expect(drops > 0 && !a.empty() && a.back() == count - 1
+           && contiguous(a, a.size() - TX_QUEUE_DEPTH, a.size() - 1),
+           "dropping the oldest keeps the newest in order");
+
+    // Coalesce: each register still sends its latest value, in order.
+    a.clear();
+    stream(COALESCE_LATEST, count, true, a, b);
+    read_drops(reg_a, drops, total);
+    read_drops(reg_b, drops_b, total);
+    printf("policy=coalesce_latest received=%zu,%zu drops=%u,%u total=%u\n",
+           a.size(), b.size(), drops, drops_b, total);
+    expect(a.size() + b.size() + total == count && drops + drops_b == total,
+           "every event is received or counted per register (coalesce)");
+    expect(drops > 0 && drops_b > 0, "both registers coalesce");
+    expect(!a.empty() && !b.empty() && a.back() == count - 2
+           && b.back() == count - 1,
+           "each register's latest value is sent");
+    bool ordered = true;
+    for (size_t i = 1; i < a.size(); ++i)
+        ordered &= a[i] > a[i - 1];
+    for (size_t i = 1; i < b.size(); ++i)
+        ordered &= b[i] > b[i - 1];
+    expect(ordered, "coalesced values stay in order");
+
+    // Producers racing on a full event queue: no drop is lost.
+    uint32_t zeros[2] = {};
+    round_trip(make_request(WRITE, TX_DROPS, U32, zeros, sizeof(zeros)));
+    const uint32_t producer_count = 3;
+    const uint32_t events_per_producer = 100'000;
+    std::atomic<uint32_t> ready_count{0};
+    std::vector<std::thread> producers;
+    for (uint32_t producer = 0; producer < producer_count; ++producer)
+        producers.emplace_back([producer, &ready_count]
+        {
+            // Start together so that the drops overlap.
+            ++ready_count;
+            while (ready_count < producer_count)
+                std::this_thread::yield();
+            uint8_t address = (producer & 1)? reg_b: reg_a;
+            for (uint32_t seq = 0; seq < events_per_producer; ++seq)
+                HarpCore::queue_harp_event(address, (const uint8_t*)&seq,
+                                           sizeof(seq), U32);
+        });
+    for (std::thread& producer: producers)
+        producer.join();
+    drops_b = HarpCore::tx_drop_count(reg_b);
+    read_drops(reg_a, drops, total);
+    printf("case=racing_producers drops=%u,%u total=%u\n", drops, drops_b,
+           total);
+    expect(total == producer_count * events_per_producer - EVENT_QUEUE_DEPTH
+           && drops + drops_b == total,
+           "drops counted concurrently are all kept");
+    a.clear();
+    b.clear();
+    std::vector<std::vector<uint8_t>> replies;
+    drain(a, b, replies);
+
+    host_time_set_manual(false);
+    return report_checks("Every event is sent or counted as dropped.");
+}
@@ -0,0 +1,33 @@
+#ifndef HOST_HARDWARE_GPIO_H
+#define HOST_HARDWARE_GPIO_H
+#include <stdint.h>
+#include <hardware/irq.h>
+
+enum gpio_function
+{
+    GPIO_FUNC_UART = 2,
+    GPIO_FUNC_PIO0 = 6,
+    GPIO_FUNC_PIO1 = 7,
+    GPIO_FUNC_NULL = 0x1f,
+};
+
+enum gpio_irq_level
+{
+    GPIO_IRQ_LEVEL_LOW = 0x1u,
+    GPIO_IRQ_LEVEL_HIGH = 0x2u,
+    GPIO_IRQ_EDGE_FALL = 0x4u,
+    GPIO_IRQ_EDGE_RISE = 0x8u,
+};
+
+static inline void gpio_set_function(uint32_t gpio, enum gpio_function fn)
+{(void)gpio; (void)fn;}
+
+// GPIO interrupts. Edges are raised with host_gpio_edge() (see host_gpio.h),
+// which invokes the raw IO_IRQ_BANK0 handler attached to that pin.
+void gpio_set_irq_enabled(uint32_t gpio, uint32_t events, bool enabled);
+void gpio_acknowledge_irq(uint32_t gpio, uint32_t events);
+uint32_t gpio_get_irq_event_mask(uint32_t gpio);
+void gpio_add_raw_irq_handler(uint32_t gpio, irq_handler_t handler);
+void gpio_remove_raw_irq_handler(uint32_t gpio, irq_handler_t handler);
+
+#endif // HOST_HARDWARE_GPIO_H
@@ -0,0 +1,14 @@
+#ifndef HOST_HARDWARE_IRQ_H
+#define HOST_HARDWARE_IRQ_H
+#include <stdint.h>
+
+#define IO_IRQ_BANK0 (13)
+#define UART0_IRQ (20)
+#define UART1_IRQ (21)
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_exclusive_handler(uint32_t num, irq_handler_t handler);
+void irq_set_enabled(uint32_t num, bool enabled);
+
+#endif // HOST_HARDWARE_IRQ_H
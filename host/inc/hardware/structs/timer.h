@@ -0,0 +1,7 @@
+#ifndef HOST_HARDWARE_STRUCTS_TIMER_H
+#define HOST_HARDWARE_STRUCTS_TIMER_H
+// Intentionally empty. The timer is accessed through hardware/timer.h on the
+// host.
+#include <hardware/timer.h>
+
+#endif // HOST_HARDWARE_STRUCTS_TIMER_H
@@ -0,0 +1,38 @@
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+// On the host, "interrupts" are invoked synchronously by the test harness, so
+// disabling them is a no-op. Memory barriers still map to real fences.
+static inline uint32_t save_and_disable_interrupts()
+{return 0;}
+
+static inline void restore_interrupts(uint32_t status)
+{(void)status;}
+
+static inline void __dmb()
+{std::atomic_thread_fence(std::memory_order_seq_cst);}
+
+// Hardware spin locks. Threads stand in for cores.
+typedef std::atomic<uint32_t> spin_lock_t;
+
+int spin_lock_claim_unused(bool required);
+spin_lock_t* spin_lock_instance(uint32_t lock_num);
+
+static inline uint32_t spin_lock_blocking(spin_lock_t* lock)
+{
+    uint32_t status = save_and_disable_interrupts();
+    while (lock->exchange(1, std::memory_order_acquire))
+        std::this_thread::yield();
+    return status;
+}
+
+static inline void spin_unlock(spin_lock_t* lock, uint32_t status)
+{
+    lock->store(0, std::memory_order_release);
+    restore_interrupts(status);
+}
+
+#endif // HOST_HARDWARE_SYNC_H
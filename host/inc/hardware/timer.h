@@ -0,0 +1,33 @@
+#ifndef HOST_HARDWARE_TIMER_H
+#define HOST_HARDWARE_TIMER_H
+#include <stdint.h>
+#include <sys/types.h> // for uint
+
+// Host stand-in for the RP2040 1[us] system timer. See host_time.h.
+uint64_t time_us_64();
+
+static inline uint32_t time_us_32()
+{return uint32_t(time_us_64());}
+
+typedef struct
+{
+    uint64_t _private_us_since_boot;
+} absolute_time_t;
+
+static inline absolute_time_t from_us_since_boot(uint64_t us)
+{return absolute_time_t{us};}
+
+static inline uint64_t to_us_since_boot(absolute_time_t t)
+{return t._private_us_since_boot;}
+
+// Hardware alarms. Callbacks are invoked as manual time passes their targets.
+// See host_time.h.
+typedef void (*hardware_alarm_callback_t)(uint alarm_num);
+
+int hardware_alarm_claim_unused(bool required);
+void hardware_alarm_set_callback(uint alarm_num,
+                                 hardware_alarm_callback_t callback);
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t t);
+void hardware_alarm_cancel(uint alarm_num);
+
+#endif // HOST_HARDWARE_TIMER_H
@@ -0,0 +1,34 @@
+#ifndef HOST_HARDWARE_UART_H
+#define HOST_HARDWARE_UART_H
+#include <stdint.h>
+#include <stddef.h>
+
+// Host stand-in for the RP2040 UART. Incoming bytes are injected with
+// host_uart_inject() (see host_uart.h), which invokes the attached IRQ handler.
+// Outgoing bytes are collected with host_uart_take_tx().
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_inst_t* const uart0;
+extern uart_inst_t* const uart1;
+
+typedef enum
+{
+    UART_PARITY_NONE,
+    UART_PARITY_EVEN,
+    UART_PARITY_ODD
+} uart_parity_t;
+
+uint32_t uart_init(uart_inst_t* uart, uint32_t baudrate);
+bool uart_is_enabled(uart_inst_t* uart);
+void uart_set_hw_flow(uart_inst_t* uart, bool cts, bool rts);
+void uart_set_format(uart_inst_t* uart, uint32_t data_bits, uint32_t stop_bits,
+                     uart_parity_t parity);
+void uart_set_fifo_enabled(uart_inst_t* uart, bool enabled);
+void uart_set_irq_enables(uart_inst_t* uart, bool rx_has_data,
+                          bool tx_needs_data);
+bool uart_is_readable(uart_inst_t* uart);
+char uart_getc(uart_inst_t* uart);
+void uart_write_blocking(uart_inst_t* uart, const uint8_t* src, size_t len);
+
+#endif // HOST_HARDWARE_UART_H
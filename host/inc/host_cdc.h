@@ -0,0 +1,49 @@
+#ifndef HOST_CDC_H
+#define HOST_CDC_H
+#include <stdint.h>
+#include <stddef.h>
+
+// "PC-side" controls for the host stand-in of the TinyUSB CDC interface.
+// Bytes written with host_cdc_write() arrive in the device RX FIFO in
+// 64-byte OUT packets on the next tud_task(). Bytes written by the device
+// are moved to the PC side one IN packet per flush, and the transfer
+// completes on the following tud_task(), mimicking TinyUSB.
+
+/**
+ * \brief queue bytes to be sent from the "PC" to the device.
+ */
+void host_cdc_write(const void* data, size_t num_bytes);
+
+/**
+ * \brief number of bytes the device has sent that the "PC" has not yet read.
+ */
+size_t host_cdc_available();
+
+/**
+ * \brief read up to \p num_bytes sent from the device.
+ * \returns number of bytes read.
+ */
+size_t host_cdc_read(void* data, size_t num_bytes);
+
+/**
+ * \brief set whether the "PC" has the port open (i.e: DTR set).
+ */
+void host_cdc_set_connected(bool connected);
+
+/**
+ * \brief when stalled, IN transfers never complete, emulating a PC that has
+ *  stopped reading from the port.
+ */
+void host_cdc_set_tx_stalled(bool stalled);
+
+/**
+ * \brief total number of IN packets transferred to the PC since reset.
+ */
+uint32_t host_cdc_tx_packet_count();
+
+/**
+ * \brief clear all FIFOs, flags, and counters.
+ */
+void host_cdc_reset();
+
+#endif // HOST_CDC_H
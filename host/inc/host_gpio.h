@@ -0,0 +1,12 @@
+#ifndef HOST_GPIO_H
+#define HOST_GPIO_H
+#include <stdint.h>
+#include <hardware/gpio.h>
+
+/**
+ * \brief latch \p events (i.e: GPIO_IRQ_EDGE_FALL) on \p gpio and invoke its
+ *  raw IRQ handler as the hardware would if any of them are enabled.
+ */
+void host_gpio_edge(uint32_t gpio, uint32_t events);
+
+#endif // HOST_GPIO_H
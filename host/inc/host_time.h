@@ -0,0 +1,16 @@
+#ifndef HOST_TIME_H
+#define HOST_TIME_H
+#include <stdint.h>
+
+// Controls for the host stand-in of the RP2040 1[us] system timer.
+// By default, time_us_64() follows the host's monotonic clock (starting at
+// zero). In manual mode, time only changes when set or advanced explicitly.
+// Hardware alarms only fire in manual mode: setting or advancing the time
+// past their targets invokes their callbacks in order, with time_us_64()
+// reading each alarm's target during its callback.
+
+void host_time_set_manual(bool manual);
+void host_time_set_us(uint64_t time_us);
+void host_time_advance_us(uint64_t delta_us);
+
+#endif // HOST_TIME_H
@@ -0,0 +1,24 @@
+#ifndef HOST_UART_H
+#define HOST_UART_H
+#include <stdint.h>
+#include <stddef.h>
+#include <hardware/uart.h>
+
+/**
+ * \brief push bytes into the UART's RX path, invoking the attached RX IRQ
+ *  handler as the hardware would. If the UART FIFO is disabled, the handler
+ *  is invoked once per byte. Otherwise, it is invoked once for all bytes.
+ */
+void host_uart_inject(uart_inst_t* uart, const uint8_t* data, size_t num_bytes);
+
+/**
+ * \brief take up to \p num_bytes bytes written to the UART's TX path, along
+ *  with the system time (in [us]) at which each byte's start bit went out.
+ *  Bytes go out back-to-back (10 bits each at the UART's baud rate) from
+ *  when they were written.
+ * \returns the number of bytes taken.
+ */
+size_t host_uart_take_tx(uart_inst_t* uart, uint8_t* data,
+                         uint64_t* start_times_us, size_t num_bytes);
+
+#endif // HOST_UART_H
@@ -0,0 +1,11 @@
+#ifndef HOST_PICO_DIVIDER_H
+#define HOST_PICO_DIVIDER_H
+#include <stdint.h>
+
+static inline uint64_t divmod_u64u64_rem(uint64_t a, uint64_t b, uint64_t* rem)
+{*rem = a % b; return a / b;}
+
+static inline uint64_t div_u64u64(uint64_t a, uint64_t b)
+{return a / b;}
+
+#endif // HOST_PICO_DIVIDER_H
@@ -0,0 +1,8 @@
+#ifndef HOST_PICO_MULTICORE_H
+#define HOST_PICO_MULTICORE_H
+#include <pico/platform.h>
+
+// Runs \p entry on a detached thread that reports itself as core1.
+void multicore_launch_core1(void (*entry)(void));
+
+#endif // HOST_PICO_MULTICORE_H
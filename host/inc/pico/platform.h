@@ -0,0 +1,20 @@
+#ifndef HOST_PICO_PLATFORM_H
+#define HOST_PICO_PLATFORM_H
+#include <stdint.h>
+#include <thread>
+
+// Each host thread stands in for one core. The main thread is core0.
+extern thread_local uint32_t host_core_num;
+
+static inline uint32_t get_core_num()
+{return host_core_num;}
+
+// Busy-wait loops give up the CPU so that the other "core" can progress even
+// if the host has only one CPU.
+static inline void tight_loop_contents()
+{std::this_thread::yield();}
+
+// Prints the formatted message and aborts.
+[[noreturn]] void panic(const char* fmt, ...);
+
+#endif // HOST_PICO_PLATFORM_H
@@ -0,0 +1,11 @@
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+// Host stand-in for the subset of the Pico SDK used by the Harp Core.
+#include <stdint.h>
+#include <pico/platform.h>
+#include <hardware/timer.h>
+#include <pico/time.h>
+#include <hardware/gpio.h>
+#include <hardware/uart.h>
+
+#endif // HOST_PICO_STDLIB_H
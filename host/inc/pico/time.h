@@ -0,0 +1,32 @@
+#ifndef HOST_PICO_TIME_H
+#define HOST_PICO_TIME_H
+#include <stdint.h>
+#include <hardware/timer.h>
+
+// Host stand-in for the default alarm pool. Callbacks are invoked as manual
+// time passes their targets, like hardware alarms. See host_time.h.
+
+#ifndef PICO_TIME_DEFAULT_ALARM_POOL_MAX_TIMERS
+#define PICO_TIME_DEFAULT_ALARM_POOL_MAX_TIMERS (16) // as in the Pico SDK.
+#endif
+
+typedef int32_t alarm_id_t;
+
+/**
+ * \returns 0 to not reschedule the alarm, >0 to reschedule it this many [us]
+ *  from when the callback returns, or <0 to reschedule it this many [us]
+ *  from its previous target.
+ */
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void* user_data);
+
+/**
+ * \returns the alarm's id, 0 if \p time already passed and either
+ *  \p fire_if_past is false or the callback (invoked immediately) did not
+ *  reschedule itself, or -1 if all
+ *  #PICO_TIME_DEFAULT_ALARM_POOL_MAX_TIMERS alarms are in use.
+ */
+alarm_id_t add_alarm_at(absolute_time_t time, alarm_callback_t callback,
+                        void* user_data, bool fire_if_past);
+bool cancel_alarm(alarm_id_t alarm_id);
+
+#endif // HOST_PICO_TIME_H
@@ -0,0 +1,26 @@
+#ifndef HOST_TUSB_H
+#define HOST_TUSB_H
+// Host stand-in for the subset of the TinyUSB device CDC API used by the
+// Harp Core. Backed by an in-memory loopback (see host_cdc.h).
+#include <stdint.h>
+#include <stddef.h>
+#include <tusb_config.h>
+
+#define CFG_TUD_CDC_EP_BUFSIZE (64) // Full-speed bulk endpoint packet size.
+
+bool tusb_init();
+void tud_task();
+
+bool tud_cdc_connected();
+uint32_t tud_cdc_available();
+uint32_t tud_cdc_read(void* buffer, uint32_t bufsize);
+uint32_t tud_cdc_write_char(char ch);
+uint32_t tud_cdc_write(const void* buffer, uint32_t bufsize);
+uint32_t tud_cdc_write_flush();
+uint32_t tud_cdc_write_available();
+
+// Invoked from tud_task() when new data has arrived in the RX FIFO.
+// Weak default does nothing (same as TinyUSB).
+extern "C" void tud_cdc_rx_cb(uint8_t itf);
+
+#endif // HOST_TUSB_H
@@ -0,0 +1,402 @@
+#include <pico/stdlib.h>
+#include <pico/time.h>
+#include <pico/unique_id.h>
+#include <pico/bootrom.h>
+#include <pico/multicore.h>
+#include <hardware/irq.h>
+#include <hardware/sync.h>
+#include <host_time.h>
+#include <host_uart.h>
+#include <host_gpio.h>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <thread>
+
+// System Timer.
+namespace
+{
+    std::atomic<bool> manual_time{false};
+    std::atomic<uint64_t> manual_time_us{0};
+}
+
+uint64_t time_us_64()
+{
+    // Constructed on first use, since the time may be read from the
+    // constructors of other globals.
+    static const auto boot_time = std::chrono::steady_clock::now();
+    if (manual_time)
+        return manual_time_us;
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - boot_time).count();
+}
+
+void host_time_set_manual(bool manual)
+{
+    if (manual && !manual_time)
+        manual_time_us = time_us_64();
+    manual_time = manual;
+}
+
+void panic(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    printf("\r\n");
+    fflush(stdout);
+    abort();
+}
+
+// Hardware alarms.
+namespace
+{
+    const uint32_t alarm_count = 4;
+    hardware_alarm_callback_t alarm_callbacks[alarm_count] = {nullptr};
+    uint64_t alarm_targets_us[alarm_count] = {0};
+    bool alarm_armed[alarm_count] = {false};
+    uint32_t alarm_claims = 0;
+}
+
+int hardware_alarm_claim_unused(bool required)
+{
+    if (alarm_claims >= alarm_count)
+    {
+        if (required)
+        {
+            printf("No hardware alarms are available.\r\n");
+            abort();
+        }
+        return -1;
+    }
+    return alarm_claims++;
+}
+
+void hardware_alarm_set_callback(uint alarm_num,
+                                 hardware_alarm_callback_t callback)
+{alarm_callbacks[alarm_num] = callback;}
+
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t t)
+{
+    uint64_t target_us = to_us_since_boot(t);
+    // Like the hardware, report (and skip) targets that already passed.
+    alarm_armed[alarm_num] = (target_us > time_us_64());
+    alarm_targets_us[alarm_num] = target_us;
+    return !alarm_armed[alarm_num];
+}
+
+void hardware_alarm_cancel(uint alarm_num)
+{alarm_armed[alarm_num] = false;}
+
+// Default alarm pool.
+namespace
+{
+    struct pool_alarm_t
+    {
+        uint64_t target_us;
+        alarm_callback_t callback;
+        void* user_data;
+    };
+    alarm_id_t next_pool_alarm_id = 1;
+
+    // Constructed on first use, since alarms may be added from the
+    // constructors of other globals.
+    std::map<alarm_id_t, pool_alarm_t>& pool_alarms()
+    {
+        static std::map<alarm_id_t, pool_alarm_t> alarms;
+        return alarms;
+    }
+
+    /**
+     * \brief invoke a pool alarm's callback and reschedule it as requested.
+     * \returns true if it was rescheduled.
+     */
+    bool fire_pool_alarm(alarm_id_t id, pool_alarm_t alarm)
+    {
+        int64_t reschedule_us = alarm.callback(id, alarm.user_data);
+        if (reschedule_us == 0)
+            return false;
+        alarm.target_us = (reschedule_us > 0)?
+                              time_us_64() + reschedule_us:
+                              alarm.target_us - reschedule_us;
+        pool_alarms()[id] = alarm;
+        return true;
+    }
+}
+
+alarm_id_t add_alarm_at(absolute_time_t time, alarm_callback_t callback,
+                        void* user_data, bool fire_if_past)
+{
+    if (pool_alarms().size() >= PICO_TIME_DEFAULT_ALARM_POOL_MAX_TIMERS)
+        return -1;
+    alarm_id_t id = next_pool_alarm_id++;
+    pool_alarm_t alarm{to_us_since_boot(time), callback, user_data};
+    if (alarm.target_us > time_us_64())
+    {
+        pool_alarms()[id] = alarm;
+        return id;
+    }
+    if (fire_if_past && fire_pool_alarm(id, alarm))
+        return id;
+    return 0;
+}
+
+bool cancel_alarm(alarm_id_t alarm_id)
+{return pool_alarms().erase(alarm_id) > 0;}
+
+void host_time_set_us(uint64_t time_us)
+{
+    // Fire due alarms in order, each at its own target time.
+    while (true)
+    {
+        int32_t next_alarm = -1;
+        uint64_t next_target_us = UINT64_MAX;
+        for (uint32_t i = 0; i < alarm_count; ++i)
+        {
+            if (alarm_armed[i] && alarm_targets_us[i] <= time_us
+                && alarm_targets_us[i] < next_target_us)
+            {
+                next_alarm = i;
+                next_target_us = alarm_targets_us[i];
+            }
+        }
+        auto next_pool_alarm = pool_alarms().end();
+        for (auto it = pool_alarms().begin(); it != pool_alarms().end(); ++it)
+        {
+            if (it->second.target_us <= time_us
+                && it->second.target_us < next_target_us)
+            {
+                next_pool_alarm = it;
+                next_target_us = it->second.target_us;
+            }
+        }
+        if (next_target_us == UINT64_MAX)
+            break;
+        if (next_target_us > manual_time_us)
+            manual_time_us = next_target_us;
+        if (next_pool_alarm != pool_alarms().end())
+        {
+            alarm_id_t id = next_pool_alarm->first;
+            pool_alarm_t alarm = next_pool_alarm->second;
+            pool_alarms().erase(next_pool_alarm);
+            fire_pool_alarm(id, alarm);
+            continue;
+        }
+        alarm_armed[next_alarm] = false;
+        if (alarm_callbacks[next_alarm] != nullptr)
+            alarm_callbacks[next_alarm](next_alarm);
+    }
+    manual_time_us = time_us;
+}
+
+void host_time_advance_us(uint64_t delta_us)
+{host_time_set_us(manual_time_us + delta_us);}
+
+// Interrupts.
+namespace
+{
+    irq_handler_t irq_handlers[32] = {nullptr};
+    bool irq_enabled[32] = {false};
+}
+
+void irq_set_exclusive_handler(uint32_t num, irq_handler_t handler)
+{irq_handlers[num] = handler;}
+
+void irq_set_enabled(uint32_t num, bool enabled)
+{irq_enabled[num] = enabled;}
+
+// UART.
+struct uart_inst
+{
+    uint32_t irq_num;
+    bool enabled;
+    uint32_t baudrate;
+    bool fifo_enabled;
+    bool rx_irq_enabled;
+    std::deque<uint8_t> rx_fifo;
+    std::deque<std::pair<uint8_t, uint64_t>> tx_bytes; // with start times.
+    uint64_t tx_idle_us; // when the last byte written finishes going out.
+};
+
+namespace
+{
+    uart_inst uart_instances[2] =
+        {{UART0_IRQ, false, 0, true, false, {}, {}, 0},
+         {UART1_IRQ, false, 0, true, false, {}, {}, 0}};
+}
+
+uart_inst_t* const uart0 = &uart_instances[0];
+uart_inst_t* const uart1 = &uart_instances[1];
+
+uint32_t uart_init(uart_inst_t* uart, uint32_t baudrate)
+{
+    uart->enabled = true;
+    uart->baudrate = baudrate;
+    uart->fifo_enabled = true;
+    uart->rx_fifo.clear();
+    uart->tx_bytes.clear();
+    return baudrate;
+}
+
+bool uart_is_enabled(uart_inst_t* uart)
+{return uart->enabled;}
+
+void uart_set_hw_flow(uart_inst_t* uart, bool cts, bool rts)
+{(void)uart; (void)cts; (void)rts;}
+
+void uart_set_format(uart_inst_t* uart, uint32_t data_bits, uint32_t stop_bits,
+                     uart_parity_t parity)
+{(void)uart; (void)data_bits; (void)stop_bits; (void)parity;}
+
+void uart_set_fifo_enabled(uart_inst_t* uart, bool enabled)
+{uart->fifo_enabled = enabled;}
+
+void uart_set_irq_enables(uart_inst_t* uart, bool rx_has_data,
+                          bool tx_needs_data)
+{uart->rx_irq_enabled = rx_has_data; (void)tx_needs_data;}
+
+bool uart_is_readable(uart_inst_t* uart)
+{return !uart->rx_fifo.empty();}
+
+char uart_getc(uart_inst_t* uart)
+{
+    char byte = uart->rx_fifo.front();
+    uart->rx_fifo.pop_front();
+    return byte;
+}
+
+void uart_write_blocking(uart_inst_t* uart, const uint8_t* src, size_t len)
+{
+    uint64_t byte_us = 10'000'000 / uart->baudrate;
+    uint64_t start_us = time_us_64();
+    if (uart->tx_idle_us > start_us)
+        start_us = uart->tx_idle_us;
+    for (size_t i = 0; i < len; ++i, start_us += byte_us)
+        uart->tx_bytes.emplace_back(src[i], start_us);
+    uart->tx_idle_us = start_us;
+}
+
+size_t host_uart_take_tx(uart_inst_t* uart, uint8_t* data,
+                         uint64_t* start_times_us, size_t num_bytes)
+{
+    size_t i = 0;
+    for (; i < num_bytes && !uart->tx_bytes.empty(); ++i)
+    {
+        data[i] = uart->tx_bytes.front().first;
+        start_times_us[i] = uart->tx_bytes.front().second;
+        uart->tx_bytes.pop_front();
+    }
+    return i;
+}
+
+void host_uart_inject(uart_inst_t* uart, const uint8_t* data, size_t num_bytes)
+{
+    irq_handler_t handler = irq_handlers[uart->irq_num];
+    bool fire = uart->rx_irq_enabled && irq_enabled[uart->irq_num]
+                && (handler != nullptr);
+    for (size_t i = 0; i < num_bytes; ++i)
+    {
+        uart->rx_fifo.push_back(data[i]);
+        if (!uart->fifo_enabled && fire)
+            handler();
+    }
+    if (uart->fifo_enabled && fire)
+        handler();
+}
+
+// GPIO interrupts.
+namespace
+{
+    const uint32_t gpio_count = 30;
+    irq_handler_t gpio_raw_handlers[gpio_count] = {nullptr};
+    uint32_t gpio_enabled_events[gpio_count] = {0};
+    uint32_t gpio_pending_events[gpio_count] = {0};
+}
+
+void gpio_set_irq_enabled(uint32_t gpio, uint32_t events, bool enabled)
+{
+    if (enabled)
+        gpio_enabled_events[gpio] |= events;
+    else
+        gpio_enabled_events[gpio] &= ~events;
+}
+
+void gpio_acknowledge_irq(uint32_t gpio, uint32_t events)
+{gpio_pending_events[gpio] &= ~events;}
+
+uint32_t gpio_get_irq_event_mask(uint32_t gpio)
+{return gpio_pending_events[gpio] & gpio_enabled_events[gpio];}
+
+void gpio_add_raw_irq_handler(uint32_t gpio, irq_handler_t handler)
+{gpio_raw_handlers[gpio] = handler;}
+
+void gpio_remove_raw_irq_handler(uint32_t gpio, irq_handler_t handler)
+{
+    if (gpio_raw_handlers[gpio] == handler)
+        gpio_raw_handlers[gpio] = nullptr;
+}
+
+void host_gpio_edge(uint32_t gpio, uint32_t events)
+{
+    // Edges latch whether or not their interrupt is enabled.
+    gpio_pending_events[gpio] |= events;
+    irq_handler_t handler = gpio_raw_handlers[gpio];
+    if (gpio_get_irq_event_mask(gpio) && irq_enabled[IO_IRQ_BANK0]
+        && handler != nullptr)
+        handler();
+}
+
+// Multicore.
+thread_local uint32_t host_core_num = 0;
+
+void multicore_launch_core1(void (*entry)(void))
+{
+    std::thread([entry]
+                {
+                    host_core_num = 1;
+                    entry();
+                }).detach();
+}
+
+// Spin locks.
+namespace
+{
+    spin_lock_t spin_locks[32];
+    std::atomic<uint32_t> spin_lock_claims{0};
+}
+
+int spin_lock_claim_unused(bool required)
+{
+    uint32_t lock_num = spin_lock_claims++;
+    if (lock_num >= 32)
+    {
+        if (required)
+        {
+            printf("No spin locks are available.\r\n");
+            abort();
+        }
+        return -1;
+    }
+    return lock_num;
+}
+
+spin_lock_t* spin_lock_instance(uint32_t lock_num)
+{return &spin_locks[lock_num];}
+
+// Misc.
+void pico_get_unique_board_id(pico_unique_board_id_t* id_out)
+{memset(id_out->id, 0, sizeof(id_out->id));}
+
+void reset_usb_boot(uint32_t usb_activity_gpio_pin_mask,
+                    uint32_t disable_interface_mask)
+{
+    (void)usb_activity_gpio_pin_mask; (void)disable_interface_mask;
+    printf("reset_usb_boot() is not supported on the host.\r\n");
+    abort();
+}
@@ -0,0 +1,167 @@
+#include <tusb.h>
+#include <host_cdc.h>
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// In-memory model of a TinyUSB CDC device attached to a "PC".
+// The "PC" may run on a different thread than the device (i.e: in dual-core
+// mode), so every call holds one lock. It is recursive since tud_task()
+// calls back into the device.
+namespace
+{
+    std::recursive_mutex usb_mutex;
+    std::deque<uint8_t> pc_to_device;   // written by the PC, not yet sent.
+    std::deque<uint8_t> rx_fifo;        // device RX FIFO.
+    std::deque<uint8_t> tx_fifo;        // device TX FIFO.
+    std::vector<uint8_t> tx_in_flight;  // IN transfer in progress.
+    std::deque<uint8_t> device_to_pc;   // delivered to the PC, not yet read.
+    bool connected = true;
+    bool tx_stalled = false;
+    uint32_t tx_packet_count = 0;
+}
+
+extern "C" __attribute__((weak)) void tud_cdc_rx_cb(uint8_t itf)
+{(void)itf;}
+
+bool tusb_init()
+{return true;}
+
+void tud_task()
+{
+    std::lock_guard<std::recursive_mutex> lock(usb_mutex);
+    // Complete the pending IN transfer and queue up the next one.
+    if (!tx_in_flight.empty() && !tx_stalled)
+    {
+        device_to_pc.insert(device_to_pc.end(), tx_in_flight.begin(),
+                            tx_in_flight.end());
+        tx_in_flight.clear();
+        ++tx_packet_count;
+        // TinyUSB re-arms the endpoint if more data is waiting.
+        if (!tx_fifo.empty())
+            tud_cdc_write_flush();
+    }
+    // Receive OUT packets while there is room in the RX FIFO.
+    bool received = false;
+    while (!pc_to_device.empty()
+           && (CFG_TUD_CDC_RX_BUFSIZE - rx_fifo.size()) >= CFG_TUD_CDC_EP_BUFSIZE)
+    {
+        size_t packet_size = std::min<size_t>(pc_to_device.size(),
+                                              CFG_TUD_CDC_EP_BUFSIZE);
+        rx_fifo.insert(rx_fifo.end(), pc_to_device.begin(),
+                       pc_to_device.begin() + packet_size);
+        pc_to_device.erase(pc_to_device.begin(),
+                           pc_to_device.begin() + packet_size);
+        received = true;
+    }
+    if (received)
+        tud_cdc_rx_cb(0);
+}
+
+bool tud_cdc_connected()
+{
+    std::lock_guard<std::recursive_mutex> lock(usb_mutex);
+    return connected;
+}
+
+uint32_t tud_cdc_available()
+{
+    std::lock_guard<std::recursive_mutex> lock(usb_mutex);
+    return rx_fifo.size();
+}
+
+uint32_t tud_cdc_read(void* buffer, uint32_t bufsize)
+{
+    std::lock_guard<std::recursive_mutex> lock(usb_mutex);
+    uint32_t count = std::min<uint32_t>(bufsize, rx_fifo.size());
+    std::copy_n(rx_fifo.begin(), count, (uint8_t*)buffer);
+    rx_fifo.erase(rx_fifo.begin(), rx_fifo.begin() + count);
+    return count;
+}
+
+uint32_t tud_cdc_write_char(char ch)
+{return tud_cdc_write(&ch, 1);}
+
+uint32_t tud_cdc_write(const void* buffer, uint32_t bufsize)
+{
+    std::lock_guard<std::recursive_mutex> lock(usb_mutex);
+    uint32_t count = std::min(bufsize, tud_cdc_write_available());
+    const uint8_t* bytes = (const uint8_t*)buffer;
+    tx_fifo.insert(tx_fifo.end(), bytes, bytes + count);
+    // Like TinyUSB, start a transfer as soon as a full packet is waiting.
+    if (tx_fifo.size() >= CFG_TUD_CDC_EP_BUFSIZE)
+        tud_cdc_write_flush();
+    return count;
+}
+
+uint32_t tud_cdc_write_flush()
+{
+    std::lock_guard<std::recursive_mutex> lock(usb_mutex);
+    if (!connected || !tx_in_flight.empty() || tx_fifo.empty())
+        return 0;
+    size_t packet_size = std::min<size_t>(tx_fifo.size(),
+                                          CFG_TUD_CDC_EP_BUFSIZE);
+    tx_in_flight.assign(tx_fifo.begin(), tx_fifo.begin() + packet_size);
+    tx_fifo.erase(tx_fifo.begin(), tx_fifo.begin() + packet_size);
+    return packet_size;
+}
+
+uint32_t tud_cdc_write_available()
+{
+    std::lock_guard<std::recursive_mutex> lock(usb_mutex);
+    return CFG_TUD_CDC_TX_BUFSIZE - tx_fifo.size();
+}
+
+void host_cdc_write(const void* data, size_t num_bytes)
+{
+    std::lock_guard<std::recursive_mutex> lock(usb_mutex);
+    const uint8_t* bytes = (const uint8_t*)data;
+    pc_to_device.insert(pc_to_device.end(), bytes, bytes + num_bytes);
+}
+
+size_t host_cdc_available()
+{
+    std::lock_guard<std::recursive_mutex> lock(usb_mutex);
+    return device_to_pc.size();
+}
+
+size_t host_cdc_read(void* data, size_t num_bytes)
+{
+    std::lock_guard<std::recursive_mutex> lock(usb_mutex);
+    size_t count = std::min(num_bytes, device_to_pc.size());
+    std::copy_n(device_to_pc.begin(), count, (uint8_t*)data);
+    device_to_pc.erase(device_to_pc.begin(), device_to_pc.begin() + count);
+    return count;
+}
+
+void host_cdc_set_connected(bool is_connected)
+{
+    std::lock_guard<std::recursive_mutex> lock(usb_mutex);
+    connected = is_connected;
+}
+
+void host_cdc_set_tx_stalled(bool stalled)
+{
+    std::lock_guard<std::recursive_mutex> lock(usb_mutex);
+    tx_stalled = stalled;
+}
+
+uint32_t host_cdc_tx_packet_count()
+{
+    std::lock_guard<std::recursive_mutex> lock(usb_mutex);
+    return tx_packet_count;
+}
+
+void host_cdc_reset()
+{
+    std::lock_guard<std::recursive_mutex> lock(usb_mutex);
+    pc_to_device.clear();
+    rx_fifo.clear();
+    tx_fifo.clear();
+    tx_in_flight.clear();
+    device_to_pc.clear();
+    connected = true;
+    tx_stalled = false;
+    tx_packet_count = 0;
+}
@@ -0,0 +1,453 @@
+#!/usr/bin/env python3
+"""Throughput and latency benchmarks for a Harp device.
+
+Runs against a device on a serial port, or against the host-built core
+behind a pseudo-terminal (host/bench/pty_device.cpp), which needs no device
+and is repeatable in CI:
+
+    ./benchmark.py --port /dev/ttyACM0
+    ./benchmark.py --host-device ../host/_build/pty_device --quick
+
+Prints one JSON object per benchmark case (one per line) with latency
+percentiles in microseconds and, where relevant, throughput. Cases:
+  pipeline       reads kept in flight at increasing depth.
+  payload        a read and a write of every payload type and size.
+  dump           time until the last reply of an R_OPERATION_CTRL DUMP.
+  events         event-stream throughput in ACTIVE mode.
+  events_load    read round trips while events stream concurrently.
+The event cases need the registers of the pty device's bench app and are
+reported as skipped on other devices. Only needs the standard library on
+POSIX; pyserial is used on other platforms.
+Exits with a nonzero status if any reply is missing or malformed.
+"""
+import argparse
+import json
+import os
+import select
+import struct
+import subprocess
+import sys
+import time
+
+# Message types.
+READ = 1
+WRITE = 2
+EVENT = 3
+READ_ERROR = 9
+WRITE_ERROR = 10
+
+# Payload types.
+U8, S8, U16, S16, U32, S32, U64, S64, FLOAT = (
+    0x01, 0x81, 0x02, 0x82, 0x04, 0x84, 0x08, 0x88, 0x44)
+HAS_TIMESTAMP = 0x10
+STRUCT_FORMATS = {U8: "B", S8: "b", U16: "H", S16: "h", U32: "I", S32: "i",
+                  U64: "Q", S64: "q", FLOAT: "f"}
+
+# Core registers.
+WHO_AM_I = 0
+OPERATION_CTRL = 10
+DEVICE_NAME = 12
+ACTIVE = 0x01
+DUMP_BIT = 1 << 3
+OP_MODE_MASK = 0x03
+
+# Registers of the pty device's bench app.
+BENCH_DEVICE_NAME = "Harp Bench Device"
+APP_REG_START_ADDRESS = 32
+BENCH_REGS = [  # (name, address, payload type, element count)
+    ("u8", 32, U8, 1), ("s8", 33, S8, 1), ("u16", 34, U16, 1),
+    ("s16", 35, S16, 1), ("u32", 36, U32, 1), ("s32", 37, S32, 1),
+    ("u64", 38, U64, 1), ("s64", 39, S64, 1), ("float", 40, FLOAT, 1),
+    ("u8x16", 41, U8, 16), ("u32x12", 42, U32, 12)]
+EVENT_RATE_HZ = 43
+EVENT_SEQ = 44
+EVENT_DROPS = 45
+
+# Registers that any device has, for the payload case without the bench app.
+CORE_READ_REGS = [  # (name, address, payload type, element count)
+    ("who_am_i", 0, U16, 1), ("hw_version_h", 1, U8, 1),
+    ("timestamp_second", 8, U32, 1), ("device_name", 12, U8, 25),
+    ("uuid", 16, U8, 16)]
+
+REPLY_TIMEOUT_S = 1.0
+
+
+class BenchmarkError(Exception):
+    pass
+
+
+class Port:
+    """Raw byte stream to the device."""
+
+    def __init__(self, path):
+        self.serial = None
+        if os.name == "posix":
+            import termios
+            import tty
+            self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+            tty.setraw(self.fd)
+            termios.tcflush(self.fd, termios.TCIOFLUSH)
+        else:
+            import serial
+            self.serial = serial.Serial(path, timeout=0)
+
+    def write(self, data):
+        if self.serial is not None:
+            self.serial.write(data)
+            return
+        view = memoryview(data)
+        while view:
+            written = os.write(self.fd, view)
+            view = view[written:]
+
+    def read(self, timeout_s):
+        """Return the bytes available within timeout_s (maybe none)."""
+        if self.serial is not None:
+            deadline = time.perf_counter() + timeout_s
+            while True:
+                data = self.serial.read(self.serial.in_waiting or 1)
+                if data or time.perf_counter() >= deadline:
+                    return data
+        ready, _, _ = select.select([self.fd], [], [], timeout_s)
+        if not ready:
+            return b""
+        return os.read(self.fd, 4096)
+
+    def close(self):
+        if self.serial is not None:
+            self.serial.close()
+        else:
+            os.close(self.fd)
+
+
+class Frame:
+    def __init__(self, raw, receive_ns):
+        self.raw = raw
+        self.receive_ns = receive_ns
+        self.type = raw[0]
+        self.address = raw[2]
+        self.payload_type = raw[4] & ~HAS_TIMESTAMP
+        header_size = 11 if raw[4] & HAS_TIMESTAMP else 5
+        self.payload = raw[header_size:-1]
+
+    def values(self):
+        fmt = STRUCT_FORMATS[self.payload_type]
+        count = len(self.payload) // struct.calcsize(fmt)
+        return struct.unpack("<%d%s" % (count, fmt), self.payload)
+
+
+def make_request(msg_type, address, payload_type, payload=b""):
+    frame = bytearray([msg_type, 4 + len(payload), address, 255,
+                       payload_type])
+    frame += payload
+    frame.append(sum(frame) & 0xFF)
+    return bytes(frame)
+
+
+class Device:
+    """Harp framing over a Port. Events are set aside while waiting for
+    replies."""
+
+    def __init__(self, port):
+        self.port = port
+        self.pending = bytearray()
+        self.replies = []
+        self.events = []
+
+    def send(self, frame):
+        self.port.write(frame)
+        return time.perf_counter_ns()
+
+    def poll(self, timeout_s):
+        """Return the frames that arrive within timeout_s."""
+        data = self.port.read(timeout_s)
+        receive_ns = time.perf_counter_ns()
+        self.pending += data
+        frames = []
+        while (len(self.pending) >= 2
+               and len(self.pending) >= self.pending[1] + 2):
+            size = self.pending[1] + 2
+            raw = bytes(self.pending[:size])
+            del self.pending[:size]
+            if (sum(raw[:-1]) & 0xFF) != raw[-1]:
+                raise BenchmarkError("reply with a bad checksum: %s"
+                                     % raw.hex())
+            frames.append(Frame(raw, receive_ns))
+        return frames
+
+    def next_reply(self, timeout_s=REPLY_TIMEOUT_S):
+        """Return the next non-event frame, setting events aside."""
+        deadline = time.perf_counter() + timeout_s
+        while not self.replies:
+            remaining = deadline - time.perf_counter()
+            if remaining <= 0:
+                raise BenchmarkError("no reply within %.1f s" % timeout_s)
+            for frame in self.poll(remaining):
+                if frame.type == EVENT:
+                    self.events.append(frame)
+                else:
+                    self.replies.append(frame)
+        return self.replies.pop(0)
+
+    def request(self, msg_type, address, payload_type, payload=b""):
+        """Send one request and return (latency in ns, reply)."""
+        send_ns = self.send(make_request(msg_type, address, payload_type,
+                                         payload))
+        reply = self.next_reply()
+        if reply.address != address or reply.type not in (
+                msg_type, READ_ERROR, WRITE_ERROR):
+            raise BenchmarkError("unexpected reply to address %d: %s"
+                                 % (address, reply.raw.hex()))
+        return reply.receive_ns - send_ns, reply
+
+    def read(self, address, payload_type):
+        _, reply = self.request(READ, address, payload_type)
+        if reply.type != READ:
+            raise BenchmarkError("read of address %d failed" % address)
+        return reply
+
+    def write(self, address, payload_type, payload):
+        _, reply = self.request(WRITE, address, payload_type, payload)
+        if reply.type != WRITE:
+            raise BenchmarkError("write to address %d failed" % address)
+        return reply
+
+    def drain(self, quiet_s=0.05):
+        """Discard everything until the device has been quiet for quiet_s."""
+        while self.poll(quiet_s):
+            pass
+        self.pending.clear()
+        self.replies.clear()
+        self.events.clear()
+
+
+def percentile(sorted_values, fraction):
+    """Nearest-rank percentile of a sorted list."""
+    if not sorted_values:
+        return None
+    rank = max(1, int(round(fraction * len(sorted_values) + 0.5)))
+    return sorted_values[min(rank, len(sorted_values)) - 1]
+
+
+def summarize(case, latencies_ns, **fields):
+    values = sorted(ns / 1000.0 for ns in latencies_ns)
+    result = {"case": case, "n": len(values)}
+    result.update(fields)
+    if values:
+        result.update({
+            "mean_us": round(sum(values) / len(values), 3),
+            "p50_us": round(percentile(values, 0.50), 3),
+            "p90_us": round(percentile(values, 0.90), 3),
+            "p99_us": round(percentile(values, 0.99), 3),
+            "p999_us": round(percentile(values, 0.999), 3),
+            "max_us": round(values[-1], 3)})
+    return result
+
+
+def bench_pipeline(device, depth, count):
+    """Keep depth reads in flight. Replies arrive in order."""
+    frame = make_request(READ, WHO_AM_I, U16)
+    send_times = []
+    latencies = []
+    start_ns = time.perf_counter_ns()
+    while len(latencies) < count:
+        while len(send_times) - len(latencies) < depth \
+                and len(send_times) < count:
+            send_times.append(device.send(frame))
+        reply = device.next_reply()
+        if reply.type != READ or reply.address != WHO_AM_I:
+            raise BenchmarkError("unexpected pipelined reply: %s"
+                                 % reply.raw.hex())
+        latencies.append(reply.receive_ns - send_times[len(latencies)])
+    elapsed_s = (time.perf_counter_ns() - start_ns) / 1e9
+    return summarize("pipeline", latencies, depth=depth,
+                     throughput_msgs_per_s=round(count / elapsed_s, 1))
+
+
+def bench_payload(device, regs, count, writable):
+    results = []
+    for name, address, payload_type, elements in regs:
+        fmt = "<%d%s" % (elements, STRUCT_FORMATS[payload_type])
+        latencies = [device.request(READ, address, payload_type)[0]
+                     for _ in range(count)]
+        results.append(summarize("payload", latencies, op="read", reg=name,
+                                 bytes=struct.calcsize(fmt)))
+        if not writable:
+            continue
+        payload = struct.pack(fmt, *([1] * elements))
+        latencies = []
+        for _ in range(count):
+            latency_ns, reply = device.request(WRITE, address, payload_type,
+                                               payload)
+            if reply.type != WRITE or reply.payload != payload:
+                raise BenchmarkError("write to %s was not echoed" % name)
+            latencies.append(latency_ns)
+        results.append(summarize("payload", latencies, op="write", reg=name,
+                                 bytes=len(payload)))
+    return results
+
+
+def bench_dump(device, op_ctrl, count):
+    """Time until the last reply of a DUMP, which ends when quiet."""
+    latencies = []
+    reply_counts = []
+    frame = make_request(WRITE, OPERATION_CTRL, U8,
+                         bytes([op_ctrl | DUMP_BIT]))
+    for _ in range(count):
+        device.drain()
+        send_ns = device.send(frame)
+        last_ns = None
+        replies = 0
+        while True:
+            frames = device.poll(0.1 if last_ns is None else 0.05)
+            if not frames:
+                break
+            for reply in frames:
+                if reply.type == EVENT:
+                    continue
+                replies += 1
+                last_ns = reply.receive_ns
+        if last_ns is None:
+            raise BenchmarkError("no reply to DUMP")
+        latencies.append(last_ns - send_ns)
+        reply_counts.append(replies)
+    return summarize("dump", latencies, replies=max(reply_counts))
+
+
+def collect_events(device, duration_s):
+    """Return the bench app's events that arrive within duration_s."""
+    events = []
+    deadline = time.perf_counter() + duration_s
+    while True:
+        remaining = deadline - time.perf_counter()
+        if remaining <= 0:
+            return events
+        events += [f for f in device.poll(min(remaining, 0.05))
+                   if f.type == EVENT and f.address == EVENT_SEQ]
+
+
+def bench_events(device, op_ctrl, rate_hz, duration_s):
+    device.write(OPERATION_CTRL, U8,
+                 bytes([(op_ctrl & ~OP_MODE_MASK) | ACTIVE]))
+    drops_before = device.read(EVENT_DROPS, U32).values()[0]
+    device.write(EVENT_RATE_HZ, U32, struct.pack("<I", rate_hz))
+    events = collect_events(device, duration_s)
+    device.write(EVENT_RATE_HZ, U32, struct.pack("<I", 0))
+    device.drain()
+    drops = device.read(EVENT_DROPS, U32).values()[0] - drops_before
+    seqs = [event.values()[0] for event in events]
+    gaps = sum(max(0, b - a - 1) for a, b in zip(seqs, seqs[1:]))
+    if any(b <= a for a, b in zip(seqs, seqs[1:])):
+        raise BenchmarkError("events out of order")
+    if gaps > drops:
+        raise BenchmarkError("%d events lost beyond %d dropped on the device"
+                             % (gaps - drops, drops))
+    intervals = [b.receive_ns - a.receive_ns for a, b in zip(events,
+                                                              events[1:])]
+    return summarize("events", intervals, rate_hz=rate_hz,
+                     events=len(events), dropped=drops,
+                     throughput_events_per_s=round(len(events) / duration_s,
+                                                   1))
+
+
+def bench_events_load(device, op_ctrl, rate_hz, count):
+    device.write(OPERATION_CTRL, U8,
+                 bytes([(op_ctrl & ~OP_MODE_MASK) | ACTIVE]))
+    device.write(EVENT_RATE_HZ, U32, struct.pack("<I", rate_hz))
+    latencies = [device.request(READ, WHO_AM_I, U16)[0] for _ in range(count)]
+    events = len(device.events)
+    device.write(EVENT_RATE_HZ, U32, struct.pack("<I", 0))
+    device.drain()
+    return summarize("events_load", latencies, rate_hz=rate_hz,
+                     events=events)
+
+
+def start_host_device(path):
+    process = subprocess.Popen([path], stdout=subprocess.PIPE, text=True)
+    line = process.stdout.readline().strip()
+    if not line.startswith("pty="):
+        process.terminate()
+        raise BenchmarkError("host device did not report its port")
+    return process, line[len("pty="):]
+
+
+def run(device, args, emit):
+    device.drain()
+    op_ctrl = device.read(OPERATION_CTRL, U8).values()[0] & ~DUMP_BIT
+    name = bytes(device.read(DEVICE_NAME, U8).payload).split(b"\0")[0]
+    bench_app = name.decode(errors="replace") == BENCH_DEVICE_NAME
+    scale = 0.1 if args.quick else 1.0
+    try:
+        for depth in (1, 2, 4, 8, 16):
+            emit(bench_pipeline(device, depth, int(2000 * scale)))
+        if bench_app:
+            results = bench_payload(device, BENCH_REGS, int(500 * scale),
+                                    writable=True)
+        else:
+            results = bench_payload(device, CORE_READ_REGS, int(500 * scale),
+                                    writable=False)
+            # Rewriting R_OPERATION_CTRL with its value is a harmless write.
+            latencies = [device.request(WRITE, OPERATION_CTRL, U8,
+                                        bytes([op_ctrl]))[0]
+                         for _ in range(int(500 * scale))]
+            results.append(summarize("payload", latencies, op="write",
+                                     reg="operation_ctrl", bytes=1))
+        for result in results:
+            emit(result)
+        emit(bench_dump(device, op_ctrl, max(3, int(20 * scale))))
+        if not bench_app:
+            for case in ("events", "events_load"):
+                emit({"case": case, "skipped": "no bench app registers"})
+            return
+        for rate_hz in (1000, 10000, 50000):
+            emit(bench_events(device, op_ctrl, rate_hz,
+                              1.0 if args.quick else 5.0))
+        for rate_hz in (1000, 10000):
+            emit(bench_events_load(device, op_ctrl, rate_hz,
+                                   int(2000 * scale)))
+    finally:
+        device.drain()
+        device.write(OPERATION_CTRL, U8, bytes([op_ctrl]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    target = parser.add_mutually_exclusive_group(required=True)
+    target.add_argument("--port", help="serial port of the device.")
+    target.add_argument("--host-device",
+                        help="path to the host-built pty_device to start.")
+    parser.add_argument("--quick", action="store_true",
+                        help="fewer iterations, i.e: for CI.")
+    parser.add_argument("--output", help="also write the results here.")
+    args = parser.parse_args()
+
+    results = []
+
+    def emit(result):
+        results.append(result)
+        print(json.dumps(result), flush=True)
+
+    process = None
+    port_path = args.port
+    if args.host_device:
+        process, port_path = start_host_device(args.host_device)
+    port = Port(port_path)
+    try:
+        run(Device(port), args, emit)
+    except BenchmarkError as error:
+        print("Benchmark failed: %s" % error, file=sys.stderr)
+        return 1
+    finally:
+        port.close()
+        if process is not None:
+            process.terminate()
+            process.wait()
+    if args.output:
+        with open(args.output, "w") as output:
+            for result in results:
+                output.write(json.dumps(result) + "\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())